@@ -15,23 +15,16 @@
 #include <sys/socket.h>
 #include <linux/can.h>
 #include <linux/can/raw.h>
+#include "../can-rx.h"
+#include "../can-dbc.h"
+#include "../can-dbc-cache.h"
+#include "../can-dbc-encode.h"
+#ifdef CAN_DBC_GENERATED
+#include "../vehicle-dbc.h"     // decoders generated from vehicle.dbc by can-dbc-codegen
+#endif
 
 using namespace std;
 
-struct Signal {
-    string name;
-    int start_bit;
-    int length;
-    float scale;
-    float offset;
-    string unit;
-};
-
-struct CANMessageDef {
-    string name;
-    vector<Signal> signals;
-};
-
 map<unsigned int, CANMessageDef> dbc_map = {
     {0x100, {"EngineData", {
         {"EngineTemp", 0, 16, 0.01, 0.0, "°C"},
@@ -40,47 +33,8 @@ map<unsigned int, CANMessageDef> dbc_map = {
     }}}
 };
 
-void encodeSignals(can_frame &frame, float temp, float volt, int rpm) {
-    frame.can_id = 0x100;
-    frame.can_dlc = 8;
-    memset(frame.data, 0, 8);
-
-    int16_t temp_raw = (int16_t)((temp - 0.0f) / 0.01f);
-    int16_t volt_raw = (int16_t)((volt - 0.0f) / 0.01f);
-    int32_t rpm_raw  = (int32_t)((rpm - 0.0f) / 1.0f);
-
-    frame.data[0] = temp_raw & 0xFF;
-    frame.data[1] = (temp_raw >> 8) & 0xFF;
-    frame.data[2] = volt_raw & 0xFF;
-    frame.data[3] = (volt_raw >> 8) & 0xFF;
-    frame.data[4] = rpm_raw & 0xFF;
-    frame.data[5] = (rpm_raw >> 8) & 0xFF;
-    frame.data[6] = (rpm_raw >> 16) & 0xFF;
-    frame.data[7] = (rpm_raw >> 24) & 0xFF;
-}
-
-map<string, float> decodeFrame(const can_frame &frame) {
-    map<string, float> result;
-    unsigned int can_id = frame.can_id & CAN_SFF_MASK;
-
-    if (dbc_map.find(can_id) == dbc_map.end())
-        return result;
-
-    auto msgDef = dbc_map[can_id];
-
-    for (auto &sig : msgDef.signals) {
-        unsigned long raw_val = 0;
-        int byte_start = sig.start_bit / 8;
-        int byte_len = sig.length / 8;
-        for (int i = 0; i < byte_len; i++)
-            raw_val |= ((unsigned long)frame.data[byte_start + i] << (8 * i));
-
-        float physical = raw_val * sig.scale + sig.offset;
-        result[sig.name] = physical;
-    }
-
-    return result;
-}
+// Compiled once at startup; encoding and decoding never touch dbc_map
+CANDecodeTable dbc_table(dbc_map);
 
 void senderThread(const char *ifname) {
     int s;
@@ -102,7 +56,16 @@ void senderThread(const char *ifname) {
         return;
     }
 
-    can_frame frame{};
+    CANEncoder encoder(dbc_table);
+    const CANMessageDesc *engineData = dbc_table.find(0x100);
+    const int engineTemp = dbc_table.signalHandle("EngineTemp");
+    const int batteryVolt = dbc_table.signalHandle("BatteryVolt");
+    const int engineRpm = dbc_table.signalHandle("RPM");
+    if (!engineData || engineTemp < 0 || batteryVolt < 0 || engineRpm < 0) {
+        cerr << "[Sender] DBC has no EngineData (0x100) with EngineTemp/BatteryVolt/RPM\n";
+        close(s);
+        return;
+    }
     srand(time(0));
 
     while (true) {
@@ -110,7 +73,10 @@ void senderThread(const char *ifname) {
         float volt = 12.0f + (rand() % 100) / 10.0f;
         int rpm = 800 + (rand() % 6000);
 
-        encodeSignals(frame, temp, volt, rpm);
+        encoder.set(engineTemp, temp);
+        encoder.set(batteryVolt, volt);
+        encoder.set(engineRpm, rpm);
+        const can_frame &frame = encoder.frame(*engineData);
         write(s, &frame, sizeof(frame));
 
         this_thread::sleep_for(chrono::seconds(1));
@@ -143,30 +109,54 @@ void receiverThread(const char *ifname) {
     ofstream csv("can_dbc_log.csv");
     csv << "Timestamp,EngineTemp,BatteryVolt,RPM\n";
 
-    can_frame frame{};
+#ifndef CAN_DBC_GENERATED
+    // Resolve signal names once; each frame decodes into a preallocated array
+    const int engineTemp = dbc_table.signalHandle("EngineTemp");
+    const int batteryVolt = dbc_table.signalHandle("BatteryVolt");
+    const int rpmSig = dbc_table.signalHandle("RPM");
+    if (engineTemp < 0 || batteryVolt < 0 || rpmSig < 0) {
+        cerr << "[Receiver] DBC has no EngineTemp/BatteryVolt/RPM signals\n";
+        close(s);
+        return;
+    }
+    vector<float> values(dbc_table.signalCount());
+#endif
+
+    CANReceiver rx(s);
     while (true) {
-        int nbytes = read(s, &frame, sizeof(frame));
-        if (nbytes < 0) {
+        int n = rx.receive();
+        if (n < 0) {
             perror("Receiver Read");
             break;
         }
 
-        auto decoded = decodeFrame(frame);
-        if (!decoded.empty()) {
-            auto now = chrono::system_clock::now();
-            time_t t = chrono::system_clock::to_time_t(now);
-            tm tm = *localtime(&t);
-
-            cout << put_time(&tm, "%H:%M:%S") << " "
-                 << "Temp: " << fixed << setprecision(2) << decoded["EngineTemp"] << "°C, "
-                 << "Volt: " << decoded["BatteryVolt"] << "V, "
-                 << "RPM: " << decoded["RPM"] << endl;
-
-            csv << put_time(&tm, "%H:%M:%S") << ","
-                << decoded["EngineTemp"] << ","
-                << decoded["BatteryVolt"] << ","
-                << decoded["RPM"] << "\n";
-            csv.flush();
+        for (int k = 0; k < n; k++) {
+            const can_frame &frame = rx.frame(k);
+#ifdef CAN_DBC_GENERATED
+            if (frame.can_id == dbc::EngineData::ID) {
+                dbc::EngineData engine;
+                engine.decode(frame.data);
+                float temp = engine.EngineTemp, volt = engine.BatteryVolt, rpm = engine.RPM;
+#else
+            const CANMessageDesc *msg = dbc_table.decodeInto(frame, values.data());
+            if (msg && CANDecodeTable::hasSignal(*msg, engineTemp)) {
+                float temp = values[engineTemp], volt = values[batteryVolt], rpm = values[rpmSig];
+#endif
+                auto now = toSystemTime(rx.timestampNs(k));
+                time_t t = chrono::system_clock::to_time_t(now);
+                tm tm = *localtime(&t);
+
+                cout << put_time(&tm, "%H:%M:%S") << " "
+                     << "Temp: " << fixed << setprecision(2) << temp << "°C, "
+                     << "Volt: " << volt << "V, "
+                     << "RPM: " << rpm << endl;
+
+                csv << put_time(&tm, "%H:%M:%S") << ","
+                    << temp << ","
+                    << volt << ","
+                    << rpm << "\n";
+                csv.flush();
+            }
         }
     }
 
@@ -174,9 +164,21 @@ void receiverThread(const char *ifname) {
     close(s);
 }
 
-int main() {
+int main(int argc, char **argv) {
     const char *ifname = "vcan0";
 
+    // Optional .dbc file replaces the built-in definitions; the compiled
+    // table is cached next to it and reused while the file is unchanged
+    if (argc > 1) {
+        vector<DBCError> errors;
+        if (!loadDBCCached(argv[1], dbc_table, errors)) {
+            for (auto &e : errors)
+                cerr << argv[1] << ":" << e.line << ": " << e.message << endl;
+            return 1;
+        }
+        cout << "Loaded " << dbc_table.messageCount() << " messages from " << argv[1] << endl;
+    }
+
     thread sender(senderThread, ifname);
     thread receiver(receiverThread, ifname);
 
@@ -1,34 +1,23 @@
 #include <iostream>
-#include <thread>
-#include <fstream>
-#include <iomanip>
-#include <chrono>
 #include <cstring>
-#include <sstream>
+#include <memory>
 #include <unordered_map>
+#include <vector>
 #include <sys/socket.h>
 #include <linux/can.h>
 #include <linux/can/raw.h>
 #include <net/if.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
+#include <csignal>
+#include "../can-reactor.h"
+#include "../can-isotp.h"
+#include "../can-capture.h"
 
 using namespace std;
 
 //Helpers
-string time_local_now() {
-    using namespace chrono;
-    auto now = system_clock::now();
-    auto tt = system_clock::to_time_t(now);
-    auto us = duration_cast<microseconds>(now.time_since_epoch()) % 1000000;
-    tm local_tm {}; localtime_r(&tt, &local_tm);
-    stringstream ss;
-    ss << put_time(&local_tm, "%Y-%m-%d %H:%M:%S")
-       << "." << setw(6) << setfill('0') << us.count();
-    return ss.str();
-}
-
-string node_name(uint32_t id) {
+const char *node_name(uint32_t id) {
     switch (id) {
         case 0x100: return "Engine";
         case 0x120: return "Transmission";
@@ -43,14 +32,6 @@ string node_name(uint32_t id) {
     }
 }
 
-string data_to_hex(const struct can_frame &f) {
-    stringstream ss;
-    ss << hex << setfill('0');
-    for (int i = 0; i < f.can_dlc; ++i)
-        ss << setw(2) << (int)f.data[i];
-    return ss.str();
-}
-
 //Decode DTC
 string decode_dtc(uint8_t a, uint8_t b) {
     if (a == 0 && b == 0) return "None";
@@ -67,10 +48,8 @@ string decode_dtc(uint8_t a, uint8_t b) {
     return formatted;
 }
 
-//Decode CAN Frame
-string decode_frame(const struct can_frame &f, int &rpm, int &temp, int &gear, int &ws, string &dtc, string &desc) {
-    uint32_t id = f.can_id & CAN_SFF_MASK;
-
+//Decode a UDS response reassembled by ISO-TP; the first failing DTC is the active one
+void decode_diag(const uint8_t *resp, size_t len, string &dtc, string &desc) {
     static unordered_map<string, string> dtc_description = {
         {"P0217", "Engine Overheat"},
         {"P0700", "Transmission System Fault"},
@@ -79,6 +58,28 @@ string decode_frame(const struct can_frame &f, int &rpm, int &temp, int &gear, i
         {"U1000", "CAN Communication Fault"}
     };
 
+    dtc = "None";
+    desc = "No Active DTC";
+    if (resp[0] == 0x59) {
+        for (size_t i = 3; i + 4 <= len; i += 4) {
+            if (!(resp[i + 3] & 0x01)) continue;    // testFailed
+            string code = decode_dtc(resp[i], resp[i + 1]);
+            dtc = "Active:" + code;
+            desc = dtc_description.count(code) ? dtc_description[code] : "Unknown DTC";
+            break;
+        }
+    }
+    else if (resp[0] == 0x54) {
+        dtc = "Cleared";
+        desc = "DTC Cleared";
+    }
+}
+
+//Decode CAN Frame
+void decode_frame(const struct can_frame &f, uint64_t ts_ns, ISOTPEngine &diag,
+                  int &rpm, int &temp, int &gear, int &ws) {
+    uint32_t id = f.can_id & CAN_SFF_MASK;
+
     if (id == 0x100) {  // Engine
         rpm = f.data[0] | (f.data[1] << 8);
         temp = f.data[3];
@@ -89,29 +90,107 @@ string decode_frame(const struct can_frame &f, int &rpm, int &temp, int &gear, i
     else if (id == 0x200) {  // ABS
         ws = f.data[0] | (f.data[1] << 8);
     }
-    else if (id >= 0x7E8 && id <= 0x7EA) {  // Diagnostic responses
-        if (f.data[0] == 0x59 && f.data[2] != 0) {
-            string code = decode_dtc(f.data[2], f.data[3]);
-            dtc = "Active:" + code;
-            desc = dtc_description.count(code) ? dtc_description[code] : "Unknown DTC";
-        } 
-        else if (f.data[0] == 0x54) {
-            dtc = "Cleared";
-            desc = "DTC Cleared";
-        }
-        else {
-            dtc = "None";
-            desc = "No Active DTC";
-        }
+    else if (id >= 0x7E8 && id <= 0x7EA) {  // Diagnostic responses, may span frames
+        diag.receive(f, ts_ns);
+    }
+}
+
+//Decoded row; formatted off the receive thread
+struct LogRecord {
+    int64_t wall_ns;
+    struct can_frame frame;
+    int rpm, temp, gear, ws;
+    char dtc[16];
+    char desc[40];
+};
+
+size_t format_row(const LogRecord &r, int64_t start_ns, const char *bus, char *out) {
+    const struct can_frame &f = r.frame;
+    uint32_t id = f.can_id & CAN_SFF_MASK;
+    char *p = out + formatWallTime(r.wall_ns, out, 6);
+    *p++ = ',';
+    p += formatFixed((r.wall_ns - start_ns) / 1e9, 6, p);
+    *p++ = ',';
+    p += formatText(bus, p);
+    p += formatText(",0x", p);
+    p += formatHex(id, p);
+    *p++ = ',';
+    p += formatDec(int(f.can_dlc), p);
+    *p++ = ',';
+    p += formatBytes(f.data, min<int>(f.can_dlc, 8), p, '\0', false);
+    *p++ = ',';
+    p += formatText(node_name(id), p);
+    p += formatText(",RPM=", p);
+    p += formatDec(r.rpm, p);
+    p += formatText(",Temp=", p);
+    p += formatDec(r.temp, p);
+    p += formatText("C,Gear=", p);
+    p += formatDec(r.gear, p);
+    p += formatText(",WS=", p);
+    p += formatDec(r.ws, p);
+    p += formatText(",DTC=", p);
+    p += formatText(r.dtc, p);
+    p += formatText(",Desc=", p);
+    p += formatText(r.desc, p);
+    *p++ = '\n';
+    return p - out;
+}
+
+const char *CSV_HEADER = "time_local,ts_mono,bus,can_id,dlc,data_hex,node_inferred,decoded_values\n";
+
+//Decoder state, fed either live frames or a replayed capture
+struct VehicleDecoder {
+    int rpm = 0, temp = 0, gear = 0, ws = 0;
+    string dtc = "None", desc = "No Active DTC";
+    ISOTPEngine diag;
+
+    // Listen-only ISO-TP channels for the ECUs' diagnostic responses
+    VehicleDecoder() : diag(3, [](const struct can_frame &) {}) {
+        for (int ecu = 0; ecu < 3; ecu++)
+            diag.open(0x7E0 + ecu, 0x7E8 + ecu, true);
+        diag.onMessage = [this](int, const uint8_t *resp, size_t len) { decode_diag(resp, len, dtc, desc); };
     }
 
-    stringstream ss;
-    ss << "RPM=" << rpm << ",Temp=" << temp << "C,Gear=" << gear 
-       << ",WS=" << ws << ",DTC=" << dtc << ",Desc=" << desc;
-    return ss.str();
+    LogRecord decode(const struct can_frame &f, uint64_t ts_ns, int64_t wall_ns) {
+        decode_frame(f, ts_ns, diag, rpm, temp, gear, ws);
+        LogRecord r{wall_ns, f, rpm, temp, gear, ws, {}, {}};
+        strncpy(r.dtc, dtc.c_str(), sizeof(r.dtc) - 1);
+        strncpy(r.desc, desc.c_str(), sizeof(r.desc) - 1);
+        return r;
+    }
+};
+
+//Replay a binary capture through the decoder into the CSV layout
+int convert(const char *in_path, const char *out_path) {
+    CANCaptureReader in(in_path);
+    if (!in.ok()) return 1;
+    FILE *out = fopen(out_path, "w");
+    if (!out) { perror(out_path); return 1; }
+    vector<char> buf(1 << 20);
+    setvbuf(out, buf.data(), _IOFBF, buf.size());
+    fputs(CSV_HEADER, out);
+
+    VehicleDecoder dec;
+    uint64_t rows = 0;
+    in.forEach([&](const CANCaptureRecord &c) {
+        char line[256];
+        LogRecord r = dec.decode(c.frame(), c.ts_ns, c.ts_ns);
+        fwrite(line, 1, format_row(r, in.header().startNs, in.busName(c.bus), line), out);
+        rows++;
+    });
+    if (fclose(out) != 0) { perror(out_path); return 1; }
+    cout << rows << " rows written to " << out_path << endl;
+    return 0;
 }
 
-int main() {
+// Usage: can-logger [--csv]                         capture to vehicle_capture.cancap
+//                                                   (--csv: decoded CSV, as before)
+//        can-logger --convert <in.cancap> [out.csv] decode a capture to CSV
+int main(int argc, char **argv) {
+    if (argc > 2 && strcmp(argv[1], "--convert") == 0)
+        return convert(argv[2], argc > 3 ? argv[3] : "vehicle_decoded_log.csv");
+    bool csv = argc > 1 && strcmp(argv[1], "--csv") == 0;
+
     string iface = "vcan0";
     int s = socket(PF_CAN, SOCK_RAW, CAN_RAW);
     struct ifreq ifr {};
@@ -122,37 +201,41 @@ int main() {
     addr.can_ifindex = ifr.ifr_ifindex;
     bind(s, (struct sockaddr*)&addr, sizeof(addr));
 
-    ofstream log("vehicle_decoded_log.csv");
-    log << "time_local,ts_mono,bus,can_id,dlc,data_hex,node_inferred,decoded_values\n";
-
     cout << "Logger started on " << iface << " (Press Ctrl+C to stop)" << endl;
 
-    struct can_frame f {};
-    auto start = chrono::steady_clock::now();
-    int rpm = 0, temp = 0, gear = 0, ws = 0;
-    string dtc = "None", desc = "No Active DTC";
-
-    while (true) {
-        ssize_t n = read(s, &f, sizeof(f));
-        if (n > 0) {
-            auto now = chrono::steady_clock::now();
-            double ts = chrono::duration<double>(now - start).count();
-            string node = node_name(f.can_id & CAN_SFF_MASK);
-            string data_hex = data_to_hex(f);
-            string decoded = decode_frame(f, rpm, temp, gear, ws, dtc, desc);
-
-            log << time_local_now() << ","
-                << fixed << setprecision(6) << ts << ",vcan0,"
-                << "0x" << hex << uppercase << (f.can_id & CAN_SFF_MASK) << nouppercase << dec << ","
-                << (int)f.can_dlc << ","
-                << data_hex << ","
-                << node << ","
-                << decoded << "\n";
-            log.flush();
-        }
-        this_thread::sleep_for(chrono::milliseconds(5));
+    CANReactor reactor;
+    static CANReactor *active = &reactor;
+    signal(SIGINT, [](int) { active->stop(); });
+
+    // Both writers do their disk I/O on their own thread
+    unique_ptr<CANCaptureWriter> capture;
+    unique_ptr<CANLogWriter<LogRecord>> log;
+    VehicleDecoder dec;
+    CANWallClock clock;
+    if (csv) {
+        int64_t start_ns = clock.toWall(monotonicNowNs());
+        log = make_unique<CANLogWriter<LogRecord>>("vehicle_decoded_log.csv", CSV_HEADER,
+            [start_ns](const LogRecord &r, char *out) { return format_row(r, start_ns, "vcan0", out); });
+    } else {
+        capture = make_unique<CANCaptureWriter>("vehicle_capture.cancap", vector<const char *>{iface.c_str()});
     }
 
-    close(s);
+    // Woken by epoll only when frames are queued; each wakeup drains the socket
+    reactor.addReader(s, [&](const struct can_frame &f, uint64_t ts_ns) {
+        if (capture) capture->push(f, ts_ns);
+        else log->push(dec.decode(f, ts_ns, clock.toWall(ts_ns)));
+    });
+
+    reactor.run();
+
+    if (capture) {
+        capture->stop();
+        cout << "Logger stopped: " << capture->written << " frames in " << capture->blocks << " blocks, "
+             << capture->dropped << " dropped, ring high-water " << capture->highWater << "/" << capture->capacity() << endl;
+    } else {
+        log->stop();
+        cout << "Logger stopped: " << log->written << " rows, " << log->dropped << " dropped, ring high-water "
+             << log->highWater << "/" << log->capacity() << endl;
+    }
     return 0;
 }
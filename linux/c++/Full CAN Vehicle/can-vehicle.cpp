@@ -1,6 +1,4 @@
 #include <iostream>
-#include <thread>
-#include <atomic>
 #include <chrono>
 #include <iomanip>
 #include <fstream>
@@ -9,6 +7,7 @@
 #include <csignal>
 #include <fcntl.h>
 #include <unordered_map>
+#include <vector>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <linux/can.h>
@@ -16,11 +15,37 @@
 #include <net/if.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
+#include "../can-reactor.h"
+#include "../can-isotp.h"
+#include "../can-uds.h"
 using namespace std;
 
-atomic<bool> running(true);
-atomic<bool> engineDTC(false), transDTC(false), absDTC(false);
-atomic<bool> lastEngineFault(false), lastTransFault(false), lastABSFault(false);
+// DTCs each ECU can store, with ISO 14229 status bits. Only touched from
+// the reactor thread (ECU ticks and the diagnostic responder).
+const uint8_t DTC_TEST_FAILED = 0x01, DTC_CONFIRMED = 0x08;
+
+struct StoredDTC {
+    uint8_t code[3];
+    uint8_t status;
+};
+
+enum { ENGINE, TRANSMISSION, ABS, ECU_COUNT };
+
+vector<StoredDTC> ecu_dtcs[ECU_COUNT] = {
+    {{{0x02, 0x17, 0x00}, 0}, {{0x01, 0x28, 0x00}, 0}, {{0x03, 0x00, 0x00}, 0}},     // P0217 P0128 P0300
+    {{{0x07, 0x00, 0x00}, 0}},                                                       // P0700
+    {{{0xC1, 0x23, 0x04}, 0}},                                                       // U0123
+};
+
+void set_dtc(int ecu, int index, bool failing) {
+    uint8_t &status = ecu_dtcs[ecu][index].status;
+    if (failing) status |= DTC_TEST_FAILED | DTC_CONFIRMED;
+    else status &= ~DTC_TEST_FAILED;
+}
+
+bool dtc_failing(int ecu, int index) {
+    return ecu_dtcs[ecu][index].status & DTC_TEST_FAILED;
+}
 
 int open_can_socket_nonblocking(const string &ifname) {
     int s = socket(PF_CAN, SOCK_RAW, CAN_RAW);
@@ -40,9 +65,10 @@ int open_can_socket_nonblocking(const string &ifname) {
     return s;
 }
 
-string time_local_now() {
+// Local wall-clock time of a monotonic (kernel RX) timestamp
+string time_local(uint64_t mono_ns) {
     using namespace chrono;
-    auto now = system_clock::now();
+    auto now = toSystemTime(mono_ns);
     auto tt = system_clock::to_time_t(now);
     auto us = duration_cast<microseconds>(now.time_since_epoch()) % 1000000;
     tm local_tm {}; localtime_r(&tt, &local_tm);
@@ -75,127 +101,101 @@ string node_name(uint32_t id) {
     }
 }
 
-void engine_ecu(const string &ifname) {
-    int s = open_can_socket_nonblocking(ifname);
-    if (s < 0) return;
+// ECU periodic transmissions, driven by reactor timers
+void engine_ecu_tick(int s) {
+    static int counter = 0;
     struct can_frame f {}; f.can_id = 0x100; f.can_dlc = 6;
-    int counter = 0;
 
-    while (running) {
-        int rpm = 800 + rand() % 1000;
-        int temp = 70 + rand() % 50;
-        int torque = rand() % 255;
+    int rpm = 800 + rand() % 1000;
+    int temp = 70 + rand() % 50;
+    int torque = rand() % 255;
 
-        f.data[0] = rpm & 0xFF; f.data[1] = (rpm >> 8) & 0xFF;
-        f.data[2] = torque; f.data[3] = temp;
-        f.data[4] = 0; f.data[5] = 0;
-        write(s, &f, sizeof(f));
+    f.data[0] = rpm & 0xFF; f.data[1] = (rpm >> 8) & 0xFF;
+    f.data[2] = torque; f.data[3] = temp;
+    f.data[4] = 0; f.data[5] = 0;
+    write(s, &f, sizeof(f));
 
-        if (++counter % 40 == 0) engineDTC = !engineDTC;
-        this_thread::sleep_for(chrono::milliseconds(100));
-    }
-    close(s);
+    if (++counter % 40 == 0) set_dtc(ENGINE, 0, !dtc_failing(ENGINE, 0));
+    set_dtc(ENGINE, 1, temp < 75);
+    if (rand() % 1000 < 5) set_dtc(ENGINE, 2, !dtc_failing(ENGINE, 2));
 }
 
-void transmission_ecu(const string &ifname) {
-    int s = open_can_socket_nonblocking(ifname);
-    if (s < 0) return;
+void transmission_ecu_tick(int s) {
     struct can_frame f {}; f.can_id = 0x120; f.can_dlc = 4;
 
-    while (running) {
-        f.data[0] = rand() % 6;
-        f.data[1] = rand() % 255;
-        f.data[2] = rand() % 100;
-        f.data[3] = 0;
-        write(s, &f, sizeof(f));
+    f.data[0] = rand() % 6;
+    f.data[1] = rand() % 255;
+    f.data[2] = rand() % 100;
+    f.data[3] = 0;
+    write(s, &f, sizeof(f));
 
-        if ((rand() % 1000) < 3) transDTC = true;
-        if ((rand() % 1000) < 5) transDTC = false;
-        this_thread::sleep_for(chrono::milliseconds(120));
-    }
-    close(s);
+    if ((rand() % 1000) < 3) set_dtc(TRANSMISSION, 0, true);
+    if ((rand() % 1000) < 5) set_dtc(TRANSMISSION, 0, false);
 }
 
-void abs_ecu(const string &ifname) {
-    int s = open_can_socket_nonblocking(ifname);
-    if (s < 0) return;
+void abs_ecu_tick(int s) {
     struct can_frame f {}; f.can_id = 0x200; f.can_dlc = 8;
 
-    while (running) {
-        for (int i = 0; i < 4; i++) {
-            int ws = 30 + rand() % 220;
-            f.data[i * 2] = ws & 0xFF;
-            f.data[i * 2 + 1] = (ws >> 8) & 0xFF;
-        }
-        write(s, &f, sizeof(f));
-
-        if (rand() % 2000 < 3) absDTC = true;
-        if (rand() % 2000 < 5) absDTC = false;
-        this_thread::sleep_for(chrono::milliseconds(150));
+    for (int i = 0; i < 4; i++) {
+        int ws = 30 + rand() % 220;
+        f.data[i * 2] = ws & 0xFF;
+        f.data[i * 2 + 1] = (ws >> 8) & 0xFF;
     }
-    close(s);
+    write(s, &f, sizeof(f));
+
+    if (rand() % 2000 < 3) set_dtc(ABS, 0, true);
+    if (rand() % 2000 < 5) set_dtc(ABS, 0, false);
 }
 
-void diag_responder(const string &ifname) {
-    int s = open_can_socket_nonblocking(ifname);
-    if (s < 0) return;
-    struct can_frame req {}, resp {};
-
-    while (running) {
-        ssize_t n = read(s, &req, sizeof(req));
-        if (n > 0 && req.can_dlc >= 2) {
-            uint32_t id = req.can_id & CAN_SFF_MASK;
-            if (id >= 0x7E0 && id <= 0x7E2) {
-                resp.can_id = id + 8;
-                uint8_t svc = req.data[0], sub = req.data[1];
-
-                if (svc == 0x19) { // Read DTC
-                    resp.can_dlc = 5; resp.data[0] = 0x59; resp.data[1] = sub;
-                    if (id == 0x7E0 && engineDTC) { resp.data[2]=0x02; resp.data[3]=0x17; resp.data[4]=0x00; lastEngineFault = true; }
-                    else if (id == 0x7E1 && transDTC) { resp.data[2]=0x07; resp.data[3]=0x00; resp.data[4]=0x00; lastTransFault = true; }
-                    else if (id == 0x7E2 && absDTC) { resp.data[2]=0xC1; resp.data[3]=0x23; resp.data[4]=0x04; lastABSFault = true; }
-                    else resp.data[2] = resp.data[3] = resp.data[4] = 0;
-                }
-                else if (svc == 0x14) { // Clear DTC
-                    resp.can_dlc = 2; resp.data[0] = 0x54; resp.data[1] = sub;
-                    if (id == 0x7E0) engineDTC = false;
-                    if (id == 0x7E1) transDTC = false;
-                    if (id == 0x7E2) absDTC = false;
-                }
-                write(s, &resp, sizeof(resp));
-            }
-        }
-        this_thread::sleep_for(chrono::milliseconds(10));
+// Answers a UDS request reassembled by ISO-TP; channel i is ECU i
+// (requests on 0x7E0 + i, responses on 0x7E8 + i)
+void diag_responder(ISOTPEngine &tp, int ecu, const uint8_t *req, size_t len, uint64_t now_ns) {
+    vector<uint8_t> resp;
+    if (req[0] == 0x19 && len >= 3 && req[1] == 0x02) {
+        // ReadDTCInformation, reportDTCByStatusMask: every DTC whose status
+        // matches the mask, 4 bytes each, so the response is multi-frame
+        resp = {0x59, 0x02, DTC_TEST_FAILED | DTC_CONFIRMED};
+        for (auto &dtc : ecu_dtcs[ecu])
+            if (dtc.status & req[2])
+                resp.insert(resp.end(), {dtc.code[0], dtc.code[1], dtc.code[2], dtc.status});
+    }
+    else if (req[0] == 0x14 && len >= 4) { // ClearDiagnosticInformation, all groups
+        for (auto &dtc : ecu_dtcs[ecu]) dtc.status = 0;
+        resp = {0x54};
     }
-    close(s);
+    else {
+        uint8_t nrc = 0x11;                                 // serviceNotSupported
+        if (req[0] == 0x19) nrc = len >= 2 && req[1] != 0x02 ? 0x12 : 0x13;
+        else if (req[0] == 0x14) nrc = 0x13;                // incorrectMessageLength
+        resp = {0x7F, req[0], nrc};
+    }
+    tp.send(ecu, resp.data(), resp.size(), now_ns);
 }
 
-void diag_tester(const string &ifname) {
-    int s = open_can_socket_nonblocking(ifname);
-    if (s < 0) return;
-    struct can_frame req {};
-
-    while (running) {
-        for (uint32_t id = 0x7E0; id <= 0x7E2; id++) {
-            req.can_id = id; req.can_dlc = 2;
-            req.data[0] = 0x19; req.data[1] = 0x02;
-            write(s, &req, sizeof(req));
-            this_thread::sleep_for(chrono::milliseconds(200));
-
-            if ((id == 0x7E0 && lastEngineFault) ||
-                (id == 0x7E1 && lastTransFault) ||
-                (id == 0x7E2 && lastABSFault)) {
-                req.data[0] = 0x14; req.data[1] = 0xFF;
-                write(s, &req, sizeof(req));
-                this_thread::sleep_for(chrono::milliseconds(200));
-                if (id == 0x7E0) lastEngineFault = false;
-                if (id == 0x7E1) lastTransFault = false;
-                if (id == 0x7E2) lastABSFault = false;
-            }
-            this_thread::sleep_for(chrono::seconds(2));
-        }
+// Diagnostic tester cycle: ask every ECU for its DTCs at once and clear
+// those that report any; the client matches each answer to its ECU
+void diag_cycle(UDSClient &uds) {
+    for (int ecu = 0; ecu < ECU_COUNT; ecu++) {
+        uds.request(ecu, {0x19, 0x02, DTC_TEST_FAILED | DTC_CONFIRMED}, monotonicNowNs(),
+                    [&uds](const UDSResponse &r) {
+            if (r.status == UDSStatus::Positive && r.len > 3)
+                uds.request(r.ecu, {0x14, 0xFF, 0xFF, 0xFF}, monotonicNowNs());
+        });
+    }
+}
+
+void print_diag_latency(const UDSClient &uds) {
+    const char *names[ECU_COUNT] = {"Engine", "Transmission", "ABS"};
+    for (int ecu = 0; ecu < ECU_COUNT; ecu++) {
+        const UDSClient::Stats &st = uds.stats(ecu);
+        uint32_t answered = st.positive + st.negative;
+        cout << "[DIAG] " << setw(12) << left << names[ecu] << right << " requests=" << st.requests
+             << " failed=" << st.failed;
+        if (answered)
+            cout << fixed << setprecision(2) << " rtt min/avg/max=" << st.rttMinNs / 1e6 << "/"
+                 << st.rttTotalNs / 1e6 / answered << "/" << st.rttMaxNs / 1e6 << " ms";
+        cout << "\n";
     }
-    close(s);
 }
 
 string decode_dtc(uint8_t a, uint8_t b) {
@@ -213,92 +213,135 @@ string decode_dtc(uint8_t a, uint8_t b) {
     return formatted;
 }
 
-void receiver_dashboard(const string &ifname) {
-    int s = open_can_socket_nonblocking(ifname);
-    if (s < 0) return;
-    struct can_frame f {};
-
-    ofstream log("vehicle_decoded_log.csv");
-    log << "time_local,ts_mono,bus,can_id,dlc,data_hex,node,decoded_values\n";
-
-    auto start = chrono::steady_clock::now();
+// Dashboard state carried between frames
+struct Dashboard {
+    ofstream log;
+    uint64_t start_ns = monotonicNowNs();
     int rpm=0, temp=0, gear=0, ws=0;
     string dtc="None", last_state="None";
-
-    unordered_map<string, string> dtc_description = {
-        {"P0217", "Engine Overheat"},
-        {"P0700", "Transmission System Fault"},
-        {"C1234", "ABS Wheel Speed Sensor Fault"}
-    };
-
-    while (running) {
-        ssize_t n = read(s, &f, sizeof(f));
-        if (n > 0) {
-            auto now = chrono::steady_clock::now();
-            double ts = chrono::duration<double>(now - start).count();
-            string hex = data_to_hex(f);
-            uint32_t id = f.can_id & CAN_SFF_MASK;
-            string node = node_name(id);
-
-            if (id == 0x100) { rpm = f.data[0] | (f.data[1]<<8); temp = f.data[3]; }
-            else if (id == 0x120) { gear = f.data[0]; }
-            else if (id == 0x200) { ws = f.data[0] | (f.data[1]<<8); }
-            else if (id >= 0x7E8 && id <= 0x7EA) {
-                if (f.data[0] == 0x59 && f.data[2] != 0)
-                    dtc = "Active:" + decode_dtc(f.data[2], f.data[3]);
-                else if (f.data[0] == 0x54)
-                    dtc = "Cleared";
-                else dtc = "None";
+    // Listen-only: reassembles the ECUs' responses to the tester
+    ISOTPEngine diag{ECU_COUNT, [](const struct can_frame &) {}};
+};
+
+// UDS response seen by the dashboard; the first failing DTC is the active one
+void dashboard_diag(Dashboard &d, const uint8_t *resp, size_t len) {
+    if (resp[0] == 0x59) {
+        d.dtc = "None";
+        for (size_t i = 3; i + 4 <= len; i += 4)
+            if (resp[i + 3] & DTC_TEST_FAILED) {
+                d.dtc = "Active:" + decode_dtc(resp[i], resp[i + 1]);
+                break;
             }
+    }
+    else if (resp[0] == 0x54) d.dtc = "Cleared";
+    else d.dtc = "None";
+}
 
-            stringstream decoded;
-            decoded << "RPM=" << rpm << ",Temp=" << temp
-                    << "C,Gear=" << gear << ",WS=" << ws << ",DTC=" << dtc;
-
-            log << time_local_now() << "," << fixed << setprecision(6) << ts
-                << ",vcan0,0x" << hex << "," << (int)f.can_dlc << ","
-                << hex << "," << node << "," << decoded.str() << "\n";
-            log.flush();
-
-            // Readable terminal output
-            string dtc_code = "";
-            if (dtc.find("Active") != string::npos) dtc_code = dtc.substr(dtc.find(":") + 1);
-            string desc = dtc_description.count(dtc_code) ? dtc_description[dtc_code] : "Unknown Fault";
-
-            if (dtc.find("Active") != string::npos && last_state != "Active") {
-                cout << "\033[31m[FAULT]\033[0m " << time_local_now()
-                     << " | " << node << " | " << desc << " (" << dtc_code << ")\n";
-                last_state = "Active";
-            } 
-            else if (dtc == "Cleared" && last_state == "Active") {
-                cout << "\033[32m[RECOVERY]\033[0m " << time_local_now()
-                     << " | " << node << " | Fault cleared successfully\n";
-                last_state = "Cleared";
-            }
-        }
-        this_thread::sleep_for(chrono::milliseconds(50));
+unordered_map<string, string> dtc_description = {
+    {"P0217", "Engine Overheat"},
+    {"P0700", "Transmission System Fault"},
+    {"C1234", "ABS Wheel Speed Sensor Fault"}
+};
+
+void receiver_dashboard(Dashboard &d, const struct can_frame &f, uint64_t ts_ns) {
+    double ts = int64_t(ts_ns - d.start_ns) / 1e9;
+    string data_hex = data_to_hex(f);
+    uint32_t id = f.can_id & CAN_SFF_MASK;
+    string node = node_name(id);
+
+    if (id == 0x100) { d.rpm = f.data[0] | (f.data[1]<<8); d.temp = f.data[3]; }
+    else if (id == 0x120) { d.gear = f.data[0]; }
+    else if (id == 0x200) { d.ws = f.data[0] | (f.data[1]<<8); }
+    else if (id >= 0x7E8 && id <= 0x7EA) d.diag.receive(f, ts_ns);
+
+    stringstream decoded;
+    decoded << "RPM=" << d.rpm << ",Temp=" << d.temp
+            << "C,Gear=" << d.gear << ",WS=" << d.ws << ",DTC=" << d.dtc;
+
+    d.log << time_local(ts_ns) << "," << fixed << setprecision(6) << ts
+          << ",vcan0,0x" << hex << uppercase << id << nouppercase << dec << ","
+          << (int)f.can_dlc << "," << data_hex << "," << node << ","
+          << decoded.str() << "\n";
+
+    // Readable terminal output
+    string dtc_code = "";
+    if (d.dtc.find("Active") != string::npos) dtc_code = d.dtc.substr(d.dtc.find(":") + 1);
+    string desc = dtc_description.count(dtc_code) ? dtc_description[dtc_code] : "Unknown Fault";
+
+    if (d.dtc.find("Active") != string::npos && d.last_state != "Active") {
+        cout << "\033[31m[FAULT]\033[0m " << time_local(ts_ns)
+             << " | " << node << " | " << desc << " (" << dtc_code << ")\n";
+        d.last_state = "Active";
+    } 
+    else if (d.dtc == "Cleared" && d.last_state == "Active") {
+        cout << "\033[32m[RECOVERY]\033[0m " << time_local(ts_ns)
+             << " | " << node << " | Fault cleared successfully\n";
+        d.last_state = "Cleared";
     }
-    log.close();
-    close(s);
 }
 
-void sigint_handler(int){ running = false; }
+CANReactor *reactor = nullptr;
+
+void sigint_handler(int){ if (reactor) reactor->stop(); }
 
 int main() {
     signal(SIGINT, sigint_handler);
     string iface = "vcan0";
 
-    thread t1(engine_ecu, iface);
-    thread t2(transmission_ecu, iface);
-    thread t3(abs_ecu, iface);
-    thread t4(diag_responder, iface);
-    thread t5(diag_tester, iface);
-    thread t6(receiver_dashboard, iface);
+    // One epoll loop owns every ECU, responder, tester and dashboard socket
+    CANReactor loop;
+    reactor = &loop;
+
+    int engine = open_can_socket_nonblocking(iface);
+    int trans = open_can_socket_nonblocking(iface);
+    int abs_s = open_can_socket_nonblocking(iface);
+    int responder = open_can_socket_nonblocking(iface);
+    int dashboard = open_can_socket_nonblocking(iface);
+    int tester = open_can_socket_nonblocking(iface);
+    if (engine < 0 || trans < 0 || abs_s < 0 || responder < 0 || dashboard < 0 || tester < 0) {
+        perror("CAN socket");
+        return 1;
+    }
+
+    // Diagnostic server for all three ECUs on one socket
+    ISOTPEngine diag(ECU_COUNT, [responder](const struct can_frame &f) { write(responder, &f, sizeof(f)); });
+    for (int ecu = 0; ecu < ECU_COUNT; ecu++)
+        diag.open(0x7E8 + ecu, 0x7E0 + ecu);
+    diag.onMessage = [&diag](int ecu, const uint8_t *req, size_t len) {
+        diag_responder(diag, ecu, req, len, monotonicNowNs());
+    };
+
+    // Tester: UDS client with one ISO-TP channel per ECU
+    UDSClient uds(ECU_COUNT, [tester](const struct can_frame &f) { write(tester, &f, sizeof(f)); });
+    for (int ecu = 0; ecu < ECU_COUNT; ecu++)
+        uds.addEcu(0x7E0 + ecu, 0x7E8 + ecu);
+
+    Dashboard dash;
+    for (int ecu = 0; ecu < ECU_COUNT; ecu++)
+        dash.diag.open(0x7E0 + ecu, 0x7E8 + ecu, true);
+    dash.diag.onMessage = [&dash](int, const uint8_t *resp, size_t len) { dashboard_diag(dash, resp, len); };
+    dash.log.open("vehicle_decoded_log.csv");
+    dash.log << "time_local,ts_mono,bus,can_id,dlc,data_hex,node,decoded_values\n";
+
+    loop.addTimer(chrono::milliseconds(100), [engine]() { engine_ecu_tick(engine); });
+    loop.addTimer(chrono::milliseconds(120), [trans]() { transmission_ecu_tick(trans); });
+    loop.addTimer(chrono::milliseconds(150), [abs_s]() { abs_ecu_tick(abs_s); });
+    loop.addReader(responder, [&diag](const struct can_frame &f, uint64_t ts_ns) { diag.receive(f, ts_ns); });
+    loop.addTimer(chrono::milliseconds(10), [&diag]() { diag.poll(monotonicNowNs()); });
+    loop.addReader(tester, [&uds](const struct can_frame &f, uint64_t ts_ns) { uds.receive(f, ts_ns); });
+    loop.addTimer(chrono::milliseconds(5), [&uds]() { uds.poll(monotonicNowNs()); });
+    loop.addTimer(chrono::seconds(2), [&uds]() { diag_cycle(uds); });
+    loop.addReader(dashboard, [&dash](const struct can_frame &f, uint64_t ts_ns) { receiver_dashboard(dash, f, ts_ns); });
+    loop.addTimer(chrono::milliseconds(500), [&dash]() { dash.log.flush(); });
 
     cout << "Vehicle CAN Simulation running on " << iface << endl;
     cout << "Press Ctrl+C to stop.\n";
 
-    t1.join(); t2.join(); t3.join(); t4.join(); t5.join(); t6.join();
+    loop.run();
+    print_diag_latency(uds);
+
+    close(engine); close(trans); close(abs_s);
+    dash.log.close();
     cout << "Simulation stopped." << endl;
     return 0;
 }
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+#include "can-capture.h"
+
+// Vector ASCII logs (.asc), classic CAN lines only:
+//    0.001000 1  123             Rx   d 8 11 22 33 44 55 66 77 88
+// Channels are 1-based (bus index + 1); extended IDs carry an 'x'.
+
+// "Sat Oct 17 02:05:52.622 pm 2026", local time
+inline size_t formatASCDate(int64_t wall_ns, char *out, size_t size) {
+    time_t sec = wall_ns / 1000000000;
+    tm t;
+    localtime_r(&sec, &t);
+    char hms[32];
+    strftime(hms, sizeof(hms), "%a %b %d %I:%M:%S", &t);
+    return snprintf(out, size, "%s.%03d %s %d", hms, int(wall_ns / 1000000 % 1000),
+                    t.tm_hour < 12 ? "am" : "pm", t.tm_year + 1900);
+}
+
+// Inverse of formatASCDate; also takes 24-hour times and no milliseconds.
+// Returns 0 if the text is not a date.
+inline int64_t parseASCDate(const char *s) {
+    static const char *MONTHS = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    char wday[8], mon[8], hms[32], ampm[8] = "";
+    int day, year = 0;
+    int n = sscanf(s, "%7s %7s %d %31s %7s %d", wday, mon, &day, hms, ampm, &year);
+    if (n < 5) return 0;
+    if (n == 5) {       // no am/pm: the fifth field was the year
+        year = atoi(ampm);
+        ampm[0] = 0;
+    }
+    const char *m = strstr(MONTHS, mon);
+    int hour = 0, min = 0, sec = 0, ms = 0;
+    if (!m || sscanf(hms, "%d:%d:%d.%d", &hour, &min, &sec, &ms) < 3) return 0;
+
+    tm t{};
+    t.tm_year = year - 1900;
+    t.tm_mon = (m - MONTHS) / 3;
+    t.tm_mday = day;
+    if (ampm[0])
+        hour = hour % 12 + (ampm[0] == 'p' || ampm[0] == 'P' ? 12 : 0);
+    t.tm_hour = hour;
+    t.tm_min = min;
+    t.tm_sec = sec;
+    t.tm_isdst = -1;
+    return int64_t(mktime(&t)) * 1000000000 + int64_t(ms) * 1000000;
+}
+
+class ASCWriter {
+public:
+    // The header keeps milliseconds, so offsets are taken from the same
+    ASCWriter(const char *path, int64_t startNs) : start(startNs - startNs % 1000000), buffer(1 << 20) {
+        file = fopen(path, "w");
+        if (!file) { perror(path); return; }
+        setvbuf(file, buffer.data(), _IOFBF, buffer.size());
+        char date[64];
+        formatASCDate(start, date, sizeof(date));
+        fprintf(file, "date %s\nbase hex  timestamps absolute\ninternal events logged\n"
+                      "// version 8.0.0\nBegin Triggerblock %s\n   0.000000 Start of measurement\n",
+                date, date);
+    }
+
+    ~ASCWriter() { close(); }
+
+    ASCWriter(const ASCWriter &) = delete;
+    ASCWriter &operator=(const ASCWriter &) = delete;
+
+    bool write(const CANCaptureRecord &r) {
+        if (!file) return false;
+        char line[128];
+        int len = snprintf(line, sizeof(line), "%11.6f %d  ", (r.ts_ns - start) / 1e9, r.bus + 1);
+        if (r.flags & CAN_CAPTURE_ERROR) {
+            len += snprintf(line + len, sizeof(line) - len, "ErrorFrame\n");
+        } else {
+            char id[16];
+            snprintf(id, sizeof(id), r.flags & CAN_CAPTURE_EXTENDED ? "%Xx" : "%X", r.id);
+            len += snprintf(line + len, sizeof(line) - len, "%-15s Rx   %c %X", id,
+                            r.flags & CAN_CAPTURE_RTR ? 'r' : 'd', r.dlc);
+            if (!(r.flags & CAN_CAPTURE_RTR))
+                for (int i = 0; i < r.dlc && i < 8; i++)
+                    len += snprintf(line + len, sizeof(line) - len, " %02X", r.data[i]);
+            line[len++] = '\n';
+        }
+        return fwrite(line, 1, len, file) == size_t(len);
+    }
+
+    bool close() {
+        if (!file) return false;
+        fputs("End TriggerBlock\n", file);
+        bool ok = fclose(file) == 0;
+        file = nullptr;
+        return ok;
+    }
+
+    bool ok() const { return file != nullptr; }
+
+private:
+    FILE *file = nullptr;
+    int64_t start;
+    std::vector<char> buffer;
+};
+
+// Line-by-line reader; unknown lines (CAN FD, statistics, comments) are
+// skipped and counted.
+class ASCReader {
+public:
+    explicit ASCReader(const char *path) : buffer(1 << 20) {
+        file = fopen(path, "r");
+        if (!file) { perror(path); return; }
+        setvbuf(file, buffer.data(), _IOFBF, buffer.size());
+    }
+
+    ~ASCReader() { if (file) fclose(file); }
+
+    ASCReader(const ASCReader &) = delete;
+    ASCReader &operator=(const ASCReader &) = delete;
+
+    bool ok() const { return file != nullptr; }
+    int64_t startNs() const { return start; }
+    uint64_t skipped = 0;       // lines that were not classic CAN events
+
+    // Call f(const CANCaptureRecord &) for every frame, in file order
+    template <typename F>
+    void forEach(F &&f) {
+        if (!file) return;
+        char line[512];
+        double last = 0;
+        while (fgets(line, sizeof(line), file)) {
+            const char *p = line;
+            while (*p == ' ' || *p == '\t') p++;
+            if (strncmp(p, "date ", 5) == 0) {
+                start = parseASCDate(p + 5);
+                continue;
+            }
+            if (strncmp(p, "base ", 5) == 0) {
+                hex = strncmp(p + 5, "hex", 3) == 0;
+                relative = strstr(p, "relative") != nullptr;
+                continue;
+            }
+
+            CANCaptureRecord r{};
+            double ts;
+            bool event = false;
+            if (!parseEvent(p, ts, r, event)) {
+                if (event) skipped++;
+                continue;
+            }
+            if (relative) ts = last += ts;
+            r.ts_ns = start + int64_t(ts * 1e9 + 0.5);
+            f(r);
+        }
+    }
+
+private:
+    // event is set for timestamped bus lines, including ones we cannot parse
+    bool parseEvent(const char *p, double &ts, CANCaptureRecord &r, bool &event) const {
+        char *end;
+        ts = strtod(p, &end);
+        if (end == p || *end != ' ') return false;
+        while (*end == ' ') end++;
+        event = strncmp(end, "CANFD", 5) == 0;
+        long channel = strtol(end, &end, 10);
+        if (channel < 1 || *end != ' ') return false;       // also "Start of measurement"
+        event = true;
+        r.bus = channel - 1;
+        while (*end == ' ') end++;
+
+        if (strncmp(end, "ErrorFrame", 10) == 0) {
+            r.flags = CAN_CAPTURE_ERROR;
+            return true;
+        }
+        const char *id = end;
+        unsigned long v = strtoul(id, &end, hex ? 16 : 10);
+        if (end == id) return false;
+        if (*end == 'x' || *end == 'X') {
+            r.flags |= CAN_CAPTURE_EXTENDED;
+            end++;
+        }
+        r.id = v & (r.flags & CAN_CAPTURE_EXTENDED ? CAN_EFF_MASK : CAN_SFF_MASK);
+
+        char dir[8], type[4];
+        int used = 0;
+        if (sscanf(end, " %7s %3s%n", dir, type, &used) != 2 || type[1]) return false;
+        end += used;
+        if (type[0] == 'r' || type[0] == 'R') r.flags |= CAN_CAPTURE_RTR;
+        else if (type[0] != 'd' && type[0] != 'D') return false;
+
+        unsigned long dlc = strtoul(end, &end, 16);
+        r.dlc = dlc > 8 ? 8 : dlc;
+        if (r.flags & CAN_CAPTURE_RTR) return true;
+        for (int i = 0; i < r.dlc; i++) {
+            const char *b = end;
+            r.data[i] = strtoul(b, &end, 16);
+            if (end == b) return false;
+        }
+        return true;
+    }
+
+    FILE *file = nullptr;
+    std::vector<char> buffer;
+    int64_t start = 0;
+    bool hex = true;
+    bool relative = false;
+};
@@ -0,0 +1,404 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <vector>
+#include "can-capture.h"
+#ifdef CAN_LOG_ZLIB
+#include <zlib.h>
+#endif
+
+// Vector binary logs (.blf). Objects are packed into LOG_CONTAINER
+// objects of up to 128 KiB, which is what lets both sides stream: the
+// writer holds one container, the reader one container plus the tail of
+// an object split across two. Build with -DCAN_LOG_ZLIB -lz to read
+// (and write) zlib-compressed containers, as most Vector tools produce.
+//
+// Classic CAN objects only: CAN_MESSAGE, CAN_MESSAGE2 and CAN_ERROR_EXT.
+
+namespace blf {
+
+constexpr uint32_t HEADER_SIZE = 144;
+constexpr uint16_t CAN_MESSAGE = 1, LOG_CONTAINER = 10, CAN_ERROR_EXT = 73, CAN_MESSAGE2 = 86;
+constexpr uint32_t TIME_TEN_MICS = 1, TIME_ONE_NANS = 2;
+constexpr uint8_t DIR_TX = 0x01, REMOTE = 0x80;
+constexpr uint32_t EXTENDED_ID = 0x80000000;
+constexpr size_t CONTAINER_SIZE = 128 * 1024;
+
+#pragma pack(push, 1)
+struct SystemTime {
+    uint16_t year, month, dayOfWeek, day, hour, minute, second, milliseconds;
+};
+
+struct FileHeader {
+    char signature[4];          // "LOGG"
+    uint32_t headerSize;
+    uint8_t application[4];     // id, major, minor, build
+    uint8_t binLog[4];          // major, minor, build, patch
+    uint64_t fileSize;
+    uint64_t uncompressedSize;
+    uint32_t objectCount;
+    uint32_t objectsRead;
+    SystemTime start;
+    SystemTime stop;
+};
+
+struct ObjectHeader {
+    char signature[4];          // "LOBJ"
+    uint16_t headerSize;
+    uint16_t headerVersion;
+    uint32_t objectSize;        // header and payload, without padding
+    uint32_t objectType;
+};
+
+struct ObjectHeaderV1 {
+    uint32_t flags;             // TIME_*
+    uint16_t clientIndex;
+    uint16_t objectVersion;
+    uint64_t timestamp;         // since the file's start time
+};
+
+struct ContainerHeader {
+    uint16_t compression;       // 0 none, 2 zlib
+    uint8_t reserved1[6];
+    uint32_t uncompressedSize;
+    uint8_t reserved2[4];
+};
+
+struct CanMessage {
+    uint16_t channel;           // 1-based
+    uint8_t flags;              // DIR_TX, REMOTE
+    uint8_t dlc;
+    uint32_t id;                // EXTENDED_ID for 29-bit
+    uint8_t data[8];
+};
+
+struct CanErrorExt {
+    uint16_t channel;
+    uint16_t length;
+    uint32_t flags;
+    uint8_t ecc;
+    uint8_t position;
+    uint8_t dlc;
+    uint8_t reserved;
+    uint32_t frameLength;
+    uint32_t id;
+    uint16_t flagsExt;
+    uint16_t reserved2;
+    uint8_t data[8];
+};
+#pragma pack(pop)
+
+static_assert(sizeof(FileHeader) == 72, "BLF file header fields");
+static_assert(sizeof(ObjectHeader) + sizeof(ObjectHeaderV1) == 32, "BLF v1 object header");
+
+// SYSTEMTIME in local time, as Vector tools write it
+inline SystemTime systemTime(int64_t wall_ns) {
+    time_t sec = wall_ns / 1000000000;
+    tm t;
+    localtime_r(&sec, &t);
+    return SystemTime{uint16_t(t.tm_year + 1900), uint16_t(t.tm_mon + 1), uint16_t(t.tm_wday), uint16_t(t.tm_mday),
+                      uint16_t(t.tm_hour), uint16_t(t.tm_min), uint16_t(t.tm_sec),
+                      uint16_t(wall_ns / 1000000 % 1000)};
+}
+
+inline int64_t wallNs(const SystemTime &st) {
+    if (st.year == 0) return 0;
+    tm t{};
+    t.tm_year = st.year - 1900;
+    t.tm_mon = st.month - 1;
+    t.tm_mday = st.day;
+    t.tm_hour = st.hour;
+    t.tm_min = st.minute;
+    t.tm_sec = st.second;
+    t.tm_isdst = -1;
+    return int64_t(mktime(&t)) * 1000000000 + int64_t(st.milliseconds) * 1000000;
+}
+
+} // namespace blf
+
+class BLFWriter {
+public:
+    // zlib level for containers, 0 to store them; needs CAN_LOG_ZLIB
+    int compression = 0;
+
+    // SYSTEMTIME keeps milliseconds, so offsets are taken from the same
+    BLFWriter(const char *path, int64_t startNs) : start(startNs - startNs % 1000000) {
+        file = fopen(path, "wb");
+        if (!file) { perror(path); return; }
+        container.reserve(blf::CONTAINER_SIZE);
+        writeHeader(start);     // rewritten with sizes and counts on close
+    }
+
+    ~BLFWriter() { close(); }
+
+    BLFWriter(const BLFWriter &) = delete;
+    BLFWriter &operator=(const BLFWriter &) = delete;
+
+    bool write(const CANCaptureRecord &r) {
+        if (!file) return false;
+        uint64_t ts = r.ts_ns > start ? r.ts_ns - start : 0;
+        if (r.flags & CAN_CAPTURE_ERROR) {
+            blf::CanErrorExt e{};
+            e.channel = r.bus + 1;
+            e.dlc = r.dlc;
+            e.id = r.id | (r.flags & CAN_CAPTURE_EXTENDED ? blf::EXTENDED_ID : 0);
+            memcpy(e.data, r.data, 8);
+            append(blf::CAN_ERROR_EXT, ts, &e, sizeof(e));
+        } else {
+            blf::CanMessage m{};
+            m.channel = r.bus + 1;
+            m.flags = r.flags & CAN_CAPTURE_RTR ? blf::REMOTE : 0;
+            m.dlc = r.dlc;
+            m.id = r.id | (r.flags & CAN_CAPTURE_EXTENDED ? blf::EXTENDED_ID : 0);
+            memcpy(m.data, r.data, 8);
+            append(blf::CAN_MESSAGE, ts, &m, sizeof(m));
+        }
+        last = std::max(last, r.ts_ns);
+        return !failed;
+    }
+
+    bool close() {
+        if (!file) return false;
+        flushContainer();
+        fileSize = ftell(file);
+        rewind(file);
+        writeHeader(last ? last : start);
+        bool ok = !failed && fclose(file) == 0;
+        file = nullptr;
+        return ok;
+    }
+
+    bool ok() const { return file != nullptr; }
+
+private:
+    void append(uint16_t type, uint64_t ts, const void *payload, size_t len) {
+        blf::ObjectHeader h{{'L', 'O', 'B', 'J'}, 32, 1, uint32_t(32 + len), type};
+        blf::ObjectHeaderV1 v1{blf::TIME_ONE_NANS, 0, 0, ts};
+        if (container.size() + h.objectSize + 3 > blf::CONTAINER_SIZE) flushContainer();
+        const char *p = (const char *)&h;
+        container.insert(container.end(), p, p + sizeof(h));
+        p = (const char *)&v1;
+        container.insert(container.end(), p, p + sizeof(v1));
+        p = (const char *)payload;
+        container.insert(container.end(), p, p + len);
+        container.resize(container.size() + h.objectSize % 4);      // BLF padding rule
+        objects++;
+    }
+
+    void flushContainer() {
+        if (container.empty()) return;
+        const std::vector<char> *data = &container;
+        uint16_t method = 0;
+#ifdef CAN_LOG_ZLIB
+        if (compression > 0) {
+            uLongf len = compressBound(container.size());
+            packed.resize(len);
+            if (compress2((Bytef *)packed.data(), &len, (const Bytef *)container.data(), container.size(),
+                          compression) == Z_OK) {
+                packed.resize(len);
+                data = &packed;
+                method = 2;
+            }
+        }
+#endif
+        blf::ObjectHeader h{{'L', 'O', 'B', 'J'}, 16, 1,
+                            uint32_t(sizeof(h) + sizeof(blf::ContainerHeader) + data->size()), blf::LOG_CONTAINER};
+        blf::ContainerHeader c{method, {}, uint32_t(container.size()), {}};
+        static const char pad[4] = {};
+        if (fwrite(&h, sizeof(h), 1, file) != 1 || fwrite(&c, sizeof(c), 1, file) != 1 ||
+            fwrite(data->data(), 1, data->size(), file) != data->size() ||
+            fwrite(pad, 1, data->size() % 4, file) != data->size() % 4)
+            failed = true;
+        uncompressed += sizeof(h) + sizeof(c) + container.size();
+        container.clear();
+    }
+
+    void writeHeader(int64_t stop) {
+        char header[blf::HEADER_SIZE] = {};
+        blf::FileHeader h{};
+        memcpy(h.signature, "LOGG", 4);
+        h.headerSize = blf::HEADER_SIZE;
+        h.application[0] = 5;       // CANoe in Vector's application list
+        h.binLog[0] = 4;
+        h.binLog[1] = 7;
+        h.binLog[2] = 1;
+        h.fileSize = fileSize;
+        h.uncompressedSize = uncompressed + blf::HEADER_SIZE;
+        h.objectCount = objects;
+        h.start = blf::systemTime(start);
+        h.stop = blf::systemTime(stop);
+        memcpy(header, &h, sizeof(h));
+        if (fwrite(header, sizeof(header), 1, file) != 1) failed = true;
+        if (fileSize) fseek(file, 0, SEEK_END);
+    }
+
+    FILE *file = nullptr;
+    int64_t start;
+    int64_t last = 0;
+    std::vector<char> container;
+    std::vector<char> packed;
+    uint64_t fileSize = 0;
+    uint64_t uncompressed = 0;
+    uint32_t objects = 0;
+    bool failed = false;
+};
+
+class BLFReader {
+public:
+    explicit BLFReader(const char *path) {
+        file = fopen(path, "rb");
+        if (!file) { perror(path); return; }
+        blf::FileHeader h;
+        if (fread(&h, sizeof(h), 1, file) != 1 || memcmp(h.signature, "LOGG", 4) != 0) {
+            fprintf(stderr, "%s: not a BLF file\n", path);
+            fclose(file);
+            file = nullptr;
+            return;
+        }
+        start = blf::wallNs(h.start);
+        objectCount = h.objectCount;
+        fseek(file, h.headerSize, SEEK_SET);
+    }
+
+    ~BLFReader() { if (file) fclose(file); }
+
+    BLFReader(const BLFReader &) = delete;
+    BLFReader &operator=(const BLFReader &) = delete;
+
+    bool ok() const { return file != nullptr; }
+    int64_t startNs() const { return start; }
+    uint32_t objectCount = 0;   // from the file header, if the writer filled it in
+    uint64_t skipped = 0;       // objects of other types
+    uint64_t compressedSkipped = 0;     // containers we could not unpack
+
+    // Call f(const CANCaptureRecord &) for every CAN frame, in file order
+    template <typename F>
+    void forEach(F &&f) {
+        if (!file) return;
+        blf::ObjectHeader h;
+        while (findObject(h)) {
+            size_t payload = h.objectSize - sizeof(h);
+            if (h.objectType != blf::LOG_CONTAINER) {
+                skipped++;
+                fseek(file, payload + h.objectSize % 4, SEEK_CUR);
+                continue;
+            }
+            blf::ContainerHeader c;
+            if (payload < sizeof(c) || fread(&c, sizeof(c), 1, file) != 1) break;
+            raw.resize(payload - sizeof(c));
+            if (fread(raw.data(), 1, raw.size(), file) != raw.size()) break;
+            fseek(file, h.objectSize % 4, SEEK_CUR);
+            if (!unpack(c)) continue;
+            parse(f);
+        }
+    }
+
+private:
+    // Next top-level object; tolerates padding between objects
+    bool findObject(blf::ObjectHeader &h) {
+        char sig[4] = {};
+        for (int slack = 0; slack < 8; slack++) {
+            if (fread(sig, 1, 4, file) != 4) return false;
+            if (memcmp(sig, "LOBJ", 4) == 0) {
+                memcpy(h.signature, sig, 4);
+                return fread((char *)&h + 4, sizeof(h) - 4, 1, file) == 1 && h.objectSize >= sizeof(h);
+            }
+            fseek(file, -3, SEEK_CUR);
+        }
+        return false;
+    }
+
+    // Append the container's objects to what was left of the previous one
+    bool unpack(const blf::ContainerHeader &c) {
+        if (c.compression == 0) {
+            pending.insert(pending.end(), raw.begin(), raw.end());
+            return true;
+        }
+#ifdef CAN_LOG_ZLIB
+        if (c.compression == 2) {
+            size_t at = pending.size();
+            pending.resize(at + c.uncompressedSize);
+            uLongf len = c.uncompressedSize;
+            if (uncompress((Bytef *)&pending[at], &len, (const Bytef *)raw.data(), raw.size()) == Z_OK) {
+                pending.resize(at + len);
+                return true;
+            }
+            pending.resize(at);
+        }
+#endif
+        compressedSkipped++;
+        return false;
+    }
+
+    template <typename F>
+    void parse(F &f) {
+        size_t pos = 0;
+        while (true) {
+            // Objects start on the next "LOBJ" within a few bytes of padding
+            size_t found = pos;
+            while (found + 4 <= pending.size() && found < pos + 8 && memcmp(&pending[found], "LOBJ", 4) != 0) found++;
+            if (found + sizeof(blf::ObjectHeader) > pending.size()) break;
+            if (memcmp(&pending[found], "LOBJ", 4) != 0) {      // lost sync: drop the container
+                pos = pending.size();
+                break;
+            }
+            blf::ObjectHeader h;
+            memcpy(&h, &pending[found], sizeof(h));
+            if (h.objectSize < h.headerSize) { pos = pending.size(); break; }
+            if (found + h.objectSize > pending.size()) { pos = found; break; }     // continues in the next container
+            object(h, &pending[found], f);
+            pos = found + h.objectSize;
+        }
+        pending.erase(pending.begin(), pending.begin() + std::min(pos, pending.size()));
+    }
+
+    template <typename F>
+    void object(const blf::ObjectHeader &h, const char *obj, F &f) {
+        if (h.objectType != blf::CAN_MESSAGE && h.objectType != blf::CAN_MESSAGE2 &&
+            h.objectType != blf::CAN_ERROR_EXT) {
+            skipped++;
+            return;
+        }
+        // Version 1 and 2 headers both have flags first and the timestamp at 8
+        uint32_t flags;
+        uint64_t ts;
+        memcpy(&flags, obj + sizeof(h), 4);
+        memcpy(&ts, obj + sizeof(h) + 8, 8);
+        ts *= flags & blf::TIME_TEN_MICS ? 10000 : 1;
+        const char *body = obj + h.headerSize;
+        size_t len = h.objectSize - h.headerSize;
+
+        CANCaptureRecord r{};
+        r.ts_ns = start + int64_t(ts);
+        uint32_t id;
+        if (h.objectType == blf::CAN_ERROR_EXT) {
+            blf::CanErrorExt e{};
+            memcpy(&e, body, std::min(len, sizeof(e)));
+            r.bus = e.channel ? e.channel - 1 : 0;
+            r.flags = CAN_CAPTURE_ERROR;
+            r.dlc = std::min<uint8_t>(e.dlc, 8);
+            id = e.id;
+            memcpy(r.data, e.data, 8);
+        } else {
+            blf::CanMessage m{};
+            memcpy(&m, body, std::min(len, sizeof(m)));
+            r.bus = m.channel ? m.channel - 1 : 0;
+            r.flags = m.flags & blf::REMOTE ? CAN_CAPTURE_RTR : 0;
+            r.dlc = std::min<uint8_t>(m.dlc, 8);
+            id = m.id;
+            memcpy(r.data, m.data, 8);
+        }
+        if (id & blf::EXTENDED_ID) r.flags |= CAN_CAPTURE_EXTENDED;
+        r.id = id & (id & blf::EXTENDED_ID ? CAN_EFF_MASK : CAN_SFF_MASK);
+        f(r);
+    }
+
+    FILE *file = nullptr;
+    int64_t start = 0;
+    std::vector<char> raw;
+    std::vector<char> pending;
+};
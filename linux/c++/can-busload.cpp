@@ -1,12 +1,12 @@
 #include <iostream>
 #include <thread>
 #include <chrono>
-#include <iomanip>
-#include <fstream>
 #include <cstdlib>
 #include <ctime>
 #include <cstring>
 #include <atomic>
+#include <cerrno>
+#include <csignal>
 #include <vector>
 #include <unistd.h>
 #include <net/if.h>
@@ -14,6 +14,9 @@
 #include <sys/socket.h>
 #include <linux/can.h>
 #include <linux/can/raw.h>
+#include "can-rx.h"
+#include "can-tx.h"
+#include "can-log.h"
 
 using namespace std;
 
@@ -21,6 +24,11 @@ using namespace std;
 atomic<uint64_t> totalBits(0);
 atomic<uint64_t> frameBitsInSecond(0);
 
+// Set by Ctrl+C; every thread finishes its loop so the log is drained
+atomic<bool> stopRequested(false);
+
+void onSignal(int) { stopRequested = true; }
+
 // Setup CAN socket
 int setupCAN(const char *ifname) {
     int s;
@@ -42,26 +50,33 @@ void randomData(can_frame &frame) {
     frame.can_dlc = 8;
 }
 
-// Approx frame size in bits (SOF+ID+CRC+ACK+data, standard 11-bit ID)
-int frameSizeBits(const can_frame &frame) {
-    return 47 + frame.can_dlc*8;
+// Current bus load over the running one-second window
+double currentBusLoad() {
+    return (frameBitsInSecond.load()/500000.0)*100;
+}
+
+// Flush queued frames and add their bits to the bus load counters
+void flushAndCount(CANTransmitter &tx) {
+    uint64_t before = tx.sentBits;
+    if(tx.flush() < 0) perror("Write");
+    totalBits += tx.sentBits - before;
+    frameBitsInSecond += tx.sentBits - before;
 }
 
 // Sensor1: periodic every 1s
 void sensor1Thread(const char *ifname, double maxBusLoad) {
     int s = setupCAN(ifname);
+    CANTransmitter tx(s);
     can_frame frame{};
     frame.can_id = 0x101;
     srand(time(0)+1);
 
-    while(true) {
+    while(!stopRequested) {
         randomData(frame);
-        double busLoad = (totalBits.load()/500000.0)*100;
+        double busLoad = currentBusLoad();
         if(busLoad < maxBusLoad) {
-            if(write(s,&frame,sizeof(frame)) != sizeof(frame)) perror("Write");
-            uint64_t bits = frameSizeBits(frame);
-            totalBits += bits;
-            frameBitsInSecond += bits;
+            tx.queue(frame);
+            flushAndCount(tx);
         } else {
             cout << "[Sensor1] Throttled due to bus load: " << busLoad << "%\n";
         }
@@ -73,22 +88,21 @@ void sensor1Thread(const char *ifname, double maxBusLoad) {
 // Sensor2: event-triggered
 void sensor2Thread(const char *ifname, double maxBusLoad) {
     int s = setupCAN(ifname);
+    CANTransmitter tx(s);
     can_frame frame{};
     frame.can_id = 0x102;
     srand(time(0)+2);
     uint8_t lastValue = 0;
 
-    while(true) {
+    while(!stopRequested) {
         uint8_t newValue = rand()%256;
         if(newValue != lastValue) {
             frame.can_dlc = 1;
             frame.data[0] = newValue;
-            double busLoad = (totalBits.load()/500000.0)*100;
+            double busLoad = currentBusLoad();
             if(busLoad < maxBusLoad) {
-                if(write(s,&frame,sizeof(frame)) != sizeof(frame)) perror("Write");
-                uint64_t bits = frameSizeBits(frame);
-                totalBits += bits;
-                frameBitsInSecond += bits;
+                tx.queue(frame);
+                flushAndCount(tx);
             } else {
                 cout << "[Sensor2] Throttled due to bus load: " << busLoad << "%\n";
             }
@@ -99,73 +113,102 @@ void sensor2Thread(const char *ifname, double maxBusLoad) {
     close(s);
 }
 
+// Background traffic: paced sendmmsg bursts holding the bus at a target load
+void loadGeneratorThread(const char *ifname, double targetBusLoad) {
+    int s = setupCAN(ifname);
+    CANTransmitter tx(s);
+    tx.setBusLoad(targetBusLoad, 500000);
+    can_frame frame{};
+    frame.can_id = 0x300;
+    srand(time(0)+3);
+
+    while(!stopRequested) {
+        while(tx.pending() < tx.capacity()) {
+            randomData(frame);
+            tx.queue(frame);
+        }
+        flushAndCount(tx);
+    }
+    close(s);
+}
+
 // Dashboard receiver + logger
 void dashboardThread(const char *ifname) {
     int s = setupCAN(ifname);
-    can_frame frame{};
+    // Wake up every 100 ms to notice a stop request on a quiet bus
+    timeval timeout{0, 100000};
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    CANReceiver rx(s);
     cout << "[Dashboard] Listening on " << ifname << "...\n";
 
-    ofstream log("busload_log.csv");
-    log << "Timestamp,CAN_ID,DLC,PayloadBits,TotalBits,BusLoad,Data\n";
-
-    auto start = chrono::steady_clock::now();
-
-    while(true) {
-        int nbytes = read(s,&frame,sizeof(frame));
-        if(nbytes < 0) { perror("Read"); break; }
-
-        auto now = chrono::system_clock::now();
-        auto ms = chrono::duration_cast<chrono::milliseconds>(now.time_since_epoch())%1000;
-        time_t t = chrono::system_clock::to_time_t(now);
-        tm tm = *localtime(&t);
-        ostringstream timestamp;
-        timestamp << put_time(&tm,"%Y-%m-%d %H:%M:%S") << "." << setw(3) << setfill('0') << ms.count();
-
-        unsigned int id = frame.can_id & CAN_SFF_MASK;
-        int payloadBits = frame.can_dlc*8;
-        uint64_t totalBitsSnapshot = frameBitsInSecond.load();
-        double busLoad = (totalBitsSnapshot/500000.0)*100;
-
-        // Print to console
-        cout << "[" << timestamp.str() << "] "
-             << "ID=0x" << hex << id
-             << " DLC=" << dec << (int)frame.can_dlc
-             << " PayloadBits=" << payloadBits
-             << " TotalBits=" << totalBitsSnapshot
-             << " BusLoad=" << fixed << setprecision(2) << busLoad << "% "
-             << endl;
-
-        // Log to CSV
-        log << timestamp.str() << ",0x" << hex << id << ","
-            << dec << (int)frame.can_dlc << "," << payloadBits << ","
-            << totalBitsSnapshot << "," << fixed << setprecision(2) << busLoad << ",";
-        for(int i=0;i<frame.can_dlc;i++){
-            log << setw(2) << setfill('0') << hex << (int)frame.data[i];
-            if(i<frame.can_dlc-1) log << " ";
+    // Rows are formatted and written by the log's writer thread
+    CANLogWriter<CANBusLogRecord> log("busload_log.csv", CAN_BUS_LOG_HEADER, formatBusLog);
+
+    uint64_t windowStart = 0;
+    CANTextBuffer console;      // one write per receive batch
+
+    while(!stopRequested) {
+        int n = rx.receive();
+        if(n < 0) {
+            if(errno == EAGAIN || errno == EINTR) continue;
+            perror("Read");
+            break;
         }
-        log << "\n";
-        log.flush();
-
-        // Reset counters every second
-        auto elapsed = chrono::steady_clock::now() - start;
-        if(chrono::duration_cast<chrono::seconds>(elapsed).count() >= 1) {
-            frameBitsInSecond = 0;
-            start = chrono::steady_clock::now();
+
+        console.clear();
+        for (int k = 0; k < n; k++) {
+            const can_frame &frame = rx.frame(k);
+            unsigned int id = frame.can_id & CAN_SFF_MASK;
+            int payloadBits = frame.can_dlc*8;
+            uint64_t totalBitsSnapshot = frameBitsInSecond.load();
+            double busLoad = (totalBitsSnapshot/500000.0)*100;
+
+            // Print to console
+            char timestamp[32];
+            console.put('[').put(timestamp, formatLocalTime(rx.timestampNs(k), timestamp))
+                   .put("] ID=0x").hex(id, false)
+                   .put(" DLC=").dec(int(frame.can_dlc))
+                   .put(" PayloadBits=").dec(payloadBits)
+                   .put(" TotalBits=").dec(totalBitsSnapshot)
+                   .put(" BusLoad=").fixed(busLoad, 2).put("% \n");
+
+            log.push({rx.timestampNs(k), frame, totalBitsSnapshot});
+
+            // Reset counters every second (kernel RX time, not read time)
+            uint64_t ts = rx.timestampNs(k);
+            if(windowStart == 0) windowStart = ts;
+            if(ts - windowStart >= 1000000000ull) {
+                frameBitsInSecond = 0;
+                windowStart = ts;
+                if(log.dropped)
+                    cerr << "[Dashboard] Log ring high-water " << log.highWater << "/" << log.capacity()
+                         << ", " << log.dropped << " rows dropped\n";
+            }
         }
+        fwrite(console.data(), 1, console.size(), stdout);
+        fflush(stdout);
     }
+
+    log.stop();
+    cout << "[Dashboard] Log: " << log.written << " rows, " << log.dropped << " dropped, ring high-water "
+         << log.highWater << "/" << log.capacity() << endl;
     close(s);
 }
 
 int main() {
     const char *ifname = "vcan0";
+    signal(SIGINT, onSignal);
     double maxBusLoad = 50.0;
+    double backgroundLoad = 40.0;
 
     thread s1(sensor1Thread, ifname, maxBusLoad);
     thread s2(sensor2Thread, ifname, maxBusLoad);
+    thread load(loadGeneratorThread, ifname, backgroundLoad);
     thread dash(dashboardThread, ifname);
 
     s1.join();
     s2.join();
+    load.join();
     dash.join();
 
     return 0;
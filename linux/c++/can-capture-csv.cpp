@@ -0,0 +1,41 @@
+#include <iostream>
+#include <cstdio>
+#include <vector>
+#include "can-capture.h"
+
+using namespace std;
+
+// Converts a binary capture (.cancap, from can-csv or can-logger) to the
+// can_log.csv layout: Timestamp,CAN_ID,Type,DLC,Data.
+// For the decoded vehicle_decoded_log.csv layout use can-logger --convert.
+//
+// Usage: can-capture-csv <capture.cancap> [out.csv]
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        cerr << "Usage: " << argv[0] << " <capture.cancap> [out.csv]\n";
+        return 1;
+    }
+    const char *outPath = argc > 2 ? argv[2] : "can_log.csv";
+
+    CANCaptureReader in(argv[1]);
+    if (!in.ok()) return 1;
+    FILE *out = fopen(outPath, "w");
+    if (!out) { perror(outPath); return 1; }
+    vector<char> buf(1 << 20);
+    setvbuf(out, buf.data(), _IOFBF, buf.size());
+
+    fputs("Timestamp,CAN_ID,Type,DLC,Data\n", out);
+    uint64_t rows = 0;
+    in.forEach([&](const CANCaptureRecord &r) {
+        char line[80];
+        fwrite(line, 1, formatCaptureRow(r, line), out);
+        rows++;
+    });
+
+    if (fclose(out) != 0) { perror(outPath); return 1; }
+    cout << rows << " frames written to " << outPath;
+    if (in.damaged) cout << " (" << in.damaged << " damaged records skipped)";
+    cout << endl;
+    return 0;
+}
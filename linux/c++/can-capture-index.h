@@ -0,0 +1,256 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "can-capture.h"
+
+// Side index for .cancap files (<capture>.idx): one entry per capture
+// block with its exact time range and a 2048-bit ID bitmap, so a query
+// touches only the blocks that can match. The index is mapped when it is
+// current, extended when the capture has grown since, and rebuilt when it
+// belongs to another capture.
+
+constexpr char CAN_INDEX_MAGIC[8] = {'C', 'A', 'N', 'I', 'D', 'X', '\r', '\n'};
+constexpr uint16_t CAN_INDEX_VERSION = 1;
+
+struct CANIndexHeader {
+    char magic[8];
+    uint16_t version;
+    uint16_t entrySize;         // sizeof(CANIndexEntry)
+    uint32_t reserved;
+    int64_t captureStartNs;     // CANCaptureHeader::startNs of the indexed capture
+    uint64_t indexedBytes;      // capture bytes covered by complete blocks
+    uint64_t entryCount;
+};
+
+struct CANIndexEntry {
+    uint64_t offset;            // of the block header in the capture
+    int64_t minNs, maxNs;       // record time range (records need not be sorted)
+    int64_t prefixMaxNs;        // max of maxNs over this and earlier entries
+    int64_t suffixMinNs;        // min of minNs over this and later entries
+    uint32_t minId, maxId;
+    uint16_t count;
+    uint8_t busMask;
+    uint8_t reserved[5];
+    // Standard IDs set their own bit; extended IDs set a hashed one
+    uint64_t idBits[32];
+};
+
+static_assert(sizeof(CANIndexHeader) == 40, "index header is 40 bytes");
+static_assert(sizeof(CANIndexEntry) == 312, "index entries are 312 bytes");
+
+inline uint32_t canIndexBit(uint32_t id, bool extended) {
+    return extended ? (id * 0x9E3779B1u) >> 21 : id;
+}
+
+// Frames to return; time bounds are inclusive, CLOCK_REALTIME
+struct CANCaptureQuery {
+    int64_t fromNs = INT64_MIN;
+    int64_t toNs = INT64_MAX;
+    std::vector<uint32_t> ids;  // any of these (standard or extended); empty for all
+    int bus = -1;               // -1 for all
+
+    bool matches(const CANCaptureRecord &r) const {
+        if (r.ts_ns < fromNs || r.ts_ns > toNs) return false;
+        if (bus >= 0 && r.bus != bus) return false;
+        return ids.empty() || std::find(ids.begin(), ids.end(), r.id) != ids.end();
+    }
+
+    bool mayMatch(const CANIndexEntry &e) const {
+        if (e.maxNs < fromNs || e.minNs > toNs) return false;
+        if (bus >= 0 && !(e.busMask & (1u << (bus & 7)))) return false;
+        if (ids.empty()) return true;
+        for (uint32_t id : ids) {
+            if (id < e.minId || id > e.maxId) continue;
+            uint32_t sff = canIndexBit(id, false), eff = canIndexBit(id, true);
+            if ((id <= CAN_SFF_MASK && (e.idBits[sff / 64] >> (sff % 64) & 1)) ||
+                (e.idBits[eff / 64] >> (eff % 64) & 1))
+                return true;
+        }
+        return false;
+    }
+};
+
+class CANCaptureIndex {
+public:
+    enum class Source { Loaded, Extended, Built };
+
+    // Open a capture and its <path>.idx, building or extending the index
+    // as needed and writing it back (failures to write are not fatal)
+    explicit CANCaptureIndex(const char *path)
+        : capture(path, MADV_RANDOM), idxPath(std::string(path) + ".idx") {
+        if (!capture.ok()) return;
+        if (capture.size() < sizeof(CANCaptureHeader)) { bad(path); return; }
+        memcpy(&hdr, capture.data(), sizeof(hdr));
+        if (memcmp(hdr.magic, CAN_CAPTURE_MAGIC, 8) != 0 || hdr.recordSize != sizeof(CANCaptureRecord) ||
+            hdr.headerSize < sizeof(hdr) || hdr.headerSize % alignof(CANCaptureRecord)) {
+            bad(path);
+            return;
+        }
+        valid = true;
+        if (load()) return;
+        extend();
+        save();
+    }
+
+    CANCaptureIndex(const CANCaptureIndex &) = delete;
+    CANCaptureIndex &operator=(const CANCaptureIndex &) = delete;
+
+    bool ok() const { return valid; }
+    const CANCaptureHeader &header() const { return hdr; }
+    Source source() const { return how; }
+    size_t blockCount() const { return count; }
+
+    // Call f(const CANCaptureRecord &) for each matching record, in file
+    // order. Returns the number of blocks read.
+    template <typename F>
+    size_t query(const CANCaptureQuery &q, F &&f) const {
+        // prefixMaxNs and suffixMinNs never decrease, so both ends of the
+        // candidate range are binary searches
+        const CANIndexEntry *first = std::partition_point(entries, entries + count,
+            [&](const CANIndexEntry &e) { return e.prefixMaxNs < q.fromNs; });
+        const CANIndexEntry *last = std::partition_point(first, entries + count,
+            [&](const CANIndexEntry &e) { return e.suffixMinNs <= q.toNs; });
+        size_t read = 0;
+        for (const CANIndexEntry *e = first; e < last; e++) {
+            if (!q.mayMatch(*e)) continue;
+            read++;
+            const CANCaptureRecord *r = records(*e);
+            for (uint16_t i = 0; i < e->count; i++)
+                if (q.matches(r[i])) f(r[i]);
+        }
+        return read;
+    }
+
+private:
+    void bad(const char *path) { fprintf(stderr, "%s: not a CAN capture file\n", path); }
+
+    const CANCaptureRecord *records(const CANIndexEntry &e) const {
+        return reinterpret_cast<const CANCaptureRecord *>(capture.data() + e.offset + sizeof(CANCaptureBlock));
+    }
+
+    // Map the index if it covers exactly this capture; otherwise keep its
+    // entries as a starting point when the capture only grew
+    bool load() {
+        if (access(idxPath.c_str(), R_OK) != 0) return false;
+        mapped.reset(new CANMappedFile(idxPath.c_str(), MADV_WILLNEED));
+        if (!mapped->ok() || mapped->size() < sizeof(CANIndexHeader)) return false;
+        CANIndexHeader h;
+        memcpy(&h, mapped->data(), sizeof(h));
+        if (memcmp(h.magic, CAN_INDEX_MAGIC, 8) != 0 || h.version != CAN_INDEX_VERSION ||
+            h.entrySize != sizeof(CANIndexEntry) || h.captureStartNs != hdr.startNs ||
+            h.indexedBytes > capture.size() ||
+            mapped->size() != sizeof(h) + h.entryCount * sizeof(CANIndexEntry))
+            return false;
+
+        entries = reinterpret_cast<const CANIndexEntry *>(mapped->data() + sizeof(h));
+        count = h.entryCount;
+        indexedBytes = h.indexedBytes;
+        if (indexedBytes == capture.size()) return true;
+
+        // Entries past indexedBytes describe a block that was still being
+        // written; drop them and index from there
+        size_t keep = 0;
+        while (keep < count && entries[keep].offset < indexedBytes) keep++;
+        built.assign(entries, entries + keep);
+        how = Source::Extended;
+        return false;
+    }
+
+    void extend() {
+        size_t pos = indexedBytes ? indexedBytes : hdr.headerSize;
+        capture.advise(MADV_SEQUENTIAL);
+        while (pos + sizeof(CANCaptureBlock) <= capture.size()) {
+            CANCaptureBlock blk;
+            memcpy(&blk, capture.data() + pos, sizeof(blk));
+            if (blk.magic != CAN_CAPTURE_BLOCK_MAGIC) {
+                fprintf(stderr, "Capture: bad block header at offset %zu\n", pos);
+                break;
+            }
+            size_t avail = (capture.size() - pos - sizeof(blk)) / sizeof(CANCaptureRecord);
+            uint16_t n = std::min<size_t>(blk.count, avail);
+            if (n == 0) break;
+
+            CANIndexEntry e{};
+            e.offset = pos;
+            e.count = n;
+            e.minNs = INT64_MAX;
+            e.maxNs = INT64_MIN;
+            e.minId = UINT32_MAX;
+            const CANCaptureRecord *r = reinterpret_cast<const CANCaptureRecord *>(capture.data() + pos + sizeof(blk));
+            for (uint16_t i = 0; i < n; i++) {
+                e.minNs = std::min(e.minNs, r[i].ts_ns);
+                e.maxNs = std::max(e.maxNs, r[i].ts_ns);
+                e.minId = std::min(e.minId, r[i].id);
+                e.maxId = std::max(e.maxId, r[i].id);
+                e.busMask |= 1u << (r[i].bus & 7);
+                uint32_t bit = canIndexBit(r[i].id, r[i].flags & CAN_CAPTURE_EXTENDED);
+                e.idBits[bit / 64] |= 1ull << (bit % 64);
+            }
+            built.push_back(e);
+            pos += sizeof(blk) + size_t(n) * sizeof(CANCaptureRecord);
+            // Only whole blocks count as indexed
+            if (n == blk.count) indexedBytes = pos;
+        }
+        capture.advise(MADV_RANDOM);
+
+        for (size_t i = 0; i < built.size(); i++)
+            built[i].prefixMaxNs = std::max(built[i].maxNs, i ? built[i - 1].prefixMaxNs : INT64_MIN);
+        for (size_t i = built.size(); i-- > 0;)
+            built[i].suffixMinNs = std::min(built[i].minNs, i + 1 < built.size() ? built[i + 1].suffixMinNs : INT64_MAX);
+        entries = built.data();
+        count = built.size();
+        mapped.reset();
+        if (how != Source::Extended) how = Source::Built;
+    }
+
+    // Write the index atomically (temp file + rename)
+    void save() const {
+        CANIndexHeader h{};
+        memcpy(h.magic, CAN_INDEX_MAGIC, 8);
+        h.version = CAN_INDEX_VERSION;
+        h.entrySize = sizeof(CANIndexEntry);
+        h.captureStartNs = hdr.startNs;
+        h.indexedBytes = indexedBytes;
+        h.entryCount = count;
+
+        std::string tmp = idxPath + ".tmp" + std::to_string(getpid());
+        int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return;
+        bool ok = writeAll(fd, &h, sizeof(h)) && writeAll(fd, entries, count * sizeof(CANIndexEntry));
+        ok = close(fd) == 0 && ok;
+        if (!ok || rename(tmp.c_str(), idxPath.c_str()) != 0) unlink(tmp.c_str());
+    }
+
+    static bool writeAll(int fd, const void *data, size_t left) {
+        const char *p = static_cast<const char *>(data);
+        while (left > 0) {
+            ssize_t n = write(fd, p, left);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            p += n;
+            left -= n;
+        }
+        return true;
+    }
+
+    CANMappedFile capture;
+    std::string idxPath;
+    CANCaptureHeader hdr{};
+    bool valid = false;
+    Source how = Source::Loaded;
+
+    std::unique_ptr<CANMappedFile> mapped;
+    std::vector<CANIndexEntry> built;
+    const CANIndexEntry *entries = nullptr;
+    size_t count = 0;
+    uint64_t indexedBytes = 0;
+};
@@ -0,0 +1,380 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <linux/can.h>
+#include "can-log.h"
+
+// Binary capture file (.cancap): a file header, then blocks of fixed
+// 24-byte frame records, each block led by a small header summarising
+// its time range, ID range and buses so readers can skip whole blocks.
+// All fields are little-endian, as written by the capturing machine.
+
+constexpr char CAN_CAPTURE_MAGIC[8] = {'C', 'A', 'N', 'C', 'A', 'P', '\r', '\n'};
+constexpr uint32_t CAN_CAPTURE_BLOCK_MAGIC = 0x4B4C4243;   // "CBLK"
+constexpr uint16_t CAN_CAPTURE_VERSION = 1;
+constexpr int CAN_CAPTURE_MAX_BUSES = 8;
+
+// CANCaptureRecord::flags
+constexpr uint8_t CAN_CAPTURE_EXTENDED = 0x01;
+constexpr uint8_t CAN_CAPTURE_RTR = 0x02;
+constexpr uint8_t CAN_CAPTURE_ERROR = 0x04;
+
+struct CANCaptureHeader {
+    char magic[8];
+    uint16_t version;
+    uint16_t headerSize;        // bytes before the first block
+    uint16_t recordSize;        // sizeof(CANCaptureRecord)
+    uint16_t busCount;
+    int64_t startNs;            // capture start, CLOCK_REALTIME
+    char buses[CAN_CAPTURE_MAX_BUSES][16];     // interface names, by bus index
+};
+
+struct CANCaptureBlock {
+    uint32_t magic;             // CAN_CAPTURE_BLOCK_MAGIC
+    uint16_t count;             // records that follow
+    uint8_t busMask;            // bit per bus index present
+    uint8_t reserved;
+    int64_t firstNs;            // CLOCK_REALTIME of the first and last record
+    int64_t lastNs;
+    uint32_t minId;             // ID range, flags stripped
+    uint32_t maxId;
+};
+
+struct CANCaptureRecord {
+    int64_t ts_ns;              // kernel RX time, CLOCK_REALTIME nanoseconds
+    uint32_t id;                // 11- or 29-bit identifier, no flag bits
+    uint8_t bus;
+    uint8_t flags;              // CAN_CAPTURE_*
+    uint8_t dlc;
+    uint8_t reserved;
+    uint8_t data[8];
+
+    static CANCaptureRecord from(const can_frame &f, int64_t wallNs, uint8_t bus) {
+        CANCaptureRecord r;
+        r.ts_ns = wallNs;
+        r.id = f.can_id & (f.can_id & CAN_EFF_FLAG ? CAN_EFF_MASK : CAN_SFF_MASK);
+        r.bus = bus;
+        r.flags = (f.can_id & CAN_EFF_FLAG ? CAN_CAPTURE_EXTENDED : 0) |
+                  (f.can_id & CAN_RTR_FLAG ? CAN_CAPTURE_RTR : 0) |
+                  (f.can_id & CAN_ERR_FLAG ? CAN_CAPTURE_ERROR : 0);
+        r.dlc = std::min<uint8_t>(f.can_dlc, 8);
+        r.reserved = 0;
+        memcpy(r.data, f.data, 8);
+        return r;
+    }
+
+    can_frame frame() const {
+        can_frame f{};
+        f.can_id = id | (flags & CAN_CAPTURE_EXTENDED ? CAN_EFF_FLAG : 0) |
+                   (flags & CAN_CAPTURE_RTR ? CAN_RTR_FLAG : 0) | (flags & CAN_CAPTURE_ERROR ? CAN_ERR_FLAG : 0);
+        f.can_dlc = std::min<uint8_t>(dlc, 8);
+        memcpy(f.data, data, 8);
+        return f;
+    }
+};
+
+static_assert(sizeof(CANCaptureRecord) == 24, "capture records are 24 bytes");
+static_assert(sizeof(CANCaptureBlock) == 32, "block headers are 32 bytes");
+
+// A record as a can_log.csv row (Timestamp,CAN_ID,Type,DLC,Data) with its
+// newline; at most 80 bytes, since a damaged DLC is clamped to 8
+inline size_t formatCaptureRow(const CANCaptureRecord &r, char *out) {
+    int n = std::min<int>(r.dlc, 8);
+    size_t len = formatWallTime(r.ts_ns, out);
+    memcpy(out + len, ",0x", 3);
+    len += 3;
+    len += formatHex(r.id, out + len);
+    bool isExtended = r.flags & CAN_CAPTURE_EXTENDED;
+    memcpy(out + len, isExtended ? ",Extended," : ",Standard,", 10);
+    len += 10;
+    out[len++] = '0' + n;
+    out[len++] = ',';
+    len += formatBytes(r.data, n, out + len);
+    out[len++] = '\n';
+    return len;
+}
+
+// Capture file writer. Like CANLogWriter, the receive thread only copies
+// a record into a CANRing; a writer thread collects up to blockRecords of
+// them and writes header and records with one writev(2). A partial block
+// is written once the ring has been empty for flushIntervalNs.
+class CANCaptureWriter {
+public:
+    CANLogSync sync = CANLogSync::Interval;
+    uint64_t syncIntervalNs = 1000000000ull;
+    uint64_t flushIntervalNs = 200000000ull;
+
+    // buses: interface name per bus index, at most CAN_CAPTURE_MAX_BUSES;
+    // startNs (CLOCK_REALTIME) defaults to now
+    CANCaptureWriter(const char *path, const std::vector<const char *> &buses,
+                     size_t ringRecords = 65536, uint16_t blockRecords = 4096, int64_t startNs = 0)
+        : ring(ringRecords), block(std::max<uint16_t>(blockRecords, 1)) {
+        fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) { perror(path); return; }
+        opened = true;
+
+        CANCaptureHeader h{};
+        memcpy(h.magic, CAN_CAPTURE_MAGIC, sizeof(h.magic));
+        h.version = CAN_CAPTURE_VERSION;
+        h.headerSize = sizeof(h);
+        h.recordSize = sizeof(CANCaptureRecord);
+        h.busCount = std::min<size_t>(buses.size(), CAN_CAPTURE_MAX_BUSES);
+        h.startNs = startNs ? startNs : clock.toWall(monotonicNowNs());
+        for (int i = 0; i < h.busCount; i++)
+            strncpy(h.buses[i], buses[i], sizeof(h.buses[i]) - 1);
+        if (write(fd, &h, sizeof(h)) != ssize_t(sizeof(h))) writeErrors++;
+        writer = std::thread([this] { run(); });
+    }
+
+    ~CANCaptureWriter() { stop(); }
+
+    CANCaptureWriter(const CANCaptureWriter &) = delete;
+    CANCaptureWriter &operator=(const CANCaptureWriter &) = delete;
+
+    // Receive thread only; ts_ns is the kernel RX time (CLOCK_MONOTONIC).
+    // False if the ring was full and the frame dropped.
+    bool push(const can_frame &f, uint64_t ts_ns, uint8_t bus = 0) {
+        return push(CANCaptureRecord::from(f, clock.toWall(ts_ns), bus));
+    }
+
+    // A record that already has its wall-clock time, e.g. from another log
+    bool push(const CANCaptureRecord &r) {
+        if (!ring.push(r)) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        size_t used = ring.size();
+        if (used > highWater.load(std::memory_order_relaxed))
+            highWater.store(used, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Drain the ring, write the last block, sync and close
+    void stop() {
+        stopping = true;
+        if (writer.joinable()) writer.join();
+        if (fd >= 0) {
+            if (sync != CANLogSync::None && fdatasync(fd) != 0) writeErrors++;
+            if (close(fd) != 0) writeErrors++;
+            fd = -1;
+        }
+    }
+
+    bool ok() const { return opened; }
+    size_t capacity() const { return ring.capacity(); }
+    size_t queued() const { return ring.size(); }
+
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> highWater{0};
+    std::atomic<uint64_t> written{0};       // records written
+    std::atomic<uint64_t> blocks{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> writeErrors{0};
+
+private:
+    void run() {
+        uint64_t lastSync = monotonicNowNs();
+        uint64_t blockStart = 0;
+        size_t n = 0;
+        while (true) {
+            bool last = stopping.load();
+            const CANCaptureRecord *batch;
+            size_t got = ring.peek(batch, block.size() - n);
+            if (got && !n) blockStart = monotonicNowNs();
+            std::copy(batch, batch + got, block.begin() + n);
+            ring.release(got);
+            n += got;
+
+            uint64_t now = monotonicNowNs();
+            bool dry = ring.size() == 0;
+            if (n == block.size() || (n && dry && (last || now - blockStart >= flushIntervalNs))) {
+                writeBlock(n);
+                n = 0;
+                if (sync == CANLogSync::EveryBatch ||
+                    (sync == CANLogSync::Interval && now - lastSync >= syncIntervalNs)) {
+                    fdatasync(fd);
+                    lastSync = now;
+                }
+            }
+            if (got == 0) {
+                if (last && n == 0) break;
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+        }
+    }
+
+    void writeBlock(size_t n) {
+        CANCaptureBlock b{};
+        b.magic = CAN_CAPTURE_BLOCK_MAGIC;
+        b.count = n;
+        b.firstNs = block[0].ts_ns;
+        b.lastNs = block[0].ts_ns;
+        b.minId = b.maxId = block[0].id;
+        for (size_t i = 0; i < n; i++) {
+            const CANCaptureRecord &r = block[i];
+            b.firstNs = std::min(b.firstNs, r.ts_ns);
+            b.lastNs = std::max(b.lastNs, r.ts_ns);
+            b.minId = std::min(b.minId, r.id);
+            b.maxId = std::max(b.maxId, r.id);
+            b.busMask |= 1u << (r.bus & 7);
+        }
+
+        iovec iov[2] = {{&b, sizeof(b)}, {block.data(), n * sizeof(CANCaptureRecord)}};
+        size_t total = iov[0].iov_len + iov[1].iov_len;
+        ssize_t w;
+        do w = writev(fd, iov, 2); while (w < 0 && errno == EINTR);
+        if (w < 0) { perror("capture write"); writeErrors++; return; }
+        if (size_t(w) < total) {
+            // Short write (disk full, signal): finish the block with plain writes
+            size_t done = w;
+            for (auto &v : iov) {
+                if (done >= v.iov_len) { done -= v.iov_len; continue; }
+                if (!writeAll((const char *)v.iov_base + done, v.iov_len - done)) return;
+                done = 0;
+            }
+        }
+        blocks.fetch_add(1, std::memory_order_relaxed);
+        written.fetch_add(n, std::memory_order_relaxed);
+        bytes.fetch_add(total, std::memory_order_relaxed);
+    }
+
+    bool writeAll(const char *p, size_t len) {
+        while (len) {
+            ssize_t w = write(fd, p, len);
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                perror("capture write");
+                writeErrors++;
+                return false;
+            }
+            p += w;
+            len -= w;
+        }
+        return true;
+    }
+
+    CANRing<CANCaptureRecord> ring;
+    std::vector<CANCaptureRecord> block;
+    CANWallClock clock;         // producer side
+    int fd = -1;
+    bool opened = false;
+    std::atomic<bool> stopping{false};
+    std::thread writer;
+};
+
+// Read-only mapping of a whole file
+class CANMappedFile {
+public:
+    // advice is an madvise() hint for the access pattern
+    explicit CANMappedFile(const char *path, int advice = MADV_SEQUENTIAL) {
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) { perror(path); return; }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                perror(path);
+            } else {
+                base = static_cast<const char *>(p);
+                length = st.st_size;
+                madvise(p, length, advice);
+            }
+        } else {
+            fprintf(stderr, "%s: empty file\n", path);
+        }
+        close(fd);
+    }
+
+    ~CANMappedFile() { if (base) munmap(const_cast<char *>(base), length); }
+
+    CANMappedFile(const CANMappedFile &) = delete;
+    CANMappedFile &operator=(const CANMappedFile &) = delete;
+
+    bool ok() const { return base != nullptr; }
+    const char *data() const { return base; }
+    size_t size() const { return length; }
+    void advise(int advice) const { if (base) madvise(const_cast<char *>(base), length, advice); }
+
+private:
+    const char *base = nullptr;
+    size_t length = 0;
+};
+
+// Sequential capture file reader, one block at a time
+class CANCaptureReader {
+public:
+    explicit CANCaptureReader(const char *path) {
+        file = fopen(path, "rb");
+        if (!file) { perror(path); return; }
+        if (fread(&hdr, sizeof(hdr), 1, file) != 1 || memcmp(hdr.magic, CAN_CAPTURE_MAGIC, 8) != 0 ||
+            hdr.recordSize != sizeof(CANCaptureRecord) || hdr.headerSize < sizeof(hdr)) {
+            fprintf(stderr, "%s: not a CAN capture file\n", path);
+            fclose(file);
+            file = nullptr;
+            return;
+        }
+        fseek(file, hdr.headerSize, SEEK_SET);
+    }
+
+    ~CANCaptureReader() { if (file) fclose(file); }
+
+    CANCaptureReader(const CANCaptureReader &) = delete;
+    CANCaptureReader &operator=(const CANCaptureReader &) = delete;
+
+    bool ok() const { return file != nullptr; }
+    const CANCaptureHeader &header() const { return hdr; }
+    uint64_t damaged = 0;       // records dropped for a DLC above 8
+
+    // Interface name of a bus index, or "" if the header has none
+    const char *busName(uint8_t bus) const {
+        static char none[1] = "";
+        return bus < hdr.busCount ? hdr.buses[bus] : none;
+    }
+
+    // Read the next block; false at the end or on a damaged block.
+    // Records with a DLC above 8 are dropped and counted in damaged.
+    bool next() {
+        if (!file || fread(&blk, sizeof(blk), 1, file) != 1) return false;
+        if (blk.magic != CAN_CAPTURE_BLOCK_MAGIC) {
+            fprintf(stderr, "Capture: bad block header at offset %ld\n", ftell(file) - long(sizeof(blk)));
+            return false;
+        }
+        records.resize(blk.count);
+        size_t got = fread(records.data(), sizeof(CANCaptureRecord), blk.count, file);
+        records.resize(got);        // a truncated last block keeps what was written
+        auto bad = std::remove_if(records.begin(), records.end(), [](const CANCaptureRecord &r) { return r.dlc > 8; });
+        damaged += records.end() - bad;
+        records.erase(bad, records.end());
+        return got > 0;
+    }
+
+    // The block last read by next(), and its records
+    const CANCaptureBlock &block() const { return blk; }
+    const std::vector<CANCaptureRecord> &blockRecords() const { return records; }
+
+    // Call f(const CANCaptureRecord &) for every record in the file
+    template <typename F>
+    void forEach(F &&f) {
+        while (next())
+            for (const CANCaptureRecord &r : records) f(r);
+    }
+
+private:
+    FILE *file = nullptr;
+    CANCaptureHeader hdr{};
+    CANCaptureBlock blk{};
+    std::vector<CANCaptureRecord> records;
+};
@@ -0,0 +1,126 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include "can-csv-parser.h"
+
+using namespace std;
+
+// Parses generated can_log.csv and stress_test_log.csv text, formatted the
+// way can-capture-csv and can-stress-testing write it, with the scalar and
+// SSE4.1 paths of CANCSVParser and with a stream-based parser for
+// comparison. Every record must match the frames the text was made from;
+// the report is GB/s of CSV text per core.
+//
+// Usage: can-csv-bench [lines]
+
+struct Sample {
+    string text;
+    vector<CANCaptureRecord> expected;
+};
+
+Sample makeLog(CANCSVParser::Layout layout, size_t lines) {
+    Sample s;
+    mt19937_64 rng(7);
+    int64_t ts = (int64_t(time(nullptr)) - 3600) * 1000000000;
+    s.text = layout == CANCSVParser::CAN_LOG ? "Timestamp,CAN_ID,Type,DLC,Data\n"
+                                              : "Timestamp,CAN_ID,DLC,PayloadBits,TotalBits,BusLoad,Data\n";
+    s.text.reserve(lines * 80);
+    s.expected.reserve(lines);
+    for (size_t i = 0; i < lines; i++) {
+        ts += 100000 + rng() % 400000;
+        CANCaptureRecord r{};
+        r.ts_ns = ts - ts % 1000000;        // the logs keep milliseconds
+        bool extended = layout == CANCSVParser::CAN_LOG && rng() % 3 == 0;
+        r.id = extended ? rng() & CAN_EFF_MASK : rng() & CAN_SFF_MASK;
+        r.flags = extended ? CAN_CAPTURE_EXTENDED : 0;
+        r.dlc = layout == CANCSVParser::CAN_LOG ? rng() % 9 : 8;
+        uint64_t payload = rng();
+        memcpy(r.data, &payload, r.dlc);
+
+        char line[160];
+        size_t len = formatWallTime(r.ts_ns, line);
+        if (layout == CANCSVParser::CAN_LOG) {
+            len += sprintf(line + len, ",0x%X,%s,%d,", r.id, extended ? "Extended" : "Standard", r.dlc);
+            for (int b = 0; b < r.dlc; b++)
+                len += sprintf(line + len, b ? " %02X" : "%02X", r.data[b]);
+        } else {
+            unsigned bits = rng() % 500000;
+            len += sprintf(line + len, ",0x%x,%d,%d,%u,%.2f,", r.id, r.dlc, r.dlc * 8, bits, bits / 500000.0 * 100);
+            for (int b = 0; b < r.dlc; b++)
+                len += sprintf(line + len, b ? " %02x" : "%02x", r.data[b]);
+        }
+        line[len++] = '\n';
+        s.text.append(line, len);
+        s.expected.push_back(r);
+    }
+    return s;
+}
+
+// The getline/stringstream parsing the offline scripts did, for reference
+size_t parseStreams(const string &text, CANCSVParser::Layout layout, vector<CANCaptureRecord> &out) {
+    istringstream in(text);
+    string line, field;
+    getline(in, line);
+    while (getline(in, line)) {
+        istringstream row(line);
+        vector<string> f;
+        while (getline(row, field, ',')) f.push_back(field);
+        if (f.size() < 5) continue;
+        CANCaptureRecord r{};
+        r.id = stoul(f[1], nullptr, 16);
+        r.dlc = stoi(f[layout == CANCSVParser::CAN_LOG ? 3 : 2]);
+        istringstream data(f.back());
+        unsigned v;
+        for (int b = 0; b < r.dlc && data >> hex >> v; b++) r.data[b] = v;
+        out.push_back(r);
+    }
+    return out.size();
+}
+
+double gbPerSec(chrono::steady_clock::time_point t0, size_t bytes) {
+    return bytes / chrono::duration<double>(chrono::steady_clock::now() - t0).count() / 1e9;
+}
+
+int main(int argc, char **argv) {
+    size_t lines = argc > 1 ? strtoul(argv[1], nullptr, 10) : 5000000;
+    bool failed = false;
+
+    for (auto layout : {CANCSVParser::CAN_LOG, CANCSVParser::STRESS_LOG}) {
+        Sample s = makeLog(layout, lines);
+        vector<CANCaptureRecord> records(lines);
+        cout << (layout == CANCSVParser::CAN_LOG ? "can_log.csv" : "stress_test_log.csv") << ", "
+             << s.text.size() / 1e6 << " MB\n";
+
+        for (bool vec : {false, true}) {
+            if (vec && CANCSVParser::isa() == CANCSVParser::SCALAR) break;
+            auto t0 = chrono::steady_clock::now();
+            const char *p = s.text.data(), *end = p + s.text.size();
+            CANCSVParser parser = CANCSVParser::fromHeader(p, end, vec);
+            size_t n = 0;
+            while (p < end) n += parser.parse(p, end, records.data() + n, records.size() - n);
+            double gbs = gbPerSec(t0, s.text.size());
+
+            size_t mismatches = n == lines && parser.bad == 0 ? 0 : 1;
+            for (size_t i = 0; i < n && i < lines; i++)
+                if (memcmp(&records[i], &s.expected[i], sizeof(CANCaptureRecord)) != 0) mismatches++;
+            failed |= mismatches != 0;
+            cout << fixed << setprecision(2) << "  " << setw(8) << (vec ? CANCSVParser::isaName() : "scalar")
+                 << " : " << gbs << " GB/s, " << mismatches << " mismatches\n";
+        }
+
+        // Streams are slow: time them on the header plus the first 500k lines
+        size_t cut = 0;
+        for (size_t i = 0; i <= min<size_t>(lines, 500000); i++) cut = s.text.find('\n', cut) + 1;
+        string head = s.text.substr(0, cut);
+        vector<CANCaptureRecord> streamed;
+        auto t0 = chrono::steady_clock::now();
+        parseStreams(head, layout, streamed);
+        cout << "   streams : " << gbPerSec(t0, head.size()) << " GB/s\n";
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,278 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <string_view>
+#include <linux/can.h>
+#include "can-capture.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define CAN_CSV_X86 1
+#endif
+
+// Parser for the frame CSV layouts the tools write, straight into
+// CANCaptureRecords (bus 0):
+//   can_log.csv          Timestamp,CAN_ID,Type,DLC,Data
+//   stress_test_log.csv  Timestamp,CAN_ID,DLC,PayloadBits,TotalBits,BusLoad,Data
+// Timestamps are local "YYYY-MM-DD HH:MM:SS.fff[fff]" and mktime runs once
+// per second of log. The "AA BB .." payload is classified and converted
+// in one pass of SSE4.1 nibble arithmetic plus two pshufb gathers when the
+// CPU has it; the scalar path gives identical records.
+class CANCSVParser {
+public:
+    enum Layout { UNKNOWN, CAN_LOG, STRESS_LOG };
+    enum Isa { SCALAR, SSE41 };
+
+    // Layout named by a header line
+    static Layout layoutOf(std::string_view header) {
+        while (!header.empty() && (header.back() == '\r' || header.back() == '\n')) header.remove_suffix(1);
+        if (header == "Timestamp,CAN_ID,Type,DLC,Data") return CAN_LOG;
+        if (header == "Timestamp,CAN_ID,DLC,PayloadBits,TotalBits,BusLoad,Data") return STRESS_LOG;
+        return UNKNOWN;
+    }
+
+    // Parser for the layout given by the header line at p, which is
+    // advanced past it; useVector = false forces the scalar path
+    static CANCSVParser fromHeader(const char *&p, const char *end, bool useVector = true) {
+        const char *nl = static_cast<const char *>(memchr(p, '\n', end - p));
+        const char *next = nl ? nl + 1 : end;
+        CANCSVParser parser(layoutOf(std::string_view(p, next - p)), useVector);
+        p = next;
+        return parser;
+    }
+
+    explicit CANCSVParser(Layout l, bool useVector = true) : lay(l), vec(useVector && isa() == SSE41) {}
+
+    Layout layout() const { return lay; }
+    bool vectorised() const { return vec; }
+    uint64_t bad = 0;           // lines skipped as malformed
+
+    // Parse whole lines from p into out, at most max records; p advances
+    // past the lines consumed. Returns the records written.
+    size_t parse(const char *&p, const char *end, CANCaptureRecord *out, size_t max) {
+        size_t n = 0;
+        while (n < max && p < end) {
+            const char *nl = static_cast<const char *>(memchr(p, '\n', end - p));
+            const char *next = nl ? nl + 1 : end;
+            const char *eol = nl ? nl : end;
+            if (eol > p && eol[-1] == '\r') eol--;
+            if (eol > p) {
+                if (parseLine(p, eol, end, out[n])) n++;
+                else bad++;
+            }
+            p = next;
+        }
+        return n;
+    }
+
+    static Isa isa() {
+#ifdef CAN_CSV_X86
+        static const Isa best = __builtin_cpu_supports("sse4.1") ? SSE41 : SCALAR;
+        return best;
+#else
+        return SCALAR;
+#endif
+    }
+
+    static const char *isaName() { return isa() == SSE41 ? "SSE4.1" : "scalar"; }
+
+private:
+    static int hexDigit(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        c |= 0x20;
+        return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+    }
+
+    static bool digits(const char *s, int n, int &v) {
+        v = 0;
+        for (int i = 0; i < n; i++) {
+            if (s[i] < '0' || s[i] > '9') return false;
+            v = v * 10 + (s[i] - '0');
+        }
+        return true;
+    }
+
+    // end bounds reads past the line: the vector kernel loads 24 bytes
+    bool parseLine(const char *p, const char *eol, const char *end, CANCaptureRecord &r) {
+        // "YYYY-MM-DD HH:MM:SS." then the fraction
+        if (eol - p < 21 || p[19] != '.') return false;
+        if (memcmp(p, lastSecond, 19) != 0 && !newSecond(p)) return false;
+        const char *q = p + 20;
+        int64_t frac = 0, scale = 1000000000;
+        for (; q < eol && *q >= '0' && *q <= '9' && scale > 1; q++) {
+            frac = frac * 10 + (*q - '0');
+            scale /= 10;
+        }
+        if (q == p + 20 || q >= eol || *q++ != ',') return false;
+
+        uint32_t id = 0;
+        if (eol - q > 2 && q[0] == '0' && (q[1] | 0x20) == 'x') q += 2;
+        int idLen = 0;
+#ifdef CAN_CSV_X86
+        if (vec && end - q >= 16) idLen = hexNumberSSE41(q, id);
+        else
+#endif
+            for (int d; q + idLen < eol && (d = hexDigit(q[idLen])) >= 0 && idLen <= 8; idLen++) id = id << 4 | d;
+        if (idLen == 0 || idLen > 8 || q + idLen >= eol || q[idLen] != ',') return false;
+        q += idLen + 1;
+
+        bool extended = id > CAN_SFF_MASK;
+        if (lay == CAN_LOG) {
+            // "Standard" or "Extended"
+            extended = q < eol && *q == 'E';
+            if (eol - q > 8 && q[8] == ',') q += 8;
+            else if (!(q = static_cast<const char *>(memchr(q, ',', eol - q)))) return false;
+            q++;
+        }
+        if (eol - q < 2 || *q < '0' || *q > '8' || q[1] != ',') return false;
+        int dlc = *q - '0';
+        q += 2;
+        if (lay == STRESS_LOG) {
+            // PayloadBits,TotalBits,BusLoad
+            const char *data = nullptr;
+#ifdef CAN_CSV_X86
+            if (vec && end - q >= 32) data = skipFieldsSSE41(q, 3);
+#endif
+            for (int i = 0; i < 3 && !data; i++) {
+                const char *c = static_cast<const char *>(memchr(q, ',', eol - q));
+                if (!c) return false;
+                q = c + 1;
+                if (i == 2) data = q;
+            }
+            if (data > eol) return false;
+            q = data;
+        } else if (lay != CAN_LOG) {
+            return false;
+        }
+
+        // Payload: exactly dlc bytes, "AA BB .."
+        if (eol - q != (dlc ? 3 * dlc - 1 : 0)) return false;
+        r.ts_ns = secondNs + frac * scale;
+        r.id = id & (extended ? CAN_EFF_MASK : CAN_SFF_MASK);
+        r.bus = 0;
+        r.flags = extended ? CAN_CAPTURE_EXTENDED : 0;
+        r.dlc = dlc;
+        r.reserved = 0;
+        if (dlc == 0) {
+            memset(r.data, 0, 8);
+            return true;
+        }
+#ifdef CAN_CSV_X86
+        if (vec && end - q >= 24) return hexBytesSSE41(q, dlc, r.data);
+#endif
+        return hexBytes(q, dlc, r.data);
+    }
+
+    bool newSecond(const char *p) {
+        int year, mon, day, hour, min, sec;
+        if (!digits(p, 4, year) || p[4] != '-' || !digits(p + 5, 2, mon) || p[7] != '-' ||
+            !digits(p + 8, 2, day) || p[10] != ' ' || !digits(p + 11, 2, hour) || p[13] != ':' ||
+            !digits(p + 14, 2, min) || p[16] != ':' || !digits(p + 17, 2, sec))
+            return false;
+        tm t{};
+        t.tm_year = year - 1900;
+        t.tm_mon = mon - 1;
+        t.tm_mday = day;
+        t.tm_hour = hour;
+        t.tm_min = min;
+        t.tm_sec = sec;
+        t.tm_isdst = -1;
+        secondNs = int64_t(mktime(&t)) * 1000000000;
+        memcpy(lastSecond, p, 19);
+        return true;
+    }
+
+    static bool hexBytes(const char *s, int n, uint8_t *out) {
+        memset(out, 0, 8);
+        for (int i = 0; i < n; i++, s += 3) {
+            int hi = hexDigit(s[0]), lo = hexDigit(s[1]);
+            if (hi < 0 || lo < 0 || (i + 1 < n && s[2] != ' ')) return false;
+            out[i] = hi << 4 | lo;
+        }
+        return true;
+    }
+
+#ifdef CAN_CSV_X86
+    // Bit per byte of c that is a hex digit
+    __attribute__((target("sse4.1")))
+    static int hexMask(__m128i c) {
+        __m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)),
+                                      _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+        __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                      _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+        return _mm_movemask_epi8(_mm_or_si128(digit, alpha));
+    }
+
+    // Digit values of hex characters: low four bits, plus 9 for letters
+    __attribute__((target("sse4.1")))
+    static __m128i nibbles(__m128i c) {
+        __m128i letter = _mm_cmpeq_epi8(_mm_and_si128(c, _mm_set1_epi8(0x40)), _mm_set1_epi8(0x40));
+        return _mm_add_epi8(_mm_and_si128(c, _mm_set1_epi8(0x0F)), _mm_and_si128(letter, _mm_set1_epi8(9)));
+    }
+
+    // Hex number at s (reads s[0..15]) without a digit loop: the length
+    // comes from the first non-digit, pshufb right-aligns the digits into
+    // 8 bytes and maddubs/packus join them. Returns the digit count; value
+    // is only set for 1 to 8 digits.
+    __attribute__((target("sse4.1")))
+    static int hexNumberSSE41(const char *s, uint32_t &value) {
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s));
+        int len = __builtin_ctz(~hexMask(c) | 0x10000);
+        if (len == 0 || len > 8) return len;
+        __m128i index = _mm_add_epi8(_mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+                                     _mm_set1_epi8(char(len - 8)));
+        __m128i digits = _mm_shuffle_epi8(nibbles(c), index);       // negative index: zero
+        __m128i pairs = _mm_maddubs_epi16(digits, _mm_set1_epi16(0x0110));
+        value = __builtin_bswap32(uint32_t(_mm_cvtsi128_si32(_mm_packus_epi16(pairs, pairs))));
+        return len;
+    }
+
+    // Just past the n-th comma in s[0..31], or nullptr if there are fewer
+    __attribute__((target("sse4.1")))
+    static const char *skipFieldsSSE41(const char *s, int n) {
+        const __m128i comma = _mm_set1_epi8(',');
+        uint32_t mask = uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(s)), comma))) |
+                        uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(s + 16)), comma))) << 16;
+        for (int i = 1; i < n; i++) mask &= mask - 1;
+        return mask ? s + __builtin_ctz(mask) + 1 : nullptr;
+    }
+
+    // n bytes from "AA BB .." at s; reads s[0..23]. Byte k's digits are at
+    // 3k and 3k+1: bytes 0-4 come from the load at s, 5-7 from s + 8.
+    __attribute__((target("sse4.1")))
+    static bool hexBytesSSE41(const char *s, int n, uint8_t *out) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + 8));
+
+        // Character classes, as bit masks over positions 0..23
+        const __m128i blank = _mm_set1_epi8(' ');
+        uint32_t hex = uint32_t(hexMask(a)) | uint32_t(hexMask(b) >> 8) << 16;
+        uint32_t space = uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(a, blank))) |
+                         uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(b, blank)) >> 8) << 16;
+        uint32_t used = (1u << (3 * n - 1)) - 1;
+        const uint32_t HEX = 0x6DB6DB;                  // positions 3k and 3k+1
+        if ((hex & used) != (HEX & used) || (space & used) != (~HEX & used)) return false;
+
+        __m128i na = nibbles(a), nb = nibbles(b);
+        const char Z = char(0x80);
+        __m128i hi = _mm_or_si128(_mm_shuffle_epi8(na, _mm_setr_epi8(0, 3, 6, 9, 12, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z)),
+                                  _mm_shuffle_epi8(nb, _mm_setr_epi8(Z, Z, Z, Z, Z, 7, 10, 13, Z, Z, Z, Z, Z, Z, Z, Z)));
+        __m128i lo = _mm_or_si128(_mm_shuffle_epi8(na, _mm_setr_epi8(1, 4, 7, 10, 13, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z)),
+                                  _mm_shuffle_epi8(nb, _mm_setr_epi8(Z, Z, Z, Z, Z, 8, 11, 14, Z, Z, Z, Z, Z, Z, Z, Z)));
+        // Nibbles are < 16, so the 16-bit shift stays inside each byte
+        uint64_t bytes = _mm_cvtsi128_si64(_mm_or_si128(_mm_slli_epi16(hi, 4), lo));
+        bytes &= n == 8 ? ~0ull : (1ull << (8 * n)) - 1;
+        memcpy(out, &bytes, 8);
+        return true;
+    }
+#endif
+
+    Layout lay;
+    bool vec;
+    char lastSecond[19] = {};
+    int64_t secondNs = 0;
+};
@@ -1,8 +1,9 @@
 #include <iostream>
-#include <fstream>
 #include <thread>
 #include <chrono>
-#include <iomanip>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
 #include <cstring>
 #include <unistd.h>
 #include <net/if.h>
@@ -12,11 +13,18 @@
 #include <linux/can/raw.h>
 #include <cstdlib>
 #include <ctime>
+#include "can-rx.h"
+#include "can-capture.h"
 
 using namespace std;
 
 const int FIXED_DLC = 8;
 
+// Set by Ctrl+C; both threads finish their loop so the capture is flushed
+atomic<bool> stopRequested(false);
+
+void onSignal(int) { stopRequested = true; }
+
 // Random CAN ID
 unsigned int randomCANID(bool extended) {
     if (extended) return (rand() & 0x1FFFFFFF); // 29-bit
@@ -54,7 +62,7 @@ void senderThread(const char *ifname) {
 
     can_frame frame;
 
-    while (true) {
+    while (!stopRequested) {
         // Random standard frame
         bool extended = false;
         frame.can_id = randomCANID(extended);
@@ -71,7 +79,7 @@ void senderThread(const char *ifname) {
     close(s);
 }
 
-// Receiver thread with CSV
+// Receiver thread with binary capture
 void receiverThread(const char *ifname) {
     int s;
     sockaddr_can addr;
@@ -93,52 +101,48 @@ void receiverThread(const char *ifname) {
         return;
     }
 
-    can_frame frame;
+    // Wake up every 100 ms to notice a stop request on a quiet bus
+    timeval timeout{0, 100000};
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    CANReceiver rx(s);
     cout << "[Receiver] Listening on " << ifname << " ..." << endl;
 
-    ofstream csv("can_log.csv");
-    csv << "Timestamp,CAN_ID,Type,DLC,Data\n";
+    // Frames go to a binary capture written by its own thread;
+    // can-capture-csv turns it into the old can_log.csv layout
+    CANCaptureWriter capture("can_log.cancap", {ifname});
 
-    while (true) {
-        int nbytes = read(s, &frame, sizeof(frame));
-        if (nbytes < 0) {
+    CANTextBuffer console;      // one write per receive batch
+    while (!stopRequested) {
+        int n = rx.receive();
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EINTR) continue;
             perror("Receiver Read");
             break;
         }
 
-        bool isExtended = frame.can_id & CAN_EFF_FLAG;
-        unsigned int id = isExtended ? (frame.can_id & CAN_EFF_MASK)
-                                     : (frame.can_id & CAN_SFF_MASK);
-
-        // Timestamp
-        auto now = chrono::system_clock::now();
-        auto ms = chrono::duration_cast<chrono::milliseconds>(now.time_since_epoch()) % 1000;
-        time_t t = chrono::system_clock::to_time_t(now);
-        tm tm = *localtime(&t);
-        ostringstream timestamp;
-        timestamp << put_time(&tm, "%Y-%m-%d %H:%M:%S") << "." << setw(3) << setfill('0') << ms.count();
-
-        cout << "[" << timestamp.str() << "] ID=0x" << hex << uppercase << id
-             << (isExtended ? " (Extended)" : " (Standard)") << " DLC=" << dec << (int)frame.can_dlc << " Data=[";
-        for (int i = 0; i < frame.can_dlc; i++) {
-            cout << hex << uppercase << setw(2) << setfill('0') << (int)frame.data[i];
-            if (i < frame.can_dlc - 1) cout << " ";
-        }
-        cout << "]" << endl;
-
-        // CSV
-        csv << timestamp.str() << ",0x" << hex << uppercase << id << ","
-            << (isExtended ? "Extended" : "Standard") << ","
-            << dec << (int)frame.can_dlc << ",";
-        for (int i = 0; i < frame.can_dlc; i++) {
-            csv << hex << uppercase << setw(2) << setfill('0') << (int)frame.data[i];
-            if (i < frame.can_dlc - 1) csv << " ";
+        console.clear();
+        for (int k = 0; k < n; k++) {
+            const can_frame &frame = rx.frame(k);
+            capture.push(frame, rx.timestampNs(k));
+
+            bool isExtended = frame.can_id & CAN_EFF_FLAG;
+            unsigned int id = isExtended ? (frame.can_id & CAN_EFF_MASK)
+                                         : (frame.can_id & CAN_SFF_MASK);
+            char timestamp[32];
+            console.put('[').put(timestamp, formatLocalTime(rx.timestampNs(k), timestamp))
+                   .put("] ID=0x").hex(id)
+                   .put(isExtended ? " (Extended)" : " (Standard)")
+                   .put(" DLC=").dec(int(frame.can_dlc))
+                   .put(" Data=[").bytes(frame.data, min<int>(frame.can_dlc, 8)).put("]\n");
         }
-        csv << "\n";
-        csv.flush();
+        fwrite(console.data(), 1, console.size(), stdout);
+        fflush(stdout);
     }
 
-    csv.close();
+    capture.stop();
+    cout << "[Receiver] Capture: " << capture.written << " written, " << capture.dropped << " dropped, ring high-water "
+         << capture.highWater << "/" << capture.capacity() << endl;
     close(s);
 }
 
@@ -146,6 +150,7 @@ int main() {
     srand(time(0));
 
     const char *ifname = "vcan0";
+    signal(SIGINT, onSignal);
 
     thread sender(senderThread, ifname);
     thread receiver(receiverThread, ifname);
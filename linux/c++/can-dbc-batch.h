@@ -0,0 +1,182 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <linux/can.h>
+#include "can-dbc.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define CAN_BATCH_X86 1
+#endif
+
+// Batch decode of frames that all carry the same CAN ID into columns.
+// decode() writes signal s (DBC order) of frame i to columns[s][i].
+// Integer signals of up to 32 bits use AVX2 (4 frames per step) or SSE4.1
+// (2 frames per step) kernels picked at runtime; wider and IEEE float
+// signals, and CPUs with neither, use the scalar codec. Every path gives
+// the same bits as CANDecodeTable::decode. Multiplexed signals are decoded
+// for every frame; use the multiplexor's column to tell which rows apply.
+class CANBatchDecoder {
+public:
+    CANBatchDecoder(const CANDecodeTable &table, const CANMessageDesc &msg) {
+        const CANSignalDesc *sigs = table.signals(msg);
+        for (int s = 0; s < msg.signal_count; s++) {
+            const SignalPlan &p = sigs[s].plan;
+            bool isInt = p.type == SignalType::Unsigned || p.type == SignalType::Signed;
+            if (!isInt || !p.valid() || p.length > 32) {
+                scalar.push_back({s, sigs[s]});
+                continue;
+            }
+            Lane l;
+            l.column = s;
+            l.shift = p.shift;
+            l.mask = uint32_t(p.mask);
+            l.isSigned = p.type == SignalType::Signed;
+            l.signShift = 32 - p.length;
+            l.motorola = p.order == ByteOrder::Motorola;
+            l.scale = sigs[s].scale;
+            l.offset = sigs[s].offset;
+            lanes.push_back(l);
+        }
+    }
+
+    void decode(const can_frame *frames, size_t n, float *const *columns) const {
+        size_t done = 0;
+#ifdef CAN_BATCH_X86
+        if (!lanes.empty()) {
+            if (isa() == AVX2) done = decodeAVX2(frames, n, columns);
+            else if (isa() == SSE41) done = decodeSSE41(frames, n, columns);
+        }
+#endif
+        for (size_t i = done; i < n; i++)
+            for (auto &l : lanes)
+                columns[l.column][i] = decodeLane(l, frames[i].data);
+        for (auto &s : scalar)
+            for (size_t i = 0; i < n; i++)
+                columns[s.column][i] = CANDecodeTable::decode(s.desc, frames[i].data);
+    }
+
+    enum Isa { SCALAR, SSE41, AVX2 };
+
+    static Isa isa() {
+#ifdef CAN_BATCH_X86
+        static const Isa best = __builtin_cpu_supports("avx2") ? AVX2
+                              : __builtin_cpu_supports("sse4.1") ? SSE41 : SCALAR;
+        return best;
+#else
+        return SCALAR;
+#endif
+    }
+
+    static const char *isaName() {
+        switch (isa()) {
+        case AVX2: return "AVX2";
+        case SSE41: return "SSE4.1";
+        default: return "scalar";
+        }
+    }
+
+private:
+    // Integer signal handled by the vector kernels
+    struct Lane {
+        int column;
+        int shift;
+        uint32_t mask;
+        int signShift;      // 32 - length, for sign extension
+        bool isSigned;
+        bool motorola;
+        double scale;
+        double offset;
+    };
+
+    struct Scalar {
+        int column;
+        CANSignalDesc desc;
+    };
+
+    // Same arithmetic as SignalPlan::value() * scale + offset
+    static float decodeLane(const Lane &l, const uint8_t *data) {
+        uint64_t word;
+        memcpy(&word, data, 8);
+        word = l.motorola ? be64toh(word) : le64toh(word);
+        uint32_t raw = uint32_t(word >> l.shift) & l.mask;
+        double v = l.isSigned ? double(int32_t(raw << l.signShift) >> l.signShift) : double(raw);
+        return float(v * l.scale + l.offset);
+    }
+
+#ifdef CAN_BATCH_X86
+    // Payload words of frames i..i+3, in frame order
+    __attribute__((target("avx2")))
+    static __m256i loadAVX2(const can_frame *f) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(f));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(f + 2));
+        return _mm256_permute4x64_epi64(_mm256_unpackhi_epi64(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+    }
+
+    __attribute__((target("avx2")))
+    size_t decodeAVX2(const can_frame *frames, size_t n, float *const *columns) const {
+        const __m256i bswap = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+                                               7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+        const __m256i low32 = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+        const __m128i bias = _mm_set1_epi32(int(0x80000000));
+        const __m256d two31 = _mm256_set1_pd(2147483648.0);
+
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m256i le = loadAVX2(frames + i);
+            __m256i be = _mm256_shuffle_epi8(le, bswap);
+            for (auto &l : lanes) {
+                __m256i w = _mm256_srl_epi64(l.motorola ? be : le, _mm_cvtsi32_si128(l.shift));
+                __m128i raw = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(w, low32));
+                raw = _mm_and_si128(raw, _mm_set1_epi32(int(l.mask)));
+                __m256d v;
+                if (l.isSigned) {
+                    __m128i count = _mm_cvtsi32_si128(l.signShift);
+                    v = _mm256_cvtepi32_pd(_mm_sra_epi32(_mm_sll_epi32(raw, count), count));
+                } else {
+                    v = _mm256_add_pd(_mm256_cvtepi32_pd(_mm_xor_si128(raw, bias)), two31);
+                }
+                v = _mm256_add_pd(_mm256_mul_pd(v, _mm256_set1_pd(l.scale)), _mm256_set1_pd(l.offset));
+                _mm_storeu_ps(columns[l.column] + i, _mm256_cvtpd_ps(v));
+            }
+        }
+        return i;
+    }
+
+    __attribute__((target("sse4.1")))
+    size_t decodeSSE41(const can_frame *frames, size_t n, float *const *columns) const {
+        const __m128i bswap = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+        const __m128i bias = _mm_set1_epi32(int(0x80000000));
+        const __m128d two31 = _mm_set1_pd(2147483648.0);
+
+        size_t i = 0;
+        for (; i + 2 <= n; i += 2) {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(frames + i));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(frames + i + 1));
+            __m128i le = _mm_unpackhi_epi64(a, b);
+            __m128i be = _mm_shuffle_epi8(le, bswap);
+            for (auto &l : lanes) {
+                __m128i w = _mm_srl_epi64(l.motorola ? be : le, _mm_cvtsi32_si128(l.shift));
+                __m128i raw = _mm_shuffle_epi32(w, _MM_SHUFFLE(3, 1, 2, 0));
+                raw = _mm_and_si128(raw, _mm_set1_epi32(int(l.mask)));
+                __m128d v;
+                if (l.isSigned) {
+                    __m128i count = _mm_cvtsi32_si128(l.signShift);
+                    v = _mm_cvtepi32_pd(_mm_sra_epi32(_mm_sll_epi32(raw, count), count));
+                } else {
+                    v = _mm_add_pd(_mm_cvtepi32_pd(_mm_xor_si128(raw, bias)), two31);
+                }
+                v = _mm_add_pd(_mm_mul_pd(v, _mm_set1_pd(l.scale)), _mm_set1_pd(l.offset));
+                _mm_storel_pi(reinterpret_cast<__m64 *>(columns[l.column] + i), _mm_cvtpd_ps(v));
+            }
+        }
+        return i;
+    }
+#endif
+
+    std::vector<Lane> lanes;
+    std::vector<Scalar> scalar;
+};
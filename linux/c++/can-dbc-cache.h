@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "can-dbc.h"
+#include "can-dbc-parser.h"
+
+// Binary cache of compiled decode tables.
+// The cache file is the table image byte for byte (see CANTableHeader), so
+// loading it is an mmap plus bounds checks. It records a hash of the .dbc
+// text it was built from and is rebuilt whenever that text changes.
+
+// 64-bit hash of DBC source text, 8 bytes per step
+inline uint64_t dbcSourceHash(std::string_view text) {
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ text.size();
+    size_t i = 0;
+    for (; i + 8 <= text.size(); i += 8) {
+        uint64_t w;
+        memcpy(&w, text.data() + i, 8);
+        h = (h ^ w) * 0xFF51AFD7ED558CCDull;
+        h ^= h >> 32;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, text.data() + i, text.size() - i);
+    h = (h ^ tail) * 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 29;
+    return h ? h : 1;       // 0 means "not built from a file"
+}
+
+// Write table to path atomically (temp file + rename)
+inline bool saveDBCCache(const CANDecodeTable &table, const std::string &path) {
+    std::string tmp = path + ".tmp" + std::to_string(getpid());
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+
+    const char *p = static_cast<const char *>(table.image());
+    size_t left = table.header().image_size;
+    while (left > 0) {
+        ssize_t n = write(fd, p, left);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        p += n;
+        left -= n;
+    }
+    bool ok = left == 0 && fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+    if (ok && rename(tmp.c_str(), path.c_str()) == 0) return true;
+    unlink(tmp.c_str());
+    return false;
+}
+
+// Map a cache file into table if it is intact and was built from a DBC
+// with hash sourceHash
+inline bool loadDBCCache(const std::string &path, uint64_t sourceHash, CANDecodeTable &table) {
+    MappedFile file(path);
+    if (!file.data() || file.size() < sizeof(CANTableHeader)) return false;
+
+    CANTableHeader h;
+    memcpy(&h, file.data(), sizeof(h));
+    if (h.source_hash != sourceHash || !table.adoptMapping(file.data(), file.size()))
+        return false;
+    file.release();
+    return true;
+}
+
+// Decode table for a .dbc file, from <path>.cache when it matches the
+// file's contents, otherwise parsed and written back to the cache.
+// Returns false with errors filled in if the DBC could not be loaded.
+inline bool loadDBCCached(const std::string &path, CANDecodeTable &table,
+                          std::vector<DBCError> &errors) {
+    MappedFile src(path);
+    if (!src.valid()) { errors.push_back({0, "cannot read file"}); return false; }
+
+    uint64_t hash = dbcSourceHash(src.text());
+    std::string cachePath = path + ".cache";
+    if (loadDBCCache(cachePath, hash, table)) return true;
+
+    DBCMap dbc;
+    size_t before = errors.size();
+    DBCParser(src.text(), dbc, errors).parse();
+    if (errors.size() != before) return false;
+    if (!CANDecodeTable::fits(dbc)) {
+        errors.push_back({0, CANDecodeTable::muxFits(dbc) ? "more than 65535 messages or signals"
+                                                          : "multiplexor value above 65534"});
+        return false;
+    }
+
+    table = CANDecodeTable(dbc, hash);
+    saveDBCCache(table, cachePath);     // best effort; read-only dirs just skip caching
+    return true;
+}
@@ -0,0 +1,313 @@
+#include <iostream>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <set>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cctype>
+#include "can-dbc-parser.h"
+
+using namespace std;
+
+// Generates a header with one struct per DBC message. Each struct holds the
+// physical signal values and has decode()/encode() functions with every
+// shift, mask and scale written as a literal, plus a switch-based decode()
+// dispatcher over all messages. Multiplexed signals are decoded only when
+// their page is selected. See can-dbc-gen.h.
+//
+// Usage: can-dbc-codegen <file.dbc> <out.h> [namespace]
+//
+// Signals and messages keep their DBC names, with other characters
+// replaced by '_'. Locals and parameters of the generated code end in '_';
+// names that would still clash fail generation with an error.
+
+string identifier(const string &name) {
+    string id;
+    for (char c : name)
+        id += isalnum((unsigned char)c) ? c : '_';
+    if (id.empty() || isdigit((unsigned char)id[0])) id = "_" + id;
+    return id;
+}
+
+// Local holding the raw value of a multiplexor signal
+string muxLocal(const Signal &sig) {
+    return "mux_" + identifier(sig.name) + "_";
+}
+
+// Names the generated code declares or refers to, which a struct member or
+// struct name must not hide
+const set<string> GENERATED_NAMES = {
+    // Members of every message struct
+    "ID", "NAME", "DLC", "CYCLE_MS", "decode", "encode", "forEach",
+    // Locals and parameters
+    "d_", "le_", "be_", "F_", "f_", "Visitor_", "frame_", "visit_", "m_",
+    // Types and can-dbc-gen.h helpers used in the bodies
+    "uint8_t", "uint64_t", "canid_t", "can_frame", "canLoadLE", "canLoadBE", "canStore", "canSigned",
+    "canFloat32", "canFloat64", "canRawUnsigned", "canRawSigned", "canRawFloat32", "canRawFloat64",
+};
+
+const set<string> KEYWORDS = {
+    "alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor", "bool", "break", "case", "catch",
+    "char", "char16_t", "char32_t", "class", "compl", "const", "constexpr", "const_cast", "continue",
+    "decltype", "default", "delete", "do", "double", "dynamic_cast", "else", "enum", "explicit", "export",
+    "extern", "false", "float", "for", "friend", "goto", "if", "inline", "int", "long", "mutable",
+    "namespace", "new", "noexcept", "not", "not_eq", "nullptr", "operator", "or", "or_eq", "private",
+    "protected", "public", "register", "reinterpret_cast", "return", "short", "signed", "sizeof", "static",
+    "static_assert", "static_cast", "struct", "switch", "template", "this", "thread_local", "throw", "true",
+    "try", "typedef", "typeid", "typename", "union", "unsigned", "using", "virtual", "void", "volatile",
+    "wchar_t", "while", "xor", "xor_eq",
+};
+
+// Message and signal names that do not make distinct, usable C++
+// identifiers, one message per problem
+vector<string> nameClashes(const DBCMap &dbc) {
+    vector<string> problems;
+    auto unusable = [](const string &id) { return KEYWORDS.count(id) || GENERATED_NAMES.count(id); };
+    map<string, string> structs;    // identifier -> DBC name
+    for (auto &[id, msg] : dbc) {
+        string type = identifier(msg.name);
+        if (unusable(type))
+            problems.push_back("message " + msg.name + ": '" + type + "' is reserved in the generated code");
+        auto [it, added] = structs.emplace(type, msg.name);
+        if (!added)
+            problems.push_back("messages " + it->second + " and " + msg.name + " both become '" + type + "'");
+
+        set<string> muxLocals;
+        for (auto &sig : msg.signals) muxLocals.insert(muxLocal(sig));
+        map<string, string> members;
+        for (auto &sig : msg.signals) {
+            string member = identifier(sig.name);
+            string where = "signal " + msg.name + "." + sig.name + ": ";
+            if (unusable(member) || muxLocals.count(member))
+                problems.push_back(where + "'" + member + "' is reserved in the generated code");
+            else if (member == type)
+                problems.push_back(where + "'" + member + "' is also the message struct's name");
+            auto [m, fresh] = members.emplace(member, sig.name);
+            if (!fresh)
+                problems.push_back(where + "signals " + m->second + " and " + sig.name + " both become '" +
+                                   member + "'");
+        }
+    }
+    return problems;
+}
+
+// Exact decimal form of a float, as a double literal
+string literal(float v) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.17g", double(v));
+    string s = buf;
+    if (s.find_first_of(".e") == string::npos) s += ".0";
+    return s;
+}
+
+string hexLiteral(uint64_t v) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "0x%llXull", (unsigned long long)v);
+    return buf;
+}
+
+bool scaled(const Signal &sig) {
+    return sig.scale != 1.0f || sig.offset != 0.0f;
+}
+
+string rawField(const SignalPlan &p) {
+    return string("((") + (p.order == ByteOrder::Intel ? "le_" : "be_") + " >> " +
+           to_string(p.shift) + ") & " + hexLiteral(p.mask) + ")";
+}
+
+// Condition under which signal i of a multiplexed message is present,
+// empty if it always is. Nested multiplexors add their own conditions.
+string muxCondition(const CANMessageDef &msg, const DBCMuxInfo &mux, int i, int depth = 0) {
+    int sw = mux.switchOf[i];
+    if (sw < 0 || depth > 8) return "";
+    string sel = muxLocal(msg.signals[sw]);
+    string cond;
+    for (auto &[from, to] : mux.when[i]) {
+        if (!cond.empty()) cond += " || ";
+        if (from == to) cond += sel + " == " + to_string(from);
+        else if (from == 0) cond += sel + " <= " + to_string(to);
+        else cond += "(" + sel + " >= " + to_string(from) + " && " + sel + " <= " + to_string(to) + ")";
+    }
+    if (mux.when[i].size() > 1) cond = "(" + cond + ")";
+    string outer = muxCondition(msg, mux, sw, depth + 1);
+    return outer.empty() ? cond : outer + " && " + cond;
+}
+
+void emitDecode(ostream &out, const CANMessageDef &msg) {
+    bool le = false, be = false;
+    for (auto &sig : msg.signals) {
+        if (sig.byte_order == ByteOrder::Intel) le = true;
+        else be = true;
+    }
+    DBCMuxInfo mux = resolveMux(msg);
+
+    out << "    void decode(const uint8_t *d_) {\n";
+    if (le) out << "        const uint64_t le_ = canLoadLE(d_);\n";
+    if (be) out << "        const uint64_t be_ = canLoadBE(d_);\n";
+
+    // Raw value of every multiplexor, then each signal under its page condition
+    vector<bool> isSwitch(msg.signals.size());
+    for (int sw : mux.switchOf)
+        if (sw >= 0) isSwitch[sw] = true;
+    for (size_t i = 0; i < msg.signals.size(); i++) {
+        const Signal &sig = msg.signals[i];
+        SignalPlan p = SignalPlan::make(sig.start_bit, sig.length, sig.byte_order, sig.type);
+        if (isSwitch[i] && p.valid())
+            out << "        const uint64_t " << muxLocal(sig) << " = " << rawField(p) << ";\n";
+    }
+
+    for (size_t i = 0; i < msg.signals.size(); i++) {
+        const Signal &sig = msg.signals[i];
+        SignalPlan p = SignalPlan::make(sig.start_bit, sig.length, sig.byte_order, sig.type);
+        if (!p.valid()) continue;
+        string raw = rawField(p);
+        string value;
+        switch (p.type) {
+        case SignalType::Signed:  value = "canSigned<" + to_string(p.length) + ">(" + raw + ")"; break;
+        case SignalType::Float32: value = "canFloat32(" + raw + ")"; break;
+        case SignalType::Float64: value = "canFloat64(" + raw + ")"; break;
+        default:                  value = "double" + raw; break;
+        }
+        if (sig.scale != 1.0f)
+            value += " * " + literal(sig.scale);
+        if (scaled(sig))
+            value += sig.offset < 0 ? " - " + literal(-sig.offset) : " + " + literal(sig.offset);
+        string cond = muxCondition(msg, mux, i);
+        out << "        " << (cond.empty() ? "" : "if (" + cond + ") ")
+            << identifier(sig.name) << " = float(" << value << ");\n";
+    }
+    out << "    }\n";
+}
+
+// Raw field value of a signal's physical member, before masking
+string rawValue(const Signal &sig, const SignalPlan &p) {
+    string value = "double(" + identifier(sig.name) + ")";
+    if (sig.offset != 0.0f)
+        value += sig.offset < 0 ? " + " + literal(-sig.offset) : " - " + literal(sig.offset);
+    if (sig.scale != 1.0f)
+        value = (sig.offset != 0.0f ? "(" + value + ")" : value) + " / " + literal(sig.scale);
+    switch (p.type) {
+    case SignalType::Signed:  return "canRawSigned(" + value + ")";
+    case SignalType::Float32: return "canRawFloat32(" + value + ")";
+    case SignalType::Float64: return "canRawFloat64(" + value + ")";
+    default:                  return "canRawUnsigned(" + value + ")";
+    }
+}
+
+void emitEncode(ostream &out, const CANMessageDef &msg) {
+    DBCMuxInfo mux = resolveMux(msg);
+    vector<bool> isSwitch(msg.signals.size());
+    for (int sw : mux.switchOf)
+        if (sw >= 0) isSwitch[sw] = true;
+
+    out << "    // Fills all 8 bytes; bits outside the signals (and outside the\n";
+    out << "    // selected multiplexer pages) are zero\n";
+    out << "    void encode(uint8_t *d_) const {\n";
+    out << "        uint64_t le_ = 0, be_ = 0;\n";
+    for (size_t i = 0; i < msg.signals.size(); i++) {
+        const Signal &sig = msg.signals[i];
+        SignalPlan p = SignalPlan::make(sig.start_bit, sig.length, sig.byte_order, sig.type);
+        if (isSwitch[i] && p.valid())
+            out << "        const uint64_t " << muxLocal(sig) << " = "
+                << rawValue(sig, p) << " & " << hexLiteral(p.mask) << ";\n";
+    }
+    for (size_t i = 0; i < msg.signals.size(); i++) {
+        const Signal &sig = msg.signals[i];
+        SignalPlan p = SignalPlan::make(sig.start_bit, sig.length, sig.byte_order, sig.type);
+        if (!p.valid()) continue;
+        string cond = muxCondition(msg, mux, i);
+        out << "        " << (cond.empty() ? "" : "if (" + cond + ") ")
+            << (p.order == ByteOrder::Intel ? "le_" : "be_") << " |= (" << rawValue(sig, p)
+            << " & " << hexLiteral(p.mask) << ") << " << int(p.shift) << ";\n";
+    }
+    out << "        canStore(d_, le_, be_);\n";
+    out << "    }\n";
+}
+
+void emitMessage(ostream &out, unsigned id, const CANMessageDef &msg) {
+    out << "struct " << identifier(msg.name) << " {\n";
+    char hexId[16];
+    snprintf(hexId, sizeof(hexId), "0x%X", id);
+    out << "    static constexpr canid_t ID = " << hexId << ";"
+        << (id & CAN_EFF_FLAG ? "     // 29-bit" : "") << "\n";
+    out << "    static constexpr const char *NAME = \"" << msg.name << "\";\n";
+    out << "    static constexpr int DLC = " << msg.dlc << ";\n";
+    out << "    static constexpr int CYCLE_MS = " << msg.cycle_time_ms << ";\n\n";
+
+    for (auto &sig : msg.signals) {
+        out << "    float " << identifier(sig.name) << " = 0;";
+        if (!sig.unit.empty()) out << "    // " << sig.unit;
+        out << "\n";
+    }
+    out << "\n";
+    emitDecode(out, msg);
+    out << "\n";
+    emitEncode(out, msg);
+    out << "\n";
+
+    out << "    // Calls f(name, value) for each signal in DBC order\n";
+    out << "    template <typename F_>\n";
+    out << "    void forEach(F_ &&f_) const {\n";
+    for (auto &sig : msg.signals)
+        out << "        f_(\"" << sig.name << "\", " << identifier(sig.name) << ");\n";
+    out << "    }\n";
+    out << "};\n\n";
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        cerr << "Usage: " << argv[0] << " <file.dbc> <out.h> [namespace]\n";
+        return 1;
+    }
+    string ns = argc > 3 ? argv[3] : "dbc";
+
+    DBCMap dbc;
+    vector<DBCError> errors;
+    if (!loadDBC(argv[1], dbc, errors)) {
+        for (auto &e : errors)
+            cerr << argv[1] << ":" << e.line << ": " << e.message << endl;
+        return 1;
+    }
+
+    for (auto &[id, msg] : dbc)
+        for (auto &sig : msg.signals)
+            if (!SignalPlan::make(sig.start_bit, sig.length, sig.byte_order, sig.type).valid())
+                cerr << "Skipping " << msg.name << "." << sig.name << ": does not fit in 8 bytes\n";
+
+    vector<string> clashes = nameClashes(dbc);
+    for (auto &c : clashes) cerr << argv[1] << ": " << c << endl;
+    if (!clashes.empty()) return 1;
+
+    ostringstream out;
+    out << "// Generated from " << argv[1] << " by can-dbc-codegen. Do not edit.\n";
+    out << "#pragma once\n\n";
+    out << "#include \"can-dbc-gen.h\"\n\n";
+    out << "namespace " << ns << " {\n\n";
+    for (auto &[id, msg] : dbc)
+        emitMessage(out, id, msg);
+
+    out << "// Decode frame into its message struct and call visit(msg).\n";
+    out << "// Returns false for IDs not in the DBC.\n";
+    out << "template <typename Visitor_>\n";
+    out << "inline bool decode(const can_frame &frame_, Visitor_ &&visit_) {\n";
+    out << "    switch (frame_.can_id & (CAN_EFF_FLAG | CAN_EFF_MASK)) {\n";
+    for (auto &[id, msg] : dbc) {
+        string type = identifier(msg.name);
+        out << "    case " << type << "::ID: { " << type << " m_; m_.decode(frame_.data); visit_(m_); return true; }\n";
+    }
+    out << "    default: return false;\n";
+    out << "    }\n";
+    out << "}\n\n";
+    out << "} // namespace " << ns << "\n";
+
+    ofstream file(argv[2]);
+    file << out.str();
+    if (!file) {
+        perror(argv[2]);
+        return 1;
+    }
+    cout << "Generated " << dbc.size() << " messages into " << argv[2] << endl;
+    return 0;
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <linux/can.h>
+#include "can-dbc.h"
+
+// DBC-driven encoder for periodic senders, using the same compiled table
+// as the decoders. set() turns a physical value into its raw field once,
+// rounding to the nearest step and saturating to the DBC [min|max] range
+// and to what the field can hold. Every message keeps its last payload;
+// frame() re-inserts only the signals whose raw value changed since the
+// previous call, so an unchanged message costs nothing to re-send.
+// Multiplexed pages share payload bits, so set only the signals of the page
+// the multiplexor selects.
+class CANEncoder {
+public:
+    explicit CANEncoder(const CANDecodeTable &t)
+        : table(t), limits(t.signalCount()), raw(t.signalCount()), dirty(t.signalCount()),
+          owner(t.signalCount()), frames(t.messageCount()), pending(t.messageCount()) {
+        for (size_t m = 0; m < t.messageCount(); m++) {
+            const CANMessageDesc &msg = t.message(m);
+            frames[m].can_id = msg.id;
+            frames[m].can_dlc = std::min<int>(msg.dlc, CAN_MAX_DLEN);
+            for (int h = msg.first_signal; h < msg.first_signal + msg.signal_count; h++) {
+                owner[h] = m;
+                limits[h] = makeLimits(t.signal(h), t.range(h));
+            }
+        }
+    }
+
+    // Set a signal by handle (CANDecodeTable::signalHandle). Returns false
+    // if the value was out of range and had to be clamped.
+    bool set(int handle, double value) {
+        const Limits &l = limits[handle];
+        bool inRange = true;
+        if (l.hasRange && !(value >= l.minimum && value <= l.maximum)) {
+            value = value > l.maximum ? l.maximum : l.minimum;     // NaN -> minimum
+            inRange = false;
+        }
+
+        double field = (value - l.offset) / l.scale;
+        if (!l.isFloat) {
+            field = std::nearbyint(field);
+            if (!(field >= l.rawMin && field <= l.rawMax)) {
+                field = field > l.rawMax ? l.rawMax : l.rawMin;
+                inRange = false;
+            }
+        }
+
+        uint64_t r = table.signal(handle).plan.toRaw(field);
+        if (r != raw[handle]) {
+            raw[handle] = r;
+            if (!dirty[handle]) {
+                dirty[handle] = 1;
+                pending[owner[handle]]++;
+            }
+        }
+        if (!inRange) clamped++;
+        return inRange;
+    }
+
+    // Current frame for msg, with any changed signals written into it
+    const can_frame &frame(const CANMessageDesc &msg) {
+        size_t m = table.messageIndex(msg);
+        can_frame &f = frames[m];
+        if (pending[m]) {
+            for (int h = msg.first_signal; h < msg.first_signal + msg.signal_count; h++) {
+                if (!dirty[h]) continue;
+                table.signal(h).plan.insert(f.data, raw[h]);
+                dirty[h] = 0;
+            }
+            pending[m] = 0;
+        }
+        return f;
+    }
+
+    // Frames for several messages in one call, e.g. everything due this cycle
+    void encode(const CANMessageDesc *const *msgs, size_t n, can_frame *out) {
+        for (size_t i = 0; i < n; i++)
+            out[i] = frame(*msgs[i]);
+    }
+
+    uint64_t clamped = 0;       // values saturated by set()
+
+private:
+    struct Limits {
+        double scale;
+        double offset;
+        double minimum;         // physical DBC range, when hasRange
+        double maximum;
+        double rawMin;          // what the field can hold
+        double rawMax;
+        bool hasRange;
+        bool isFloat;
+    };
+
+    static Limits makeLimits(const CANSignalDesc &s, const CANSignalRange &r) {
+        Limits l{};
+        l.scale = s.scale != 0 ? s.scale : 1;
+        l.offset = s.offset;
+        l.minimum = r.minimum;
+        l.maximum = r.maximum;
+        l.hasRange = r.minimum < r.maximum;
+        l.isFloat = s.plan.type == SignalType::Float32 || s.plan.type == SignalType::Float64;
+
+        // Largest integer the field holds, kept exactly representable as a
+        // double so the clamp never rounds up past the field width
+        bool isSigned = s.plan.type == SignalType::Signed;
+        int bits = s.plan.length - (isSigned ? 1 : 0);
+        double top = std::ldexp(1.0, bits);
+        l.rawMax = bits <= 53 ? top - 1 : std::nextafter(top, 0.0);
+        l.rawMin = isSigned ? -top : 0;
+        return l;
+    }
+
+    const CANDecodeTable &table;
+    std::vector<Limits> limits;
+    std::vector<uint64_t> raw;          // last raw value per signal
+    std::vector<uint8_t> dirty;         // raw changed since the last frame()
+    std::vector<uint32_t> owner;        // message index of each signal
+    std::vector<can_frame> frames;      // last payload per message
+    std::vector<uint16_t> pending;      // dirty signals per message
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <endian.h>
+#include <linux/can.h>
+
+// Support code for decoders generated by can-dbc-codegen.
+// Generated functions call these with literal shifts, masks and scales, so
+// each signal compiles down to a shift, an AND and a multiply-add, with no
+// table lookups or loops. Results match CANDecodeTable bit for bit.
+
+inline uint64_t canLoadLE(const uint8_t *d) {
+    uint64_t w;
+    memcpy(&w, d, 8);
+    return le64toh(w);
+}
+
+inline uint64_t canLoadBE(const uint8_t *d) {
+    uint64_t w;
+    memcpy(&w, d, 8);
+    return be64toh(w);
+}
+
+// Payload bytes holding little-endian word le and big-endian word be
+// (signals never overlap, so the two byte images can be OR'ed)
+inline void canStore(uint8_t *d, uint64_t le, uint64_t be) {
+    uint64_t w = htole64(le) | htobe64(be);
+    memcpy(d, &w, 8);
+}
+
+template <int Bits>
+constexpr double canSigned(uint64_t raw) {
+    return double(int64_t(raw << (64 - Bits)) >> (64 - Bits));
+}
+
+inline double canFloat32(uint64_t raw) {
+    uint32_t bits = uint32_t(raw);
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+inline double canFloat64(uint64_t raw) {
+    double v;
+    memcpy(&v, &raw, sizeof(v));
+    return v;
+}
+
+// Raw field values, rounded to the nearest step like CANEncoder
+inline uint64_t canRawUnsigned(double v) { return v <= 0 ? 0 : uint64_t(std::nearbyint(v)); }
+inline uint64_t canRawSigned(double v) { return uint64_t(int64_t(std::nearbyint(v))); }
+
+inline uint64_t canRawFloat32(double v) {
+    float f = float(v);
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+inline uint64_t canRawFloat64(double v) {
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return bits;
+}
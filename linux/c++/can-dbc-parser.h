@@ -0,0 +1,345 @@
+#pragma once
+
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "can-dbc.h"
+
+// Streaming .dbc parser.
+// Reads BO_ messages, SG_ signals (with multiplexor indicators), VAL_
+// value tables, SIG_VALTYPE_ float types, SG_MUL_VAL_ extended multiplexing
+// and the GenMsgCycleTime BA_ attribute into a DBCMap, one pass over an mmap'ed file with no
+// per-token allocation. Other sections are skipped. Errors carry the
+// 1-based source line and do not stop the parse.
+
+struct DBCError {
+    int line;
+    std::string message;
+};
+
+class DBCParser {
+public:
+    DBCParser(std::string_view text, DBCMap &out, std::vector<DBCError> &errors)
+        : src(text), dbc(out), errs(errors) {}
+
+    void parse() {
+        size_t pos = 0;
+        int line = 0;
+        bool inNamespace = false;
+        while (pos < src.size()) {
+            size_t end = src.find('\n', pos);
+            if (end == std::string_view::npos) end = src.size();
+            std::string_view text = src.substr(pos, end - pos);
+            line++;
+            size_t next = end + 1;
+
+            bool indented = !text.empty() && (text[0] == ' ' || text[0] == '\t');
+            Cursor c{text, line};
+            c.ws();
+            if (c.done()) { pos = next; continue; }
+
+            // NS_ lists keyword names on indented lines until the next section
+            if (inNamespace && indented) { pos = next; continue; }
+            inNamespace = false;
+
+            std::string_view kw = c.ident();
+            if (kw == "BO_") {
+                parseMessage(c);
+            } else if (kw == "SG_") {
+                parseSignal(c);
+            } else if (kw == "NS_") {
+                inNamespace = true;
+            } else if (kw == "VERSION" || kw == "BS_" || kw == "BU_") {
+                // single-line sections with nothing to keep
+            } else if (kw.empty()) {
+                error(line, "unexpected character '" + std::string(1, c.peek()) + "'");
+            } else {
+                // ';'-terminated statement, possibly spanning several lines
+                size_t stmtEnd = statementEnd(pos + (c.rest().data() - text.data()));
+                std::string_view stmt = src.substr(pos, stmtEnd - pos);
+                Cursor sc{stmt, line};
+                sc.ws();
+                sc.ident();
+                if (kw == "VAL_") parseValueTable(sc);
+                else if (kw == "BA_") parseAttribute(sc);
+                else if (kw == "SIG_VALTYPE_") parseValueType(sc);
+                else if (kw == "SG_MUL_VAL_") parseMuxValues(sc);
+
+                for (size_t i = pos; i < stmtEnd && i < src.size(); i++)
+                    if (src[i] == '\n') line++;
+                end = src.find('\n', stmtEnd);
+                if (end == std::string_view::npos) end = src.size();
+                next = end + 1;
+            }
+            pos = next;
+        }
+    }
+
+private:
+    // Token cursor over one line or statement
+    struct Cursor {
+        std::string_view s;
+        int line;
+        size_t i = 0;
+
+        bool done() const { return i >= s.size(); }
+        char peek() const { return done() ? '\0' : s[i]; }
+        std::string_view rest() const { return s.substr(i); }
+
+        void ws() {
+            while (!done() && (s[i] == ' ' || s[i] == '\t' || s[i] == '\r' || s[i] == '\n')) i++;
+        }
+
+        bool accept(char ch) {
+            ws();
+            if (peek() != ch) return false;
+            i++;
+            return true;
+        }
+
+        std::string_view ident() {
+            ws();
+            size_t b = i;
+            while (!done() && (isalnum((unsigned char)s[i]) || s[i] == '_')) i++;
+            return s.substr(b, i - b);
+        }
+
+        bool quoted(std::string_view &out) {
+            ws();
+            if (peek() != '"') return false;
+            size_t b = ++i;
+            while (!done() && s[i] != '"') i++;
+            if (done()) return false;
+            out = s.substr(b, i - b);
+            i++;
+            return true;
+        }
+
+        template <typename T>
+        bool number(T &v) {
+            ws();
+            if (peek() == '+') i++;
+            auto r = std::from_chars(s.data() + i, s.data() + s.size(), v);
+            if (r.ec != std::errc()) return false;
+            i = r.ptr - s.data();
+            return true;
+        }
+    };
+
+    void error(int line, std::string msg) { errs.push_back({line, std::move(msg)}); }
+
+    // Offset just past the ';' ending a statement, ignoring ';' in strings
+    size_t statementEnd(size_t from) const {
+        bool inString = false;
+        for (size_t i = from; i < src.size(); i++) {
+            if (src[i] == '"') inString = !inString;
+            else if (src[i] == ';' && !inString) return i + 1;
+        }
+        return src.size();
+    }
+
+    // BO_ <id> <name>: <dlc> <transmitter>
+    void parseMessage(Cursor &c) {
+        uint32_t id;
+        current = nullptr;
+        skipSignals = true;     // until this message header parses
+        if (!c.number(id)) { error(c.line, "BO_: expected message ID"); return; }
+        std::string_view name = c.ident();
+        int dlc = 0;
+        if (name.empty() || !c.accept(':') || !c.number(dlc)) {
+            error(c.line, "BO_: expected '<name>: <dlc>'");
+            return;
+        }
+        // Pseudo-message holding unassigned signals
+        if (id == 0xC0000000) return;
+        skipSignals = false;
+
+        CANMessageDef &m = dbc[id];
+        m.name = std::string(name);
+        m.dlc = dlc;
+        m.transmitter = std::string(c.ident());
+        current = &m;
+    }
+
+    // SG_ <name> [M|mN|mNM] : <start>|<len>@<order><sign> (<scale>,<offset>) [<min>|<max>] "<unit>" <receivers>
+    void parseSignal(Cursor &c) {
+        if (!current) {
+            if (!skipSignals) error(c.line, "SG_ outside of a BO_ message");
+            return;
+        }
+        Signal sig{};
+        sig.name = std::string(c.ident());
+        if (sig.name.empty()) { error(c.line, "SG_: expected signal name"); return; }
+
+        std::string_view mux = c.ident();
+        if (!mux.empty()) {
+            if (mux == "M") {
+                sig.multiplexor = true;
+            } else if (mux[0] == 'm') {
+                int v = 0;
+                auto r = std::from_chars(mux.data() + 1, mux.data() + mux.size(), v);
+                if (r.ec != std::errc()) { error(c.line, "SG_: bad multiplexer indicator"); return; }
+                sig.mux_value = v;
+                sig.multiplexor = r.ptr != mux.data() + mux.size() && *r.ptr == 'M';
+            } else {
+                error(c.line, "SG_: bad multiplexer indicator");
+                return;
+            }
+        }
+
+        char order = 0, sign = 0;
+        float scale = 1, offset = 0;
+        std::string_view unit;
+        bool ok = c.accept(':') && c.number(sig.start_bit) && c.accept('|') &&
+                  c.number(sig.length) && c.accept('@');
+        if (ok && !c.done()) order = c.s[c.i++];
+        if (ok && !c.done()) sign = c.s[c.i++];
+        ok = ok && (order == '0' || order == '1') && (sign == '+' || sign == '-') &&
+             c.accept('(') && c.number(scale) && c.accept(',') && c.number(offset) &&
+             c.accept(')') && c.accept('[') && c.number(sig.minimum) && c.accept('|') &&
+             c.number(sig.maximum) && c.accept(']') && c.quoted(unit);
+        if (!ok) { error(c.line, "SG_ " + sig.name + ": malformed signal definition"); return; }
+
+        sig.scale = scale;
+        sig.offset = offset;
+        sig.unit = std::string(unit);
+        sig.byte_order = order == '1' ? ByteOrder::Intel : ByteOrder::Motorola;
+        sig.type = sign == '-' ? SignalType::Signed : SignalType::Unsigned;
+        if (!SignalPlan::make(sig.start_bit, sig.length, sig.byte_order, sig.type).valid())
+            error(c.line, "SG_ " + sig.name + ": signal does not fit in 8 bytes");
+        current->signals.push_back(std::move(sig));
+    }
+
+    Signal *findSignal(Cursor &c, uint32_t id, std::string_view name) {
+        auto it = dbc.find(id);
+        if (it != dbc.end())
+            for (auto &s : it->second.signals)
+                if (s.name == name) return &s;
+        error(c.line, "unknown signal " + std::string(name));
+        return nullptr;
+    }
+
+    // VAL_ <id> <signal> <value> "<text>" ... ;
+    void parseValueTable(Cursor &c) {
+        uint32_t id;
+        if (!c.number(id)) return;   // VAL_ on environment variables
+        Signal *sig = findSignal(c, id, c.ident());
+        if (!sig) return;
+        int64_t v;
+        std::string_view text;
+        while (c.number(v) && c.quoted(text))
+            sig->value_names[v] = std::string(text);
+    }
+
+    // BA_ "GenMsgCycleTime" BO_ <id> <ms> ;
+    void parseAttribute(Cursor &c) {
+        std::string_view attr;
+        if (!c.quoted(attr) || attr != "GenMsgCycleTime") return;
+        uint32_t id;
+        int ms;
+        if (c.ident() != "BO_" || !c.number(id) || !c.number(ms)) {
+            error(c.line, "BA_ GenMsgCycleTime: expected 'BO_ <id> <ms>'");
+            return;
+        }
+        auto it = dbc.find(id);
+        if (it != dbc.end()) it->second.cycle_time_ms = ms;
+    }
+
+    // SIG_VALTYPE_ <id> <signal> : <1 = float, 2 = double> ;
+    void parseValueType(Cursor &c) {
+        uint32_t id;
+        int kind;
+        if (!c.number(id)) return;
+        Signal *sig = findSignal(c, id, c.ident());
+        c.accept(':');
+        if (!sig || !c.number(kind)) return;
+        if (kind == 1) { sig->type = SignalType::Float32; sig->length = 32; }
+        if (kind == 2) { sig->type = SignalType::Float64; sig->length = 64; }
+    }
+
+    // SG_MUL_VAL_ <id> <signal> <switch> <from>-<to>, ... ;
+    void parseMuxValues(Cursor &c) {
+        uint32_t id;
+        if (!c.number(id)) { error(c.line, "SG_MUL_VAL_: expected message ID"); return; }
+        Signal *sig = findSignal(c, id, c.ident());
+        std::string_view sw = c.ident();
+        if (!sig) return;
+        if (sw.empty()) { error(c.line, "SG_MUL_VAL_ " + sig->name + ": expected switch name"); return; }
+
+        sig->mux_switch = std::string(sw);
+        sig->mux_ranges.clear();
+        do {
+            uint32_t from, to;
+            if (!c.number(from) || !c.accept('-') || !c.number(to) || to < from) {
+                error(c.line, "SG_MUL_VAL_ " + sig->name + ": expected '<from>-<to>'");
+                return;
+            }
+            sig->mux_ranges.push_back({from, to});
+        } while (c.accept(','));
+    }
+
+    std::string_view src;
+    DBCMap &dbc;
+    std::vector<DBCError> &errs;
+    CANMessageDef *current = nullptr;
+    bool skipSignals = false;
+};
+
+// Read-only mapping of a whole file
+class MappedFile {
+public:
+    explicit MappedFile(const std::string &path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0) {
+            len = st.st_size;
+            ok = true;
+            if (len > 0) {
+                void *m = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (m == MAP_FAILED) ok = false;
+                else ptr = static_cast<const char *>(m);
+            }
+        }
+        close(fd);
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile() {
+        if (ptr) munmap(const_cast<char *>(ptr), len);
+    }
+
+    bool valid() const { return ok; }
+    const char *data() const { return ptr; }
+    size_t size() const { return len; }
+    std::string_view text() const { return ptr ? std::string_view(ptr, len) : std::string_view(); }
+
+    // Stop owning the mapping; the caller must munmap(data(), size())
+    void release() { ptr = nullptr; }
+
+private:
+    const char *ptr = nullptr;
+    size_t len = 0;
+    bool ok = false;
+};
+
+// Parse a .dbc file into dbc. Returns false if the file could not be read
+// or any line failed to parse; errors lists each problem with its line.
+inline bool loadDBC(const std::string &path, DBCMap &dbc, std::vector<DBCError> &errors) {
+    MappedFile file(path);
+    if (!file.valid()) { errors.push_back({0, "cannot read file"}); return false; }
+    if (file.data()) madvise(const_cast<char *>(file.data()), file.size(), MADV_SEQUENTIAL);
+
+    size_t before = errors.size();
+    DBCParser(file.text(), dbc, errors).parse();
+    return errors.size() == before;
+}
@@ -14,25 +14,14 @@
 #include <sys/socket.h>
 #include <linux/can.h>
 #include <linux/can/raw.h>
+#include "can-rx.h"
+#include "can-dbc.h"
+#include "can-dbc-cache.h"
+#include "can-dbc-encode.h"
+#include "can-j1939.h"
 
 using namespace std;
 
-// DBC-style signal definition
-struct Signal {
-    string name;
-    int start_bit;
-    int length;
-    float scale;
-    float offset;
-    string unit;
-};
-
-// Each CAN ID has multiple signals
-struct CANMessageDef {
-    string name;
-    vector<Signal> signals;
-};
-
 // DBC database
 map<unsigned int, CANMessageDef> dbc_map = {
     {0x100, {"EngineData", {
@@ -42,51 +31,46 @@ map<unsigned int, CANMessageDef> dbc_map = {
     }}}
 };
 
-void encodeSignals(struct can_frame &frame, float temp, float volt, int rpm) {
-    frame.can_id = 0x100;
-    frame.can_dlc = 8;
-    memset(frame.data, 0, 8);
-
-    // Apply DBC scaling & pack
-    int16_t temp_raw = static_cast<int16_t>((temp - 0.0f) / 0.01f);
-    int16_t volt_raw = static_cast<int16_t>((volt - 0.0f) / 0.01f);
-    int32_t rpm_raw  = static_cast<int32_t>((rpm - 0.0f) / 1.0f);
-
-    frame.data[0] = temp_raw & 0xFF;
-    frame.data[1] = (temp_raw >> 8) & 0xFF;
-    frame.data[2] = volt_raw & 0xFF;
-    frame.data[3] = (volt_raw >> 8) & 0xFF;
-    frame.data[4] = rpm_raw & 0xFF;
-    frame.data[5] = (rpm_raw >> 8) & 0xFF;
-    frame.data[6] = (rpm_raw >> 16) & 0xFF;
-    frame.data[7] = (rpm_raw >> 24) & 0xFF;
+// Compiled once at startup; encoding and decoding never touch dbc_map
+CANDecodeTable dbc_table(dbc_map);
+
+// --j1939[=addr]: match 29-bit frames by PGN and reassemble transport
+// protocol transfers, answering RTS/CTS sent to addr if one is given
+bool j1939_mode = false;
+uint8_t j1939_address = J1939_NULL;
+
+void printSignals(const CANMessageDesc &msg, const uint8_t *data) {
+    dbc_table.decodeEach(msg, data, [](int h, float physical) {
+        const CANSignalDesc &sig = dbc_table.signal(h);
+        cout << "  " << setw(12) << left << dbc_table.str(sig.name) << " : "
+             << setw(8) << fixed << setprecision(2) << physical << " " << dbc_table.str(sig.unit) << endl;
+    });
 }
 
-// Decode dynamically using DBC map
-void decodeFrame(const struct can_frame &frame) {
-    unsigned int can_id = frame.can_id & CAN_SFF_MASK;
+// Decode dynamically using the compiled DBC table
+void decodeFrame(const struct can_frame &frame, const J1939Index *j1939) {
+    const CANMessageDesc *msg = j1939 ? j1939->find(frame.can_id) : dbc_table.find(frame.can_id);
 
-    if (dbc_map.find(can_id) == dbc_map.end()) {
-        cout << "[Receiver] Unknown CAN ID 0x" << hex << uppercase << can_id << dec << endl;
+    if (!msg) {
+        cout << "[Receiver] Unknown CAN ID 0x" << hex << uppercase << (frame.can_id & CAN_EFF_MASK) << dec << endl;
         return;
     }
 
-    auto msgDef = dbc_map[can_id];
-
-    for (auto &sig : msgDef.signals) {
-        // Extract raw value (little-endian)
-        unsigned long raw_val = 0;
-        int byte_start = sig.start_bit / 8;
-        int byte_len = sig.length / 8;
-        for (int i = 0; i < byte_len; i++)
-            raw_val |= ((unsigned long)frame.data[byte_start + i] << (8 * i));
-
-        // Apply scaling & offset
-        float physical = raw_val * sig.scale + sig.offset;
-
-        cout << "  " << setw(12) << left << sig.name << " : "
-             << setw(8) << fixed << setprecision(2) << physical << " " << sig.unit << endl;
+    if (j1939 && (frame.can_id & CAN_EFF_FLAG)) {
+        J1939Id id = J1939Id::parse(frame.can_id);
+        cout << "[Receiver] " << dbc_table.str(msg->name) << " PGN 0x" << hex << uppercase << id.pgn
+             << " from 0x" << int(id.source) << dec << endl;
     }
+    printSignals(*msg, frame.data);
+}
+
+// Reassembled transport-protocol message; signals past the first 8 bytes
+// are not decoded
+void decodeTransfer(const J1939Message &m, const J1939Index &j1939) {
+    const CANMessageDesc *msg = j1939.findPgn(m.pgn);
+    cout << "[Receiver] " << (msg ? dbc_table.str(msg->name) : "Transfer") << " PGN 0x" << hex << uppercase
+         << m.pgn << " from 0x" << int(m.source) << dec << ", " << m.size << " bytes" << endl;
+    if (msg) printSignals(*msg, m.data);
 }
 
 // Sender thread
@@ -110,7 +94,17 @@ void senderThread(const char *ifname) {
         return;
     }
 
-    struct can_frame frame{};
+    // Encoded from the same compiled table the receiver decodes with
+    CANEncoder encoder(dbc_table);
+    const CANMessageDesc *engineData = dbc_table.find(0x100);
+    const int engineTemp = dbc_table.signalHandle("EngineTemp");
+    const int batteryVolt = dbc_table.signalHandle("BatteryVolt");
+    const int engineRpm = dbc_table.signalHandle("RPM");
+    if (!engineData || engineTemp < 0 || batteryVolt < 0 || engineRpm < 0) {
+        cerr << "[Sender] DBC has no EngineData (0x100) with EngineTemp/BatteryVolt/RPM\n";
+        close(s);
+        return;
+    }
     srand(time(0));
 
     while (true) {
@@ -118,7 +112,10 @@ void senderThread(const char *ifname) {
         float volt = 12.0f + (rand() % 100) / 10.0f;   // 12.0–22.0 V
         int rpm = 800 + (rand() % 6000);               // 800–6800 rpm
 
-        encodeSignals(frame, temp, volt, rpm);
+        encoder.set(engineTemp, temp);
+        encoder.set(batteryVolt, volt);
+        encoder.set(engineRpm, rpm);
+        const can_frame &frame = encoder.frame(*engineData);
 
         if (write(s, &frame, sizeof(frame)) != sizeof(frame))
             perror("Sender Write");
@@ -152,23 +149,55 @@ void receiverThread(const char *ifname) {
 
     cout << "[Receiver] Listening on " << ifname << "..." << endl;
 
-    struct can_frame frame{};
+    J1939Index j1939(dbc_table);
+    J1939Transport<> transport(j1939_address);
+    auto deliver = [&](const J1939Message &m) { decodeTransfer(m, j1939); };
+    auto reply = [s](const can_frame &f) {
+        if (write(s, &f, sizeof(f)) != sizeof(f)) perror("Receiver TP reply");
+    };
+
+    CANReceiver rx(s);
     while (true) {
-        int nbytes = read(s, &frame, sizeof(frame));
-        if (nbytes < 0) {
+        int n = rx.receive();
+        if (n < 0) {
             perror("Receiver Read");
             break;
         }
 
-        decodeFrame(frame);
+        for (int k = 0; k < n; k++) {
+            if (j1939_mode && transport.receive(rx.frame(k), rx.timestampNs(k), deliver, reply))
+                continue;
+            decodeFrame(rx.frame(k), j1939_mode ? &j1939 : nullptr);
+        }
     }
 
     close(s);
 }
 
-int main() {
+int main(int argc, char **argv) {
     const char *ifname = "vcan0";
 
+    // Optional .dbc file replaces the built-in definitions; the compiled
+    // table is cached next to it and reused while the file is unchanged
+    const char *dbcPath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--j1939", 7) == 0) {
+            j1939_mode = true;
+            if (argv[i][7] == '=') j1939_address = strtoul(argv[i] + 8, nullptr, 0);
+        } else {
+            dbcPath = argv[i];
+        }
+    }
+    if (dbcPath) {
+        vector<DBCError> errors;
+        if (!loadDBCCached(dbcPath, dbc_table, errors)) {
+            for (auto &e : errors)
+                cerr << dbcPath << ":" << e.line << ": " << e.message << endl;
+            return 1;
+        }
+        cout << "Loaded " << dbc_table.messageCount() << " messages from " << dbcPath << endl;
+    }
+
     thread sender(senderThread, ifname);
     thread receiver(receiverThread, ifname);
 
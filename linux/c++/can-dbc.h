@@ -0,0 +1,724 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <sys/mman.h>
+#include <linux/can.h>
+#include "can-signal.h"
+
+// DBC-style signal definition. Hand-written tables list the fields up to
+// unit; everything after has a default so they stay complete initialisers.
+struct Signal {
+    std::string name;
+    int start_bit;
+    int length;
+    float scale;
+    float offset;
+    std::string unit;
+    ByteOrder byte_order = ByteOrder::Intel;
+    SignalType type = SignalType::Unsigned;
+    float minimum = 0;
+    float maximum = 0;
+    bool multiplexor = false;       // M: selects which mux page is present
+    int mux_value = -1;             // mN: only present when multiplexor == N
+    // Extended multiplexing (SG_MUL_VAL_): present when mux_switch holds a
+    // value in one of mux_ranges; overrides mux_value
+    std::string mux_switch = {};
+    std::vector<std::pair<uint32_t, uint32_t>> mux_ranges = {};
+    std::map<int64_t, std::string> value_names = {};   // VAL_ table
+};
+
+// Each CAN ID has multiple signals
+struct CANMessageDef {
+    std::string name;
+    std::vector<Signal> signals;
+    int dlc = 8;
+    int cycle_time_ms = 0;          // BA_ "GenMsgCycleTime", 0 if event-driven
+    std::string transmitter = {};
+};
+
+// Multiplexing of one message, resolved from simple (M / mN) and extended
+// (SG_MUL_VAL_) definitions: switchOf[i] is the index of the multiplexor
+// that selects signal i (-1 if always present), when[i] the raw switch
+// values for which it is present.
+struct DBCMuxInfo {
+    std::vector<int> switchOf;
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> when;
+    bool multiplexed = false;
+};
+
+inline DBCMuxInfo resolveMux(const CANMessageDef &def) {
+    int n = def.signals.size();
+    int root = -1;
+    for (int i = 0; i < n && root < 0; i++) {
+        const Signal &s = def.signals[i];
+        if (s.multiplexor && s.mux_value < 0 && s.mux_ranges.empty()) root = i;
+    }
+
+    DBCMuxInfo info;
+    info.switchOf.assign(n, -1);
+    info.when.resize(n);
+    for (int i = 0; i < n; i++) {
+        const Signal &s = def.signals[i];
+        if (!s.mux_ranges.empty()) {
+            for (int j = 0; j < n; j++)
+                if (def.signals[j].name == s.mux_switch) info.switchOf[i] = j;
+            info.when[i] = s.mux_ranges;
+        } else if (s.mux_value >= 0 && root >= 0) {
+            info.switchOf[i] = root;
+            info.when[i] = {{uint32_t(s.mux_value), uint32_t(s.mux_value)}};
+        }
+        if (info.switchOf[i] == i) info.switchOf[i] = -1;
+        if (info.switchOf[i] >= 0) info.multiplexed = true;
+    }
+    return info;
+}
+
+// DBC database keyed by CAN ID; bit 31 (CAN_EFF_FLAG) marks 29-bit IDs,
+// the same convention .dbc files use
+using DBCMap = std::map<unsigned int, CANMessageDef>;
+
+// Compiled signal descriptor: immutable, 32 bytes, two per cache line
+struct alignas(32) CANSignalDesc {
+    SignalPlan plan;        // 16 bytes
+    float scale;
+    float offset;
+    uint32_t name;          // byte offset into the table's string pool
+    uint32_t unit;
+};
+
+struct CANMessageDesc {
+    uint32_t id;            // as in DBCMap, with CAN_EFF_FLAG for 29-bit
+    uint16_t first_signal;
+    uint16_t signal_count;
+    uint32_t name;
+    uint16_t cycle_time_ms;
+    uint8_t dlc;
+    uint8_t multiplexed;    // 0 plain, 1 one multiplexor, 2 several (nested)
+    uint16_t mux_root;      // CANMuxSwitch index of the top multiplexor
+    uint16_t base_count;    // unconditional signals, in the page signal list,
+    uint32_t base_first;    // used when the top multiplexor selects no page
+};
+
+// One multiplexor signal and the pages it selects. Page v lists the signals
+// present when the multiplexor's raw value is v, so dispatch is a direct
+// index; values >= page_count select nothing. Pages of a message's top
+// multiplexor also list its unconditional signals, so a simply multiplexed
+// frame decodes as one walk over one list, like a plain message.
+struct CANMuxSwitch {
+    uint16_t signal;
+    uint16_t page_count;
+    uint32_t first_page;
+};
+
+struct CANMuxPage {
+    uint32_t first;         // into the page signal list
+    uint32_t count;
+};
+
+// Physical range of a signal, kept apart from the hot decode descriptors.
+// minimum == maximum means the DBC gives no range.
+struct CANSignalRange {
+    float minimum;
+    float maximum;
+};
+
+// Minimal perfect hash over 29-bit IDs (hash-and-displace).
+// Keys are split into small buckets; each bucket gets a seed that places
+// all its keys into free slots, so lookup is two hashes and one compare.
+class CANIdHash {
+public:
+    // Read-only lookup over the hash arrays, wherever they are stored
+    struct View {
+        const uint32_t *seeds = nullptr;
+        const uint32_t *keys = nullptr;
+        const uint32_t *values = nullptr;
+        uint32_t seedCount = 0;
+        uint32_t slotCount = 0;     // power of two
+
+        // Value stored for key, or -1 when the key is not in the set
+        int find(uint32_t key) const {
+            if (!seedCount) return -1;
+            uint32_t seed = seeds[mix(key, 0) % seedCount];
+            uint32_t slot = mix(key, seed) & (slotCount - 1);
+            return keys[slot] == key ? int(values[slot]) : -1;
+        }
+    };
+
+    void build(const std::vector<uint32_t> &keys) {
+        for (size_t slotsLog = 1;; slotsLog++) {
+            size_t slots = size_t(1) << slotsLog;
+            if (slots < keys.size() + keys.size() / 4) continue;
+            if (tryBuild(keys, slots)) return;
+        }
+    }
+
+    int find(uint32_t key) const { return view().find(key); }
+
+    void setValue(uint32_t key, uint32_t value) {
+        uint32_t seed = seeds[mix(key, 0) % seeds.size()];
+        slotValues[mix(key, seed) & (slotKeys.size() - 1)] = value;
+    }
+
+    View view() const {
+        return {seeds.data(), slotKeys.data(), slotValues.data(),
+                uint32_t(seeds.size()), uint32_t(slotKeys.size())};
+    }
+
+private:
+    static constexpr uint32_t EMPTY = 0xFFFFFFFF;
+
+    static uint32_t mix(uint32_t key, uint32_t seed) {
+        uint64_t h = (uint64_t(key) | (uint64_t(seed) << 32)) * 0x9E3779B97F4A7C15ull;
+        h ^= h >> 31;
+        h *= 0xBF58476D1CE4E5B9ull;
+        return uint32_t(h >> 32);
+    }
+
+    bool tryBuild(const std::vector<uint32_t> &keys, size_t slots) {
+        size_t bucketCount = keys.size() / 2 + 1;
+        std::vector<std::vector<uint32_t>> buckets(bucketCount);
+        for (uint32_t k : keys)
+            buckets[mix(k, 0) % bucketCount].push_back(k);
+
+        std::vector<size_t> order(bucketCount);
+        for (size_t i = 0; i < bucketCount; i++) order[i] = i;
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return buckets[a].size() > buckets[b].size();
+        });
+
+        seeds.assign(bucketCount, 0);
+        slotKeys.assign(slots, EMPTY);
+        slotValues.assign(slots, 0);
+
+        std::vector<uint32_t> placed;
+        for (size_t b : order) {
+            if (buckets[b].empty()) break;
+            bool ok = false;
+            for (uint32_t seed = 1; seed < 100000 && !ok; seed++) {
+                placed.clear();
+                ok = true;
+                for (uint32_t k : buckets[b]) {
+                    uint32_t slot = mix(k, seed) & (slots - 1);
+                    if (slotKeys[slot] != EMPTY ||
+                        std::find(placed.begin(), placed.end(), slot) != placed.end()) {
+                        ok = false;
+                        break;
+                    }
+                    placed.push_back(slot);
+                }
+                if (ok) {
+                    seeds[b] = seed;
+                    for (size_t i = 0; i < placed.size(); i++)
+                        slotKeys[placed[i]] = buckets[b][i];
+                }
+            }
+            if (!ok) return false;
+        }
+        return true;
+    }
+
+    std::vector<uint32_t> seeds;
+    std::vector<uint32_t> slotKeys;
+    std::vector<uint32_t> slotValues;
+};
+
+// Header of a compiled table image. Every reference inside the image is an
+// index or a byte offset from its start, so the same bytes serve as the
+// in-memory table and as an mmap'ed cache file with no fixups.
+struct CANTableHeader {
+    static constexpr char MAGIC[8] = {'C', 'A', 'N', 'D', 'B', 'C', 'T', '\0'};
+    static constexpr uint32_t VERSION = 4;  // bump on any layout change
+
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t source_hash;       // hash of the .dbc text, 0 if built in code
+    uint64_t image_size;
+    uint32_t msg_count;
+    uint32_t sig_count;
+    uint32_t seed_count;
+    uint32_t slot_count;
+    uint32_t string_bytes;
+    uint32_t switch_count;
+    uint32_t page_count;
+    uint32_t page_signal_count;
+    uint32_t sff_offset;        // uint16_t[2048]
+    uint32_t seeds_offset;      // uint32_t[seed_count]
+    uint32_t keys_offset;       // uint32_t[slot_count]
+    uint32_t values_offset;     // uint32_t[slot_count]
+    uint32_t msgs_offset;       // CANMessageDesc[msg_count]
+    uint32_t sigs_offset;       // CANSignalDesc[sig_count]
+    uint32_t ranges_offset;     // CANSignalRange[sig_count]
+    uint32_t switch_of_offset;  // uint16_t[sig_count], CANMuxSwitch index or NONE
+    uint32_t switches_offset;   // CANMuxSwitch[switch_count]
+    uint32_t pages_offset;      // CANMuxPage[page_count]
+    uint32_t page_signals_offset;   // uint16_t[page_signal_count]
+    uint32_t strings_offset;    // NUL-terminated names and units
+};
+
+// Compiled decode table built once from a DBCMap.
+// 11-bit IDs resolve through a 2048-entry direct index, 29-bit IDs through
+// CANIdHash. Signal descriptors for a message are contiguous, so decoding a
+// frame is one lookup plus a linear walk with no allocation.
+class CANDecodeTable {
+public:
+    static constexpr uint16_t NONE = 0xFFFF;
+
+    CANDecodeTable() : CANDecodeTable(DBCMap()) {}
+
+    // Message indices and signal handles are 16-bit with NONE reserved
+    static constexpr size_t MAX_ENTRIES = NONE;
+
+    // Multiplexor pages are direct-indexed by a 16-bit count, so the
+    // highest selector value that can have a page of its own
+    static constexpr uint32_t MAX_MUX_VALUE = 0xFFFE;
+
+    // Whether dbc's messages and signals fit the 16-bit indices and its
+    // multiplexor values the page tables. Loaders report an error for
+    // DBCs that do not; the constructor builds an empty table for them
+    // rather than wrap or drop pages.
+    static bool fits(const DBCMap &dbc) {
+        size_t signals = 0;
+        for (auto &entry : dbc) signals += entry.second.signals.size();
+        return dbc.size() <= MAX_ENTRIES && signals <= MAX_ENTRIES && muxFits(dbc);
+    }
+
+    static bool muxFits(const DBCMap &dbc) {
+        for (auto &entry : dbc) {
+            const CANMessageDef &def = entry.second;
+            DBCMuxInfo info = resolveMux(def);
+            for (int sw : info.switchOf)
+                if (sw >= 0 && muxTop(def, info, sw) > MAX_MUX_VALUE) return false;
+        }
+        return true;
+    }
+
+    explicit CANDecodeTable(const DBCMap &dbc, uint64_t sourceHash = 0) {
+        if (!fits(dbc)) {
+            *this = CANDecodeTable();
+            return;
+        }
+        std::vector<CANMessageDesc> msgs;
+        std::vector<CANSignalDesc> sigs;
+        std::vector<CANSignalRange> ranges;
+        Mux mux;
+        std::string pool;
+        std::unordered_map<std::string, uint32_t> interned;
+        auto intern = [&](const std::string &str) {
+            auto [it, added] = interned.emplace(str, pool.size());
+            if (added) pool.append(str).push_back('\0');
+            return it->second;
+        };
+
+        std::array<uint16_t, 2048> sffIndex;
+        sffIndex.fill(NONE);
+        std::vector<uint32_t> effKeys;
+        for (auto &[id, def] : dbc) {
+            CANMessageDesc m{};
+            m.id = id;
+            m.first_signal = sigs.size();
+            m.signal_count = def.signals.size();
+            m.name = intern(def.name);
+            m.cycle_time_ms = std::min(def.cycle_time_ms, 0xFFFF);
+            m.dlc = def.dlc;
+            for (auto &s : def.signals) {
+                CANSignalDesc d{};
+                d.plan = SignalPlan::make(s.start_bit, s.length, s.byte_order, s.type);
+                d.scale = s.scale;
+                d.offset = s.offset;
+                d.name = intern(s.name);
+                d.unit = intern(s.unit);
+                sigs.push_back(d);
+                ranges.push_back({s.minimum, s.maximum});
+            }
+            mux.switchOf.resize(sigs.size(), NONE);
+            buildMux(def, m, mux);
+
+            uint16_t index = msgs.size();
+            msgs.push_back(m);
+            if (id & CAN_EFF_FLAG) effKeys.push_back(id & CAN_EFF_MASK);
+            else sffIndex[id & CAN_SFF_MASK] = index;
+        }
+
+        CANIdHash effHash;
+        effHash.build(effKeys);
+        for (auto &m : msgs)
+            if (m.id & CAN_EFF_FLAG)
+                effHash.setValue(m.id & CAN_EFF_MASK, &m - msgs.data());
+        CANIdHash::View eff = effHash.view();
+
+        // Lay the sections out back to back, each 32-byte aligned
+        CANTableHeader h{};
+        memcpy(h.magic, CANTableHeader::MAGIC, sizeof(h.magic));
+        h.version = CANTableHeader::VERSION;
+        h.header_size = sizeof(h);
+        h.source_hash = sourceHash;
+        h.msg_count = msgs.size();
+        h.sig_count = sigs.size();
+        h.seed_count = eff.seedCount;
+        h.slot_count = eff.slotCount;
+        h.string_bytes = pool.size();
+        h.switch_count = mux.switches.size();
+        h.page_count = mux.pages.size();
+        h.page_signal_count = mux.pageSignals.size();
+        size_t end = sizeof(h);
+        auto section = [&](size_t bytes) {
+            size_t at = (end + 31) & ~size_t(31);
+            end = at + bytes;
+            return uint32_t(at);
+        };
+        h.sff_offset = section(sizeof(sffIndex));
+        h.seeds_offset = section(h.seed_count * 4);
+        h.keys_offset = section(h.slot_count * 4);
+        h.values_offset = section(h.slot_count * 4);
+        h.msgs_offset = section(msgs.size() * sizeof(CANMessageDesc));
+        h.sigs_offset = section(sigs.size() * sizeof(CANSignalDesc));
+        h.ranges_offset = section(ranges.size() * sizeof(CANSignalRange));
+        h.switch_of_offset = section(sigs.size() * 2);
+        h.switches_offset = section(mux.switches.size() * sizeof(CANMuxSwitch));
+        h.pages_offset = section(mux.pages.size() * sizeof(CANMuxPage));
+        h.page_signals_offset = section(mux.pageSignals.size() * 2);
+        h.strings_offset = section(pool.size());
+        h.image_size = end;
+
+        owned.resize((end + sizeof(Block) - 1) / sizeof(Block));
+        uint8_t *img = owned.data()->bytes;
+        memcpy(img, &h, sizeof(h));
+        memcpy(img + h.sff_offset, sffIndex.data(), sizeof(sffIndex));
+        memcpy(img + h.seeds_offset, eff.seeds, h.seed_count * 4);
+        memcpy(img + h.keys_offset, eff.keys, h.slot_count * 4);
+        memcpy(img + h.values_offset, eff.values, h.slot_count * 4);
+        memcpy(img + h.msgs_offset, msgs.data(), msgs.size() * sizeof(CANMessageDesc));
+        memcpy(img + h.sigs_offset, sigs.data(), sigs.size() * sizeof(CANSignalDesc));
+        memcpy(img + h.ranges_offset, ranges.data(), ranges.size() * sizeof(CANSignalRange));
+        memcpy(img + h.switch_of_offset, mux.switchOf.data(), sigs.size() * 2);
+        memcpy(img + h.switches_offset, mux.switches.data(), mux.switches.size() * sizeof(CANMuxSwitch));
+        memcpy(img + h.pages_offset, mux.pages.data(), mux.pages.size() * sizeof(CANMuxPage));
+        memcpy(img + h.page_signals_offset, mux.pageSignals.data(), mux.pageSignals.size() * 2);
+        memcpy(img + h.strings_offset, pool.data(), pool.size());
+        attach(img);
+    }
+
+    CANDecodeTable(CANDecodeTable &&o) noexcept { *this = std::move(o); }
+
+    CANDecodeTable &operator=(CANDecodeTable &&o) noexcept {
+        if (this != &o) {
+            release();
+            owned = std::move(o.owned);
+            mapped = o.mapped;
+            v = o.v;
+            o.mapped = 0;
+            o.v = Sections{};
+        }
+        return *this;
+    }
+
+    CANDecodeTable(const CANDecodeTable &) = delete;
+    CANDecodeTable &operator=(const CANDecodeTable &) = delete;
+
+    ~CANDecodeTable() { release(); }
+
+    // Use a validated image living in an mmap'ed region of `size` bytes.
+    // On success the table owns the mapping and unmaps it when destroyed;
+    // on failure nothing changes and the caller keeps the mapping.
+    bool adoptMapping(const void *image, size_t size) {
+        if (!validImage(static_cast<const uint8_t *>(image), size)) return false;
+        release();
+        owned.clear();
+        attach(static_cast<const uint8_t *>(image));
+        mapped = size;
+        return true;
+    }
+
+    // Definition for a received frame's can_id, or nullptr
+    const CANMessageDesc *find(canid_t can_id) const {
+        if (can_id & CAN_EFF_FLAG) {
+            int i = v.eff.find(can_id & CAN_EFF_MASK);
+            return i < 0 ? nullptr : &v.msgs[i];
+        }
+        uint16_t i = v.sff[can_id & CAN_SFF_MASK];
+        return i == NONE ? nullptr : &v.msgs[i];
+    }
+
+    const CANSignalDesc *signals(const CANMessageDesc &m) const {
+        return &v.sigs[m.first_signal];
+    }
+
+    // Messages in ID order, and a message's position in that order
+    const CANMessageDesc &message(size_t i) const { return v.msgs[i]; }
+    size_t messageIndex(const CANMessageDesc &m) const { return &m - v.msgs; }
+
+    const CANSignalDesc &signal(int handle) const { return v.sigs[handle]; }
+    const CANSignalRange &range(int handle) const { return v.ranges[handle]; }
+
+    // Physical value of a signal in an 8-byte payload
+    static float decode(const CANSignalDesc &s, const uint8_t *data) {
+        return s.plan.value(data) * s.scale + s.offset;
+    }
+
+    // Handle of a signal for decodeInto(), or -1 if there is none. Resolve
+    // handles once at startup; message picks between same-named signals.
+    int signalHandle(std::string_view signal, std::string_view message = {}) const {
+        for (uint32_t m = 0; m < v.header->msg_count; m++) {
+            const CANMessageDesc &msg = v.msgs[m];
+            if (!message.empty() && message != str(msg.name)) continue;
+            for (int i = 0; i < msg.signal_count; i++)
+                if (signal == str(v.sigs[msg.first_signal + i].name))
+                    return msg.first_signal + i;
+        }
+        return -1;
+    }
+
+    static bool hasSignal(const CANMessageDesc &m, int handle) {
+        return unsigned(handle - m.first_signal) < m.signal_count;
+    }
+
+    // Call f(handle, value) for every signal present in frame: all of them
+    // for plain messages, the unconditional ones plus the selected pages for
+    // multiplexed ones. Returns the message, or nullptr for an unknown ID.
+    template <typename F>
+    const CANMessageDesc *decodeEach(const can_frame &frame, F &&f) const {
+        const CANMessageDesc *m = find(frame.can_id);
+        if (m) decodeEach(*m, frame.data, f);
+        return m;
+    }
+
+    // Same, for a payload already matched to its message (e.g. by PGN)
+    template <typename F>
+    void decodeEach(const CANMessageDesc &m, const uint8_t *data, F &&f) const {
+        if (!m.multiplexed) {
+            const CANSignalDesc *sigs = signals(m);
+            for (int i = 0; i < m.signal_count; i++)
+                f(m.first_signal + i, decode(sigs[i], data));
+            return;
+        }
+
+        const CANMuxSwitch &root = v.switches[m.mux_root];
+        uint64_t sel = v.sigs[root.signal].plan.extract(data);
+        CANMuxPage list{m.base_first, m.base_count};
+        if (sel < root.page_count) list = v.pages[root.first_page + sel];
+        if (m.multiplexed == 1) {
+            for (uint32_t i = list.first; i < list.first + list.count; i++) {
+                uint16_t h = v.pageSignals[i];
+                f(int(h), decode(v.sigs[h], data));
+            }
+            return;
+        }
+
+        // Nested multiplexors found on the way select further pages; the
+        // visit bound stops cyclic definitions
+        uint16_t pending[8];
+        int depth = 0;
+        for (int visits = 0; visits < 64; visits++) {
+            for (uint32_t i = list.first; i < list.first + list.count; i++) {
+                uint16_t h = v.pageSignals[i];
+                f(int(h), decode(v.sigs[h], data));
+                uint16_t sw = v.switchOf[h];
+                if (sw != NONE && sw != m.mux_root && depth < 8) pending[depth++] = sw;
+            }
+            if (!depth) break;
+            const CANMuxSwitch &next = v.switches[pending[--depth]];
+            sel = v.sigs[next.signal].plan.extract(data);
+            list = sel < next.page_count ? v.pages[next.first_page + sel] : CANMuxPage{0, 0};
+        }
+    }
+
+    // Decode the signals present in frame into values[handle]; values holds
+    // signalCount() floats owned by the caller and absent signals keep their
+    // previous value. Returns the message, or nullptr for an unknown ID.
+    const CANMessageDesc *decodeInto(const can_frame &frame, float *values) const {
+        return decodeEach(frame, [values](int h, float value) { values[h] = value; });
+    }
+
+    const char *str(uint32_t offset) const { return v.strings + offset; }
+    size_t messageCount() const { return v.header->msg_count; }
+    size_t signalCount() const { return v.header->sig_count; }
+
+    // The raw image, e.g. for writing to a cache file
+    const CANTableHeader &header() const { return *v.header; }
+    const void *image() const { return v.header; }
+
+private:
+    struct alignas(64) Block { uint8_t bytes[64]; };
+
+    // Multiplexing sections while building
+    struct Mux {
+        std::vector<uint16_t> switchOf;
+        std::vector<CANMuxSwitch> switches;
+        std::vector<CANMuxPage> pages;
+        std::vector<uint16_t> pageSignals;
+    };
+
+    // Highest value of multiplexor sw that selects a signal. Range ends
+    // beyond what the selector's bits can hold are unreachable and ignored.
+    static uint32_t muxTop(const CANMessageDef &def, const DBCMuxInfo &info, int sw) {
+        int length = def.signals[sw].length;
+        uint32_t reachable = length >= 32 ? 0xFFFFFFFF : (1u << std::max(length, 0)) - 1;
+        uint32_t top = 0;
+        for (size_t i = 0; i < info.switchOf.size(); i++)
+            if (info.switchOf[i] == sw)
+                for (auto &r : info.when[i]) top = std::max(top, std::min(r.second, reachable));
+        return top;
+    }
+
+    // Lay out the unconditional list and one direct-indexed page table
+    // per multiplexor. Plain messages are left alone.
+    static void buildMux(const CANMessageDef &def, CANMessageDesc &m, Mux &mux) {
+        DBCMuxInfo info = resolveMux(def);
+        if (!info.multiplexed) return;
+        int n = def.signals.size();
+
+        // Top multiplexor: the first switch that is itself always present
+        std::vector<int> order;
+        for (int i = 0; i < n; i++)
+            if (std::find(info.switchOf.begin(), info.switchOf.end(), i) != info.switchOf.end())
+                order.push_back(i);
+        std::stable_partition(order.begin(), order.end(),
+                              [&](int sw) { return info.switchOf[sw] < 0; });
+        if (info.switchOf[order[0]] >= 0) return;   // only cyclic switches
+
+        std::vector<uint16_t> base;
+        for (int i = 0; i < n; i++)
+            if (info.switchOf[i] < 0) base.push_back(m.first_signal + i);
+        m.multiplexed = order.size() == 1 ? 1 : 2;
+        m.mux_root = mux.switches.size();
+        m.base_first = mux.pageSignals.size();
+        m.base_count = base.size();
+        mux.pageSignals.insert(mux.pageSignals.end(), base.begin(), base.end());
+
+        for (int sw : order) {
+            bool isRoot = sw == order[0];
+            uint32_t top = muxTop(def, info, sw);
+
+            CANMuxSwitch entry{};
+            entry.signal = m.first_signal + sw;
+            entry.page_count = top + 1;
+            entry.first_page = mux.pages.size();
+            for (uint32_t value = 0; value <= top; value++) {
+                CANMuxPage page{uint32_t(mux.pageSignals.size()), 0};
+                for (int i = 0; i < n; i++) {
+                    bool present = isRoot && info.switchOf[i] < 0;
+                    if (info.switchOf[i] == sw)
+                        for (auto &r : info.when[i])
+                            present = present || (value >= r.first && value <= r.second);
+                    if (present) mux.pageSignals.push_back(m.first_signal + i);
+                }
+                page.count = mux.pageSignals.size() - page.first;
+                mux.pages.push_back(page);
+            }
+            mux.switchOf[m.first_signal + sw] = mux.switches.size();
+            mux.switches.push_back(entry);
+        }
+    }
+
+    struct Sections {
+        const CANTableHeader *header = nullptr;
+        const uint16_t *sff = nullptr;
+        CANIdHash::View eff;
+        const CANMessageDesc *msgs = nullptr;
+        const CANSignalDesc *sigs = nullptr;
+        const CANSignalRange *ranges = nullptr;
+        const uint16_t *switchOf = nullptr;
+        const CANMuxSwitch *switches = nullptr;
+        const CANMuxPage *pages = nullptr;
+        const uint16_t *pageSignals = nullptr;
+        const char *strings = nullptr;
+    };
+
+    void attach(const uint8_t *img) {
+        const CANTableHeader &h = *reinterpret_cast<const CANTableHeader *>(img);
+        v.header = &h;
+        v.sff = reinterpret_cast<const uint16_t *>(img + h.sff_offset);
+        v.eff.seeds = reinterpret_cast<const uint32_t *>(img + h.seeds_offset);
+        v.eff.keys = reinterpret_cast<const uint32_t *>(img + h.keys_offset);
+        v.eff.values = reinterpret_cast<const uint32_t *>(img + h.values_offset);
+        v.eff.seedCount = h.seed_count;
+        v.eff.slotCount = h.slot_count;
+        v.msgs = reinterpret_cast<const CANMessageDesc *>(img + h.msgs_offset);
+        v.sigs = reinterpret_cast<const CANSignalDesc *>(img + h.sigs_offset);
+        v.ranges = reinterpret_cast<const CANSignalRange *>(img + h.ranges_offset);
+        v.switchOf = reinterpret_cast<const uint16_t *>(img + h.switch_of_offset);
+        v.switches = reinterpret_cast<const CANMuxSwitch *>(img + h.switches_offset);
+        v.pages = reinterpret_cast<const CANMuxPage *>(img + h.pages_offset);
+        v.pageSignals = reinterpret_cast<const uint16_t *>(img + h.page_signals_offset);
+        v.strings = reinterpret_cast<const char *>(img + h.strings_offset);
+    }
+
+    void release() {
+        if (mapped) munmap(const_cast<CANTableHeader *>(v.header), mapped);
+        mapped = 0;
+    }
+
+    // Structural checks, so a truncated or foreign file is rejected
+    // instead of being indexed out of bounds
+    static bool validImage(const uint8_t *img, size_t size) {
+        if (size < sizeof(CANTableHeader) || uintptr_t(img) % 32) return false;
+        const CANTableHeader &h = *reinterpret_cast<const CANTableHeader *>(img);
+        if (memcmp(h.magic, CANTableHeader::MAGIC, sizeof(h.magic)) ||
+            h.version != CANTableHeader::VERSION || h.header_size != sizeof(h) ||
+            h.image_size > size)
+            return false;
+
+        auto fits = [&](uint32_t offset, uint64_t bytes) {
+            return offset % 32 == 0 && offset + bytes <= h.image_size;
+        };
+        if (!fits(h.sff_offset, 2048 * 2) || !fits(h.seeds_offset, h.seed_count * 4ull) ||
+            !fits(h.keys_offset, h.slot_count * 4ull) || !fits(h.values_offset, h.slot_count * 4ull) ||
+            !fits(h.msgs_offset, h.msg_count * uint64_t(sizeof(CANMessageDesc))) ||
+            !fits(h.sigs_offset, h.sig_count * uint64_t(sizeof(CANSignalDesc))) ||
+            !fits(h.ranges_offset, h.sig_count * uint64_t(sizeof(CANSignalRange))) ||
+            !fits(h.switch_of_offset, h.sig_count * 2ull) ||
+            !fits(h.switches_offset, h.switch_count * uint64_t(sizeof(CANMuxSwitch))) ||
+            !fits(h.pages_offset, h.page_count * uint64_t(sizeof(CANMuxPage))) ||
+            !fits(h.page_signals_offset, h.page_signal_count * 2ull) ||
+            !fits(h.strings_offset, h.string_bytes))
+            return false;
+        if (h.slot_count & (h.slot_count - 1)) return false;
+        if (h.string_bytes && img[h.strings_offset + h.string_bytes - 1] != '\0') return false;
+
+        auto sff = reinterpret_cast<const uint16_t *>(img + h.sff_offset);
+        for (int i = 0; i < 2048; i++)
+            if (sff[i] != NONE && sff[i] >= h.msg_count) return false;
+        auto values = reinterpret_cast<const uint32_t *>(img + h.values_offset);
+        for (uint32_t i = 0; i < h.slot_count; i++)
+            if (values[i] >= std::max(h.msg_count, 1u)) return false;
+        auto msgs = reinterpret_cast<const CANMessageDesc *>(img + h.msgs_offset);
+        for (uint32_t i = 0; i < h.msg_count; i++)
+            if (msgs[i].first_signal + msgs[i].signal_count > h.sig_count ||
+                msgs[i].name >= h.string_bytes ||
+                (msgs[i].multiplexed && (msgs[i].mux_root >= h.switch_count ||
+                 uint64_t(msgs[i].base_first) + msgs[i].base_count > h.page_signal_count)))
+                return false;
+        auto switchOf = reinterpret_cast<const uint16_t *>(img + h.switch_of_offset);
+        for (uint32_t i = 0; i < h.sig_count; i++)
+            if (switchOf[i] != NONE && switchOf[i] >= h.switch_count) return false;
+        auto switches = reinterpret_cast<const CANMuxSwitch *>(img + h.switches_offset);
+        for (uint32_t i = 0; i < h.switch_count; i++)
+            if (switches[i].signal >= h.sig_count ||
+                uint64_t(switches[i].first_page) + switches[i].page_count > h.page_count)
+                return false;
+        auto pages = reinterpret_cast<const CANMuxPage *>(img + h.pages_offset);
+        for (uint32_t i = 0; i < h.page_count; i++)
+            if (uint64_t(pages[i].first) + pages[i].count > h.page_signal_count) return false;
+        auto pageSignals = reinterpret_cast<const uint16_t *>(img + h.page_signals_offset);
+        for (uint32_t i = 0; i < h.page_signal_count; i++)
+            if (pageSignals[i] >= h.sig_count) return false;
+        auto sigs = reinterpret_cast<const CANSignalDesc *>(img + h.sigs_offset);
+        for (uint32_t i = 0; i < h.sig_count; i++)
+            if (sigs[i].name >= h.string_bytes || sigs[i].unit >= h.string_bytes)
+                return false;
+        return true;
+    }
+
+    std::vector<Block> owned;   // image storage when built in memory
+    size_t mapped = 0;          // image size when it is an mmap'ed file
+    Sections v;
+};
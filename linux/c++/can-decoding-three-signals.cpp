@@ -11,6 +11,7 @@
 #include <sys/socket.h>
 #include <linux/can.h>
 #include <linux/can/raw.h>
+#include "can-rx.h"
 
 using namespace std;
 
@@ -104,7 +105,6 @@ void receiverThread(const char *ifname) {
     int s;
     struct sockaddr_can addr;
     struct ifreq ifr;
-    struct can_frame frame;
 
     if ((s = socket(PF_CAN, SOCK_RAW, CAN_RAW)) < 0) {
         perror("Socket");
@@ -125,17 +125,21 @@ void receiverThread(const char *ifname) {
 
     cout << "Listening on vcan0...\n";
 
+    CANReceiver rx(s);
     while (true) {
-        int nbytes = read(s, &frame, sizeof(frame));
-        if (nbytes < 0) {
+        int n = rx.receive();
+        if (n < 0) {
             perror("Read");
             break;
-        } else if (nbytes < sizeof(struct can_frame)) {
-            cerr << "Incomplete CAN frame\n";
-            continue;
         }
 
-        decodeSignals(frame);
+        for (int k = 0; k < n; k++) {
+            if (rx.length(k) < sizeof(struct can_frame)) {
+                cerr << "Incomplete CAN frame\n";
+                continue;
+            }
+            decodeSignals(rx.frame(k));
+        }
     }
 
     close(s);
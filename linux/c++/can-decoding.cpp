@@ -11,6 +11,7 @@
 #include <sys/socket.h>
 #include <linux/can.h>
 #include <linux/can/raw.h>
+#include "can-rx.h"
 
 using namespace std;
 
@@ -91,27 +92,30 @@ void receiverThread(const char *ifname) {
         return;
     }
 
-    can_frame frame;
+    CANReceiver rx(s);
     cout << "[Receiver] Listening on " << ifname << " ..." << endl;
 
     while (true) {
-        int nbytes = read(s, &frame, sizeof(frame));
-        if (nbytes < 0) {
+        int n = rx.receive();
+        if (n < 0) {
             perror("Read");
             break;
         }
 
-        if (frame.can_id == ENGINE_TEMP_ID && frame.can_dlc == 2) {
-            uint16_t temp_raw = (frame.data[1] << 8) | frame.data[0];
-            float temperature = temp_raw / 10.0; // convert back
+        for (int k = 0; k < n; k++) {
+            const can_frame &frame = rx.frame(k);
+            if (frame.can_id == ENGINE_TEMP_ID && frame.can_dlc == 2) {
+                uint16_t temp_raw = (frame.data[1] << 8) | frame.data[0];
+                float temperature = temp_raw / 10.0; // convert back
 
 
-            auto now = chrono::system_clock::now();
-            time_t t = chrono::system_clock::to_time_t(now);
-            tm tm = *localtime(&t);
-            cout << "[" << put_time(&tm, "%H:%M:%S") << "] "
-                 << "Received Temp: " << fixed << setprecision(1)
-                 << temperature << " °C" << endl;
+                auto now = toSystemTime(rx.timestampNs(k));
+                time_t t = chrono::system_clock::to_time_t(now);
+                tm tm = *localtime(&t);
+                cout << "[" << put_time(&tm, "%H:%M:%S") << "] "
+                     << "Received Temp: " << fixed << setprecision(1)
+                     << temperature << " °C" << endl;
+            }
         }
     }
 
@@ -13,9 +13,15 @@
 #include <linux/can/raw.h>
 #include <unistd.h>
 #include <cstring>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include "can-rx.h"
+#include "can-isotp.h"
 
 using namespace std;
 
+// ECU reports on ECU_ID; the dashboard's ISO-TP flow control goes on DASHBOARD_ID
 const unsigned int ECU_ID       = 0x7E0; 
 const unsigned int DASHBOARD_ID = 0x7E8; 
 
@@ -71,33 +77,50 @@ string generateDTC(float temp) {
     return "";
 }
 
+// Feed every frame queued on the non-blocking socket to the ISO-TP engine
+void pumpISOTP(int bus, ISOTPEngine &tp) {
+    can_frame frame{};
+    while(read(bus, &frame, sizeof(frame)) == sizeof(frame))
+        tp.receive(frame, monotonicNowNs());
+    tp.poll(monotonicNowNs());
+}
+
 // ECU node
+// Report: temperature (2 bytes), the current DTC (5 characters, zeros if
+// none), then every DTC stored so far. Sent over ISO-TP, so the report
+// spans as many frames as the stored DTCs need.
 void ecuNode(const char* ifname) {
     int bus = setupCAN(ifname);
     srand(time(0));
 
-    while(true) {
-        float temp = simulateTemperature();
-        string dtc = generateDTC(temp);
-
-        can_frame frame{};
-        frame.can_id = ECU_ID;
-        frame.can_dlc = 8;
-
-        // Pack temperature (2 bytes) 
-        uint16_t tempInt = static_cast<uint16_t>(temp * 10);
-        frame.data[0] = tempInt >> 8;
-        frame.data[1] = tempInt & 0xFF;
-
-        // Pack full DTC string (up to 6 bytes remaining)
-        memset(frame.data + 2, 0, 6); // clear
-        for(size_t i = 0; i < dtc.size() && i < 6; ++i)
-            frame.data[2+i] = dtc[i];
-
+    ISOTPEngine tp(1, [bus](const can_frame &frame) {
         if(write(bus, &frame, sizeof(frame)) != sizeof(frame))
             perror("ECU write");
+    });
+    tp.open(ECU_ID, DASHBOARD_ID);
+
+    vector<string> stored;
+    auto nextReport = chrono::steady_clock::now();
 
-        this_thread::sleep_for(chrono::milliseconds(500));
+    while(true) {
+        if(chrono::steady_clock::now() >= nextReport && !tp.sending(0)) {
+            nextReport += chrono::milliseconds(500);
+            float temp = simulateTemperature();
+            string dtc = generateDTC(temp);
+            if(!dtc.empty() && find(stored.begin(), stored.end(), dtc) == stored.end())
+                stored.push_back(dtc);
+
+            uint16_t tempInt = static_cast<uint16_t>(temp * 10);
+            vector<uint8_t> report = {uint8_t(tempInt >> 8), uint8_t(tempInt & 0xFF)};
+            dtc.resize(5, '\0');
+            report.insert(report.end(), dtc.begin(), dtc.end());
+            for(auto &code : stored)
+                report.insert(report.end(), code.begin(), code.end());
+            tp.send(0, report.data(), report.size(), monotonicNowNs());
+        }
+
+        pumpISOTP(bus, tp);
+        this_thread::sleep_for(chrono::milliseconds(10));
     }
 
     close(bus);
@@ -107,26 +130,35 @@ void ecuNode(const char* ifname) {
 void dashboardNode(const char* ifname) {
     int bus = setupCAN(ifname);
     ofstream csv("uds_dtc_log.csv");
-    csv << "Timestamp,Temperature,DTC\n";
+    csv << "Timestamp,Temperature,DTC,StoredDTCs\n";
+
+    ISOTPEngine tp(1, [bus](const can_frame &frame) {
+        if(write(bus, &frame, sizeof(frame)) != sizeof(frame))
+            perror("Dashboard write");
+    });
+    tp.open(DASHBOARD_ID, ECU_ID);
+    tp.onMessage = [&](int, const uint8_t *data, size_t len) {
+        if(len < 7) return;
+        uint16_t tempInt = (data[0] << 8) | data[1];
+        float temp = tempInt / 10.0f;
+
+        string dtc(reinterpret_cast<const char *>(data + 2), strnlen(reinterpret_cast<const char *>(data + 2), 5));
+        string stored;
+        for(size_t i = 7; i + 5 <= len; i += 5)
+            stored += (stored.empty() ? "" : ";") + string(reinterpret_cast<const char *>(data + i), 5);
+
+        string ts = getTimestamp();
+        cout << "[" << ts << "] Temp=" << fixed << setprecision(1) << temp 
+             << "°C DTC=" << (dtc.empty()?"None":dtc)
+             << " Stored=" << (stored.empty()?"None":stored) << endl;
+
+        csv << ts << "," << temp << "," << (dtc.empty()?"None":dtc) << ","
+            << (stored.empty()?"None":stored) << "\n";
+        csv.flush();
+    };
 
     while(true) {
-        can_frame frame{};
-        int nbytes = read(bus, &frame, sizeof(frame));
-        if(nbytes > 0 && frame.can_id == ECU_ID) {
-            uint16_t tempInt = (frame.data[0] << 8) | frame.data[1];
-            float temp = tempInt / 10.0f;
-
-            string dtc = "";
-            for(int i=2;i<8;i++)
-                if(frame.data[i] != 0) dtc += frame.data[i];
-
-            string ts = getTimestamp();
-            cout << "[" << ts << "] Temp=" << fixed << setprecision(1) << temp 
-                 << "°C DTC=" << (dtc.empty()?"None":dtc) << endl;
-
-            csv << ts << "," << temp << "," << (dtc.empty()?"None":dtc) << "\n";
-            csv.flush();
-        }
+        pumpISOTP(bus, tp);
         this_thread::sleep_for(chrono::milliseconds(10));
     }
 
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cerrno>
+#include <vector>
+#include <sys/socket.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+
+// ID acceptance compiled into kernel CAN_RAW_FILTER lists, so rejected
+// frames are dropped in the kernel instead of being copied to userspace.
+//
+// Accept filters are OR'ed. Reject filters are inverted filters and are
+// AND'ed with CAN_RAW_JOIN_FILTERS, which allows "everything except ..."
+// and "this range except ...", but not several accepts plus rejects.
+struct CANFilterSet {
+    std::vector<can_filter> filters;
+    bool join = false;
+
+    // Exact 11-bit or 29-bit ID
+    CANFilterSet &accept(canid_t id, bool extended = false) {
+        return acceptMask(id, extended ? CAN_EFF_MASK : CAN_SFF_MASK, extended);
+    }
+
+    // All IDs where (id & mask) matches; the EFF flag is always compared
+    // so standard and extended frames never alias each other
+    CANFilterSet &acceptMask(canid_t id, canid_t mask, bool extended = false) {
+        filters.push_back(make(id, mask, extended));
+        return *this;
+    }
+
+    // Drop an exact ID or masked range
+    CANFilterSet &reject(canid_t id, bool extended = false) {
+        return rejectMask(id, extended ? CAN_EFF_MASK : CAN_SFF_MASK, extended);
+    }
+
+    CANFilterSet &rejectMask(canid_t id, canid_t mask, bool extended = false) {
+        can_filter f = make(id, mask, extended);
+        f.can_id |= CAN_INV_FILTER;
+        filters.push_back(f);
+        join = true;
+        return *this;
+    }
+
+    // Exactly the frames this set drops (De Morgan: invert each filter and
+    // swap OR/AND). Used for audit sockets that log rejected traffic.
+    CANFilterSet complement() const {
+        CANFilterSet c;
+        if (filters.empty()) {
+            c.filters.push_back({0, 0}); // nothing accepted, so audit everything
+            return c;
+        }
+        for (auto f : filters) {
+            f.can_id ^= CAN_INV_FILTER;
+            c.filters.push_back(f);
+        }
+        c.join = !join;
+        return c;
+    }
+
+    bool valid() const {
+        if (!join) return true;
+        int accepts = 0;
+        for (auto &f : filters)
+            if (!(f.can_id & CAN_INV_FILTER)) accepts++;
+        return accepts <= 1;
+    }
+
+    // Install on a CAN_RAW socket. An empty set receives nothing.
+    bool apply(int s) const {
+        if (!valid()) { errno = EINVAL; return false; }
+
+        int joinOpt = join && filters.size() > 1;
+        if (joinOpt && setsockopt(s, SOL_CAN_RAW, CAN_RAW_JOIN_FILTERS,
+                                  &joinOpt, sizeof(joinOpt)) < 0)
+            return false;
+        return setsockopt(s, SOL_CAN_RAW, CAN_RAW_FILTER, filters.data(),
+                          filters.size() * sizeof(can_filter)) == 0;
+    }
+
+private:
+    static can_filter make(canid_t id, canid_t mask, bool extended) {
+        can_filter f;
+        f.can_id = (id & mask) | (extended ? CAN_EFF_FLAG : 0);
+        f.can_mask = mask | CAN_EFF_FLAG;
+        return f;
+    }
+};
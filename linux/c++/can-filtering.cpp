@@ -2,7 +2,7 @@
 #include <thread>
 #include <chrono>
 #include <fstream>
-#include <set>
+#include <mutex>
 #include <iomanip>
 #include <cstdlib>
 #include <ctime>
@@ -13,12 +13,15 @@
 #include <linux/can/raw.h>
 #include <unistd.h>
 #include <cstring>
+#include "can-rx.h"
+#include "can-filter.h"
 using namespace std;
 
-// Accepted CAN IDs
-set<unsigned int> acceptedIDs = {0x100};
+// Accepted CAN IDs, enforced by the kernel via CAN_RAW_FILTER
+CANFilterSet acceptedIDs = CANFilterSet().accept(0x100);
 
 ofstream logFile;
+mutex logMutex;
 
 // Setup CAN socket
 int setupCAN(const char *ifname) {
@@ -40,27 +43,43 @@ int setupCAN(const char *ifname) {
     return s;
 }
 
-// Receiver node with filter
+// Log a frame to CSV as processed or dropped
+void logFrame(unsigned int id, bool accepted, const can_frame &frame) {
+    lock_guard<mutex> lock(logMutex);
+    logFile << hex << uppercase << id << "," 
+            << (accepted ? "Processed" : "Dropped") << ","
+            << dec << (int)frame.can_dlc << ",";
+    for(int i=0;i<frame.can_dlc;i++){
+        logFile << hex << setw(2) << setfill('0') << (int)frame.data[i];
+        if(i<frame.can_dlc-1) logFile << " ";
+    }
+    logFile << endl;
+}
+
+unsigned int frameID(const can_frame &frame) {
+    bool isExtended = frame.can_id & CAN_EFF_FLAG;
+    return isExtended ? (frame.can_id & CAN_EFF_MASK)
+                      : (frame.can_id & CAN_SFF_MASK);
+}
+
+// Receiver node: rejected IDs never leave the kernel
 void receiverThread(const char *ifname) {
     int s = setupCAN(ifname);
-    can_frame frame{};
+    if(!acceptedIDs.apply(s)) { perror("CAN_RAW_FILTER"); exit(1); }
+    CANReceiver rx(s);
     cout << "[Receiver] Listening on " << ifname << "...\n";
 
     while(true) {
-        int nbytes = read(s, &frame, sizeof(frame));
-        if(nbytes < 0) {
+        int n = rx.receive();
+        if(n < 0) {
             perror("Read");
             break;
         }
 
-        bool isExtended = frame.can_id & CAN_EFF_FLAG;
-        unsigned int id = isExtended ? (frame.can_id & CAN_EFF_MASK)
-                                     : (frame.can_id & CAN_SFF_MASK);
-
-        bool accepted = acceptedIDs.find(id) != acceptedIDs.end();
+        for (int k = 0; k < n; k++) {
+            const can_frame &frame = rx.frame(k);
+            unsigned int id = frameID(frame);
 
-        // Only print accepted messages in console
-        if(accepted) {
             cout << "[Receiver] Received CAN ID=0x" << hex << uppercase << id
                  << " DLC=" << dec << (int)frame.can_dlc << " Data=[";
             for(int i=0;i<frame.can_dlc;i++){
@@ -68,18 +87,30 @@ void receiverThread(const char *ifname) {
                 if(i<frame.can_dlc-1) cout << " ";
             }
             cout << "]" << endl;
+
+            logFrame(id, true, frame);
         }
+    }
 
-        // Log all messages to CSV (processed vs dropped)
-        logFile << hex << uppercase << id << "," 
-                << (accepted ? "Processed" : "Dropped") << ","
-                << dec << (int)frame.can_dlc << ",";
-        for(int i=0;i<frame.can_dlc;i++){
-            logFile << hex << setw(2) << setfill('0') << (int)frame.data[i];
-            if(i<frame.can_dlc-1) logFile << " ";
+    close(s);
+}
+
+// Optional audit node: a second socket with the complementary kernel
+// filter sees exactly the frames the receiver drops
+void dropAuditThread(const char *ifname) {
+    int s = setupCAN(ifname);
+    if(!acceptedIDs.complement().apply(s)) { perror("CAN_RAW_FILTER"); exit(1); }
+    CANReceiver rx(s);
+
+    while(true) {
+        int n = rx.receive();
+        if(n < 0) {
+            perror("Read");
+            break;
         }
-        logFile << endl;
-        logFile.flush();
+
+        for (int k = 0; k < n; k++)
+            logFrame(frameID(rx.frame(k)), false, rx.frame(k));
     }
 
     close(s);
@@ -107,16 +138,20 @@ void senderThread(const char *ifname, unsigned int can_id) {
 
 int main() {
     const char *ifname = "vcan0";
+    bool auditDropped = true; // log Dropped rows via the audit socket
     logFile.open("filtered_can_log.csv");
     logFile << "CAN_ID,Status,DLC,Data\n";
 
     thread sender1(senderThread, ifname, 0x100); // Accepted
     thread sender2(senderThread, ifname, 0x300); // Dropped
     thread receiver(receiverThread, ifname);
+    thread audit;
+    if(auditDropped) audit = thread(dropAuditThread, ifname);
 
     sender1.join();
     sender2.join();
     receiver.join();
+    if(audit.joinable()) audit.join();
 
     logFile.close();
     return 0;
@@ -0,0 +1,197 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "can-capture.h"
+
+using namespace std;
+
+// Per-frame cost of formatting log rows three ways: iostreams with
+// localtime/put_time and setw/setfill/hex per byte (the loggers' original
+// code), sprintf per field, and can-format.h (per-second time prefix,
+// to_chars, hex table, reused buffer). All three must produce the same
+// text. Reports ns and heap allocations per frame.
+//
+// Usage: can-format-bench [frames]
+
+static uint64_t allocations = 0;
+
+void *operator new(size_t n) {
+    allocations++;
+    if (void *p = malloc(n ? n : 1)) return p;
+    throw bad_alloc();
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+struct Row {
+    int64_t wall_ns;
+    CANCaptureRecord rec;
+    int rpm, temp, gear, ws;
+};
+
+// can_log.csv: Timestamp,CAN_ID,Type,DLC,Data
+
+string canLogStreams(const Row &r) {
+    time_t t = r.wall_ns / 1000000000;
+    tm local{};
+    localtime_r(&t, &local);
+    ostringstream ss;
+    ss << put_time(&local, "%Y-%m-%d %H:%M:%S") << "." << setw(3) << setfill('0')
+       << (r.wall_ns % 1000000000) / 1000000 << ",0x" << hex << uppercase << r.rec.id << dec
+       << (r.rec.flags & CAN_CAPTURE_EXTENDED ? ",Extended," : ",Standard,") << int(r.rec.dlc) << ",";
+    for (int i = 0; i < r.rec.dlc; i++) {
+        ss << hex << uppercase << setw(2) << setfill('0') << int(r.rec.data[i]);
+        if (i < r.rec.dlc - 1) ss << " ";
+    }
+    ss << "\n";
+    return ss.str();
+}
+
+size_t canLogPrintf(const Row &r, char *out) {
+    size_t len = formatWallTime(r.wall_ns, out);
+    bool isExtended = r.rec.flags & CAN_CAPTURE_EXTENDED;
+    len += sprintf(out + len, ",0x%X,%s,%d,", r.rec.id, isExtended ? "Extended" : "Standard", r.rec.dlc);
+    for (int i = 0; i < r.rec.dlc; i++)
+        len += sprintf(out + len, i ? " %02X" : "%02X", r.rec.data[i]);
+    out[len++] = '\n';
+    return len;
+}
+
+// vehicle_decoded_log.csv: time_local,ts_mono,bus,can_id,dlc,data_hex,node_inferred,decoded_values
+
+string decodedStreams(const Row &r, int64_t start) {
+    time_t t = r.wall_ns / 1000000000;
+    tm local{};
+    localtime_r(&t, &local);
+    stringstream time;
+    time << put_time(&local, "%Y-%m-%d %H:%M:%S") << "." << setw(6) << setfill('0')
+         << (r.wall_ns % 1000000000) / 1000;
+    stringstream data;
+    data << hex << setfill('0');
+    for (int i = 0; i < r.rec.dlc; ++i) data << setw(2) << int(r.rec.data[i]);
+    ostringstream ss;
+    ss << time.str() << "," << fixed << setprecision(6) << (r.wall_ns - start) / 1e9 << ",vcan0,"
+       << "0x" << hex << uppercase << r.rec.id << nouppercase << dec << "," << int(r.rec.dlc) << "," << data.str()
+       << "," << string("Engine") << ",RPM=" << r.rpm << ",Temp=" << r.temp << "C,Gear=" << r.gear << ",WS=" << r.ws
+       << ",DTC=" << string("None") << ",Desc=" << string("No Active DTC") << "\n";
+    return ss.str();
+}
+
+size_t decodedPrintf(const Row &r, int64_t start, char *out) {
+    size_t len = formatWallTime(r.wall_ns, out, 6);
+    len += sprintf(out + len, ",%.6f,%s,0x%X,%d,", (r.wall_ns - start) / 1e9, "vcan0", r.rec.id, r.rec.dlc);
+    for (int i = 0; i < r.rec.dlc; ++i)
+        len += sprintf(out + len, "%02x", r.rec.data[i]);
+    len += sprintf(out + len, ",%s,RPM=%d,Temp=%dC,Gear=%d,WS=%d,DTC=%s,Desc=%s\n", "Engine", r.rpm, r.temp,
+                   r.gear, r.ws, "None", "No Active DTC");
+    return len;
+}
+
+size_t decodedTable(const Row &r, int64_t start, char *out) {
+    char *p = out + formatWallTime(r.wall_ns, out, 6);
+    *p++ = ',';
+    p += formatFixed((r.wall_ns - start) / 1e9, 6, p);
+    p += formatText(",vcan0,0x", p);
+    p += formatHex(r.rec.id, p);
+    *p++ = ',';
+    p += formatDec(int(r.rec.dlc), p);
+    *p++ = ',';
+    p += formatBytes(r.rec.data, r.rec.dlc, p, '\0', false);
+    p += formatText(",Engine,RPM=", p);
+    p += formatDec(r.rpm, p);
+    p += formatText(",Temp=", p);
+    p += formatDec(r.temp, p);
+    p += formatText("C,Gear=", p);
+    p += formatDec(r.gear, p);
+    p += formatText(",WS=", p);
+    p += formatDec(r.ws, p);
+    p += formatText(",DTC=None,Desc=No Active DTC\n", p);
+    return p - out;
+}
+
+struct Result {
+    string text;
+    double ns = 0;
+    double allocs = 0;
+};
+
+// Format every row into one output buffer, as a log writer's batch would
+template <typename F>
+Result run(const vector<Row> &rows, F &&format) {
+    Result res;
+    res.text.reserve(rows.size() * 160);
+    uint64_t a0 = allocations;
+    auto t0 = chrono::steady_clock::now();
+    for (const Row &r : rows) format(r, res.text);
+    res.ns = chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count() / rows.size();
+    res.allocs = double(allocations - a0) / rows.size();
+    return res;
+}
+
+void report(const char *layout, const vector<Result> &results, bool &failed) {
+    const char *names[] = {"streams", "sprintf", "can-format"};
+    cout << layout << "\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        bool same = results[i].text == results[0].text;
+        failed |= !same;
+        cout << fixed << setprecision(1) << "  " << setw(10) << names[i] << " : " << setw(6) << results[i].ns
+             << " ns/frame, " << setprecision(2) << results[i].allocs << " allocs/frame"
+             << (same ? "" : "  OUTPUT DIFFERS") << "\n";
+    }
+}
+
+int main(int argc, char **argv) {
+    size_t frames = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000000;
+    mt19937_64 rng(7);
+    vector<Row> rows(frames);
+    int64_t start = (int64_t(time(nullptr)) - 3600) * 1000000000, ts = start;
+    for (Row &r : rows) {
+        ts += 100000 + rng() % 400000;
+        r.wall_ns = ts;
+        bool extended = rng() % 4 == 0;
+        r.rec = CANCaptureRecord{};
+        r.rec.ts_ns = ts;
+        r.rec.id = extended ? rng() & CAN_EFF_MASK : rng() & CAN_SFF_MASK;
+        r.rec.flags = extended ? CAN_CAPTURE_EXTENDED : 0;
+        r.rec.dlc = rng() % 9;
+        uint64_t payload = rng();
+        memcpy(r.rec.data, &payload, 8);
+        r.rpm = rng() % 8000;
+        r.temp = rng() % 130;
+        r.gear = rng() % 7;
+        r.ws = rng() % 300;
+    }
+    bool failed = false;
+
+    report("can_log.csv row",
+           {run(rows, [](const Row &r, string &out) { out += canLogStreams(r); }),
+            run(rows, [](const Row &r, string &out) {
+                char line[128];
+                out.append(line, canLogPrintf(r, line));
+            }),
+            run(rows, [](const Row &r, string &out) {
+                char line[80];
+                out.append(line, formatCaptureRow(r.rec, line));
+            })},
+           failed);
+
+    report("vehicle_decoded_log.csv row",
+           {run(rows, [start](const Row &r, string &out) { out += decodedStreams(r, start); }),
+            run(rows, [start](const Row &r, string &out) {
+                char line[256];
+                out.append(line, decodedPrintf(r, start, line));
+            }),
+            run(rows, [start](const Row &r, string &out) {
+                char line[256];
+                out.append(line, decodedTable(r, start, line));
+            })},
+           failed);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+// Allocation-free text formatting for log rows and console lines.
+// The format* functions write at out and return the bytes written, without
+// a terminating NUL; callers size their line buffers for the longest row.
+
+// Two hex digits per byte value, upper and lower case
+struct CANHexTable {
+    char upper[512], lower[512];
+
+    constexpr CANHexTable() : upper(), lower() {
+        const char *U = "0123456789ABCDEF", *L = "0123456789abcdef";
+        for (int i = 0; i < 256; i++) {
+            upper[2 * i] = U[i >> 4];
+            upper[2 * i + 1] = U[i & 15];
+            lower[2 * i] = L[i >> 4];
+            lower[2 * i + 1] = L[i & 15];
+        }
+    }
+};
+
+inline constexpr CANHexTable canHex{};
+
+// A NUL-terminated string, without the NUL
+inline size_t formatText(const char *s, char *out) {
+    size_t n = strlen(s);
+    memcpy(out, s, n);
+    return n;
+}
+
+// Payload bytes as hex pairs, separated by sep ('\0' for none)
+inline size_t formatBytes(const uint8_t *data, int n, char *out, char sep = ' ', bool upper = true) {
+    const char *table = upper ? canHex.upper : canHex.lower;
+    char *p = out;
+    for (int i = 0; i < n; i++) {
+        if (sep && i) *p++ = sep;
+        memcpy(p, table + 2 * data[i], 2);
+        p += 2;
+    }
+    return p - out;
+}
+
+// Hex number without leading zeros or "0x" ("0" for zero); at most 8 bytes
+inline size_t formatHex(uint32_t v, char *out, bool upper = true) {
+    const char *table = upper ? canHex.upper : canHex.lower;
+    int digits = (32 - __builtin_clz(v | 1) + 3) / 4;
+    for (int i = digits - 1; i >= 0; i--, v >>= 4) out[i] = table[2 * (v & 15) + 1];
+    return digits;
+}
+
+// Decimal integer; at most 20 bytes
+template <typename T>
+inline size_t formatDec(T v, char *out) {
+    return std::to_chars(out, out + 20, v).ptr - out;
+}
+
+// printf("%.*f") equivalent; at most 32 bytes, falling back to exponent
+// notation for magnitudes that do not fit
+inline size_t formatFixed(double v, int precision, char *out) {
+    auto r = std::to_chars(out, out + 32, v, std::chars_format::fixed, precision);
+    if (r.ec != std::errc()) r = std::to_chars(out, out + 32, v, std::chars_format::scientific, std::min(precision, 16));
+    return r.ptr - out;
+}
+
+// "YYYY-MM-DD HH:MM:SS.fff" (digits = 3), ".ffffff" (6) or ".fffffffff"
+// (9) local time of a CLOCK_REALTIME timestamp. The date/time prefix is
+// cached per second per thread, so localtime runs once a second.
+inline size_t formatWallTime(int64_t wall_ns, char *out, int digits = 3) {
+    static const uint32_t scale[] = {1000000000, 100000000, 10000000, 1000000, 100000,
+                                     10000,      1000,      100,      10,      1};
+    thread_local time_t cachedSec = -1;
+    thread_local char cached[20];
+    time_t sec = wall_ns / 1000000000;
+    if (sec != cachedSec) {
+        tm t;
+        localtime_r(&sec, &t);
+        strftime(cached, sizeof(cached), "%Y-%m-%d %H:%M:%S", &t);
+        cachedSec = sec;
+    }
+    memcpy(out, cached, 19);
+    out[19] = '.';
+    // Zero-padded: format 1fff.. and drop the leading 1
+    char frac[12];
+    uint32_t f = uint32_t(wall_ns % 1000000000) / scale[digits] + scale[9 - digits];
+    std::to_chars(frac, frac + sizeof(frac), f);
+    memcpy(out + 20, frac + 1, digits);
+    return 20 + digits;
+}
+
+// Text buffer reused across frames: append fields, hand data()/size() to
+// write or fwrite, clear(). It only allocates when a line outgrows it.
+class CANTextBuffer {
+public:
+    explicit CANTextBuffer(size_t capacity = 4096) : buf(capacity) {}
+
+    const char *data() const { return buf.data(); }
+    size_t size() const { return len; }
+    bool empty() const { return len == 0; }
+    void clear() { len = 0; }
+
+    CANTextBuffer &put(char c) {
+        *room(1) = c;
+        len++;
+        return *this;
+    }
+    CANTextBuffer &put(const char *s, size_t n) {
+        memcpy(room(n), s, n);
+        len += n;
+        return *this;
+    }
+    CANTextBuffer &put(const char *s) { return put(s, strlen(s)); }
+
+    CANTextBuffer &hex(uint32_t v, bool upper = true) {
+        len += formatHex(v, room(8), upper);
+        return *this;
+    }
+    template <typename T>
+    CANTextBuffer &dec(T v) {
+        len += formatDec(v, room(20));
+        return *this;
+    }
+    CANTextBuffer &fixed(double v, int precision) {
+        len += formatFixed(v, precision, room(32));
+        return *this;
+    }
+    CANTextBuffer &bytes(const uint8_t *data, int n, char sep = ' ', bool upper = true) {
+        len += formatBytes(data, n, room(3 * n), sep, upper);
+        return *this;
+    }
+    CANTextBuffer &wallTime(int64_t wall_ns, int digits = 3) {
+        len += formatWallTime(wall_ns, room(29), digits);
+        return *this;
+    }
+
+private:
+    // Space for n more bytes at the end
+    char *room(size_t n) {
+        if (len + n > buf.size()) buf.resize(std::max(buf.size() * 2, len + n));
+        return buf.data() + len;
+    }
+
+    std::vector<char> buf;
+    size_t len = 0;
+};
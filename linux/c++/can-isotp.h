@@ -0,0 +1,322 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include <linux/can.h>
+
+// ISO 15765-2 (ISO-TP) transport in userspace, for many channels over one
+// CAN socket. A channel is a pair of IDs (we send on tx, the peer answers
+// on rx); each has preallocated send and receive buffers, so segmenting
+// and reassembling never allocates. Outgoing frames go to the send
+// handler, which would typically queue them on a CANTransmitter and
+// flush once per loop iteration.
+//
+// Feed every received frame to receive() and call poll() whenever
+// nextDeadline() passes: it sends consecutive frames paced by the peer's
+// STmin and expires N_Bs/N_Cr timeouts.
+
+enum class ISOTPError {
+    Timeout,            // no flow control (N_Bs) or consecutive frame (N_Cr)
+    WrongSequence,      // consecutive frame out of order
+    Overflow,           // message larger than the buffer, or peer refused it
+    Unexpected,         // new first/single frame cut a reception short
+};
+
+class ISOTPEngine {
+public:
+    using SendHandler = std::function<void(const can_frame &frame)>;
+    using MessageHandler = std::function<void(int channel, const uint8_t *data, size_t len)>;
+    using ErrorHandler = std::function<void(int channel, ISOTPError error)>;
+    using SentHandler = std::function<void(int channel)>;
+
+    static constexpr uint64_t NEVER = UINT64_MAX;
+
+    // Flow control we ask peers for, and frame layout
+    uint8_t blockSize = 0;          // consecutive frames per flow control, 0 = all
+    uint8_t stMin = 0;              // ISO-TP STmin byte we advertise
+    uint8_t padding = 0xCC;         // frames are always 8 bytes
+    uint64_t timeoutNs = 1000000000ull;     // N_Bs and N_Cr
+
+    MessageHandler onMessage;       // complete message received
+    ErrorHandler onError;           // reception or transmission abandoned
+    SentHandler onSent;             // last frame of a message handed to send
+
+    ISOTPEngine(size_t maxChannels, SendHandler send, size_t maxMessage = 4095)
+        : sendFrame(std::move(send)), channelLimit(maxChannels), bufferSize(maxMessage),
+          buffers(maxChannels * maxMessage * 2) {
+        channels.reserve(maxChannels);
+        byRx.reserve(maxChannels);
+    }
+
+    ISOTPEngine(const ISOTPEngine &) = delete;
+    ISOTPEngine &operator=(const ISOTPEngine &) = delete;
+
+    // Channel sending on txId and receiving on rxId (29-bit IDs carry
+    // CAN_EFF_FLAG). A listen-only channel reassembles what it sees but
+    // never sends flow control, for monitoring someone else's traffic.
+    // Returns the channel number, or -1 if full or rxId is taken.
+    int open(canid_t txId, canid_t rxId, bool listenOnly = false) {
+        if (channels.size() >= channelLimit || byRx.count(key(rxId))) return -1;
+        int ch = channels.size();
+        Channel c{};
+        c.txId = txId;
+        c.rxId = rxId;
+        c.listenOnly = listenOnly;
+        c.txBuf = &buffers[ch * bufferSize * 2];
+        c.rxBuf = c.txBuf + bufferSize;
+        channels.push_back(c);
+        byRx[key(rxId)] = ch;
+        return ch;
+    }
+
+    // Start sending a message; false if the channel is still sending one
+    // or the message does not fit
+    bool send(int ch, const uint8_t *data, size_t len, uint64_t nowNs) {
+        Channel &c = channels[ch];
+        if (c.tx != IDLE || len == 0 || len > bufferSize) return false;
+
+        can_frame f = frame(c.txId);
+        if (len <= 7) {
+            f.data[0] = len;
+            memcpy(f.data + 1, data, len);
+            sendFrame(f);
+            if (onSent) onSent(ch);
+            return true;
+        }
+
+        memcpy(c.txBuf, data, len);
+        size_t at;
+        if (len <= 4095) {
+            f.data[0] = 0x10 | len >> 8;
+            f.data[1] = len;
+            at = 6;
+            memcpy(f.data + 2, data, at);
+        } else {
+            // Escape sequence: FF_DL of 0 followed by a 32-bit length
+            f.data[0] = 0x10;
+            f.data[1] = 0;
+            for (int i = 0; i < 4; i++) f.data[2 + i] = len >> (24 - 8 * i);
+            at = 2;
+            memcpy(f.data + 6, data, at);
+        }
+        sendFrame(f);
+        c.txLen = len;
+        c.txPos = at;
+        c.txSeq = 1;
+        c.tx = WAIT_FC;
+        c.txDeadline = nowNs + timeoutNs;
+        return true;
+    }
+
+    // Handle a received frame; false if its ID belongs to no channel
+    bool receive(const can_frame &f, uint64_t nowNs) {
+        auto it = byRx.find(key(f.can_id));
+        if (it == byRx.end()) return false;
+        int ch = it->second;
+        Channel &c = channels[ch];
+        if (f.can_dlc < 1) return true;
+
+        switch (f.data[0] >> 4) {
+        case 0: {       // single frame
+            size_t len = f.data[0] & 0x0F;
+            if (len == 0 || len > size_t(f.can_dlc - 1)) return true;
+            interrupt(ch);
+            if (onMessage) onMessage(ch, f.data + 1, len);
+            break;
+        }
+        case 1: {       // first frame
+            if (f.can_dlc < 8) return true;
+            size_t len = (f.data[0] & 0x0F) << 8 | f.data[1];
+            size_t at = 2;
+            if (len == 0) {
+                len = uint32_t(f.data[2]) << 24 | f.data[3] << 16 | f.data[4] << 8 | f.data[5];
+                at = 6;
+            }
+            interrupt(ch);
+            if (len <= 7) return true;
+            if (len > bufferSize) {
+                if (!c.listenOnly) flowControl(c, 2);
+                if (onError) onError(ch, ISOTPError::Overflow);
+                return true;
+            }
+            memcpy(c.rxBuf, f.data + at, 8 - at);
+            c.rxLen = len;
+            c.rxPos = 8 - at;
+            c.rxSeq = 1;
+            c.rxActive = true;
+            c.rxBlockLeft = blockSize;
+            c.rxDeadline = nowNs + timeoutNs;
+            if (!c.listenOnly) flowControl(c, 0);
+            break;
+        }
+        case 2: {       // consecutive frame
+            if (!c.rxActive) return true;
+            if ((f.data[0] & 0x0F) != (c.rxSeq & 0x0F)) {
+                c.rxActive = false;
+                if (onError) onError(ch, ISOTPError::WrongSequence);
+                return true;
+            }
+            size_t n = std::min<size_t>({7, c.rxLen - c.rxPos, size_t(f.can_dlc - 1)});
+            memcpy(c.rxBuf + c.rxPos, f.data + 1, n);
+            c.rxPos += n;
+            c.rxSeq++;
+            c.rxDeadline = nowNs + timeoutNs;
+            if (c.rxPos == c.rxLen) {
+                c.rxActive = false;
+                if (onMessage) onMessage(ch, c.rxBuf, c.rxLen);
+            } else if (!c.listenOnly && blockSize && --c.rxBlockLeft == 0) {
+                c.rxBlockLeft = blockSize;
+                flowControl(c, 0);
+            }
+            break;
+        }
+        case 3: {       // flow control for what we are sending
+            if (c.tx != WAIT_FC || f.can_dlc < 3) return true;
+            uint8_t status = f.data[0] & 0x0F;
+            if (status == 0) {
+                c.tx = SENDING;
+                c.txBlockLeft = f.data[1];
+                c.txStMinNs = stMinNs(f.data[2]);
+                c.txDue = nowNs;
+                pump(ch, nowNs);
+            } else if (status == 1) {
+                c.txDeadline = nowNs + timeoutNs;       // wait: peer needs more time
+            } else {
+                c.tx = IDLE;
+                if (onError) onError(ch, ISOTPError::Overflow);
+            }
+            break;
+        }
+        }
+        return true;
+    }
+
+    // Send consecutive frames that are due and expire timeouts
+    void poll(uint64_t nowNs) {
+        for (size_t ch = 0; ch < channels.size(); ch++) {
+            Channel &c = channels[ch];
+            if (c.tx == SENDING) pump(ch, nowNs);
+            if (c.tx == WAIT_FC && nowNs > c.txDeadline) {
+                c.tx = IDLE;
+                if (onError) onError(ch, ISOTPError::Timeout);
+            }
+            if (c.rxActive && nowNs > c.rxDeadline) {
+                c.rxActive = false;
+                if (onError) onError(ch, ISOTPError::Timeout);
+            }
+        }
+    }
+
+    // Earliest time poll() has something to do, or NEVER
+    uint64_t nextDeadline() const {
+        uint64_t next = NEVER;
+        for (auto &c : channels) {
+            if (c.tx == SENDING) next = std::min(next, c.txDue);
+            if (c.tx == WAIT_FC) next = std::min(next, c.txDeadline);
+            if (c.rxActive) next = std::min(next, c.rxDeadline);
+        }
+        return next;
+    }
+
+    bool sending(int ch) const { return channels[ch].tx != IDLE; }
+    bool receiving(int ch) const { return channels[ch].rxActive; }
+    size_t channelCount() const { return channels.size(); }
+
+private:
+    enum TxState : uint8_t { IDLE, WAIT_FC, SENDING };
+
+    struct Channel {
+        canid_t txId;
+        canid_t rxId;
+        bool listenOnly;
+
+        TxState tx;
+        uint8_t txSeq;
+        uint8_t txBlockLeft;        // 0 = no limit from the peer
+        size_t txLen;
+        size_t txPos;
+        uint64_t txStMinNs;
+        uint64_t txDue;             // next consecutive frame
+        uint64_t txDeadline;        // N_Bs
+        uint8_t *txBuf;
+
+        bool rxActive;
+        uint8_t rxSeq;
+        uint8_t rxBlockLeft;
+        size_t rxLen;
+        size_t rxPos;
+        uint64_t rxDeadline;        // N_Cr
+        uint8_t *rxBuf;
+    };
+
+    static canid_t key(canid_t id) {
+        return id & CAN_EFF_FLAG ? id & (CAN_EFF_FLAG | CAN_EFF_MASK) : id & CAN_SFF_MASK;
+    }
+
+    can_frame frame(canid_t id) const {
+        can_frame f{};
+        f.can_id = id;
+        f.can_dlc = 8;
+        memset(f.data, padding, 8);
+        return f;
+    }
+
+    // STmin byte: 0-127 ms, 0xF1-0xF9 100-900 us, anything else reserved
+    // and treated as the maximum
+    static uint64_t stMinNs(uint8_t v) {
+        if (v <= 0x7F) return v * 1000000ull;
+        if (v >= 0xF1 && v <= 0xF9) return (v - 0xF0) * 100000ull;
+        return 127000000ull;
+    }
+
+    void flowControl(const Channel &c, uint8_t status) {
+        can_frame f = frame(c.txId);
+        f.data[0] = 0x30 | status;
+        f.data[1] = blockSize;
+        f.data[2] = stMin;
+        sendFrame(f);
+    }
+
+    // A single or first frame replaces any reception in progress
+    void interrupt(int ch) {
+        Channel &c = channels[ch];
+        if (!c.rxActive) return;
+        c.rxActive = false;
+        if (onError) onError(ch, ISOTPError::Unexpected);
+    }
+
+    // Emit consecutive frames until STmin, the block size or the end stops us
+    void pump(int ch, uint64_t nowNs) {
+        Channel &c = channels[ch];
+        while (c.tx == SENDING && nowNs >= c.txDue) {
+            can_frame f = frame(c.txId);
+            size_t n = std::min<size_t>(7, c.txLen - c.txPos);
+            f.data[0] = 0x20 | (c.txSeq & 0x0F);
+            memcpy(f.data + 1, c.txBuf + c.txPos, n);
+            sendFrame(f);
+            c.txPos += n;
+            c.txSeq++;
+
+            if (c.txPos == c.txLen) {
+                c.tx = IDLE;
+                if (onSent) onSent(ch);
+            } else if (c.txBlockLeft && --c.txBlockLeft == 0) {
+                c.tx = WAIT_FC;
+                c.txDeadline = nowNs + timeoutNs;
+            } else {
+                c.txDue = nowNs + c.txStMinNs;
+            }
+        }
+    }
+
+    SendHandler sendFrame;
+    size_t channelLimit;
+    size_t bufferSize;
+    std::vector<uint8_t> buffers;
+    std::vector<Channel> channels;
+    std::unordered_map<canid_t, int> byRx;
+};
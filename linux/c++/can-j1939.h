@@ -0,0 +1,288 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <linux/can.h>
+#include "can-dbc.h"
+
+// SAE J1939 on 29-bit frames: identifier fields, a PGN-keyed view of a
+// CANDecodeTable, and transport-protocol (TP.CM/TP.DT) reassembly.
+
+constexpr uint8_t J1939_GLOBAL = 0xFF;      // broadcast destination
+constexpr uint8_t J1939_NULL = 0xFE;        // no address claimed
+constexpr uint32_t J1939_TP_CM = 0xEC00;    // connection management
+constexpr uint32_t J1939_TP_DT = 0xEB00;    // data transfer
+constexpr uint16_t J1939_MAX_SIZE = 1785;   // 255 packets of 7 bytes
+
+// Priority, PGN and addresses of a 29-bit identifier. For PDU1 PGNs
+// (PF < 240) the PS byte is the destination address and not part of the
+// PGN; PDU2 PGNs are always broadcast.
+struct J1939Id {
+    uint8_t priority = 6;
+    uint32_t pgn = 0;
+    uint8_t source = J1939_NULL;
+    uint8_t dest = J1939_GLOBAL;
+
+    static J1939Id parse(canid_t can_id) {
+        J1939Id id;
+        id.priority = (can_id >> 26) & 7;
+        id.pgn = (can_id >> 8) & 0x3FFFF;
+        id.source = can_id & 0xFF;
+        if (pdu1(id.pgn)) {
+            id.dest = id.pgn & 0xFF;
+            id.pgn &= 0x3FF00;
+        }
+        return id;
+    }
+
+    static bool pdu1(uint32_t pgn) { return ((pgn >> 8) & 0xFF) < 240; }
+
+    canid_t canId() const {
+        uint32_t ps = pdu1(pgn) ? dest : pgn & 0xFF;
+        return CAN_EFF_FLAG | uint32_t(priority & 7) << 26 | (pgn & 0x3FF00) << 8 | ps << 8 | source;
+    }
+};
+
+// Message definitions looked up by PGN, so one DBC entry (defined with
+// whatever source address the DBC author saw) matches every sender. An
+// exact 29-bit ID match still wins, for DBCs that define the same PGN per
+// source. Uses the same perfect hash as the decode table.
+class J1939Index {
+public:
+    explicit J1939Index(const CANDecodeTable &t) : table(t) {
+        std::vector<uint32_t> keys;
+        std::vector<std::pair<uint32_t, uint32_t>> entries;
+        for (size_t m = 0; m < t.messageCount(); m++) {
+            uint32_t id = t.message(m).id;
+            if (!(id & CAN_EFF_FLAG)) continue;
+            uint32_t pgn = J1939Id::parse(id).pgn;
+            bool seen = false;
+            for (uint32_t k : keys) seen = seen || k == pgn;
+            if (seen) continue;         // first definition of a PGN wins
+            keys.push_back(pgn);
+            entries.push_back({pgn, uint32_t(m)});
+        }
+        hash.build(keys);
+        for (auto &[pgn, m] : entries)
+            hash.setValue(pgn, m);
+    }
+
+    const CANMessageDesc *find(canid_t can_id) const {
+        if (!(can_id & CAN_EFF_FLAG)) return table.find(can_id);
+        if (const CANMessageDesc *exact = table.find(can_id)) return exact;
+        return findPgn(J1939Id::parse(can_id).pgn);
+    }
+
+    const CANMessageDesc *findPgn(uint32_t pgn) const {
+        int m = hash.find(pgn);
+        return m < 0 ? nullptr : &table.message(m);
+    }
+
+private:
+    const CANDecodeTable &table;
+    CANIdHash hash;
+};
+
+// A reassembled multi-packet message; data is valid during the callback
+struct J1939Message {
+    uint32_t pgn;
+    uint8_t source;
+    uint8_t dest;               // J1939_GLOBAL for BAM
+    uint16_t size;
+    const uint8_t *data;
+};
+
+// Reassembles BAM broadcasts and RTS/CTS transfers into fixed in-object
+// buffers, one per concurrent session, so nothing is allocated per
+// message. RTS/CTS transfers addressed to `address` are answered (CTS,
+// end-of-message ACK, abort); transfers between other nodes are followed
+// passively, which is what a logger wants.
+template <int MaxSessions = 8>
+class J1939Transport {
+public:
+    explicit J1939Transport(uint8_t addr = J1939_NULL) : address(addr) {}
+
+    // Feed every received frame. TP frames are consumed (returns true) and
+    // deliver(const J1939Message &) is called when a transfer completes;
+    // send(const can_frame &) transmits our CTS/ACK/abort replies.
+    template <typename Deliver, typename Send>
+    bool receive(const can_frame &f, uint64_t nowNs, Deliver &&deliver, Send &&send) {
+        if (!(f.can_id & CAN_EFF_FLAG)) return false;
+        J1939Id id = J1939Id::parse(f.can_id);
+        if (id.pgn != J1939_TP_CM && id.pgn != J1939_TP_DT) return false;
+        expire(nowNs, send);
+        if (f.can_dlc < 8) return true;
+        if (id.pgn == J1939_TP_CM) control(id, f.data, nowNs, send);
+        else data(id, f.data, nowNs, deliver, send);
+        return true;
+    }
+
+    // Drop transfers that went quiet for longer than the J1939-21 limits
+    // (T1 for BAM, T3 for connection mode); called by receive() as well
+    template <typename Send>
+    void expire(uint64_t nowNs, Send &&send) {
+        for (auto &s : sessions) {
+            if (!s.active) continue;
+            uint64_t limit = s.dest == J1939_GLOBAL ? T1_NS : T3_NS;
+            if (nowNs - s.lastNs <= limit) continue;
+            if (ours(s.dest)) abort(s.dest, s.source, s.pgn, 3, send);
+            s.active = false;
+            timeouts++;
+        }
+    }
+
+    uint64_t completed = 0;     // messages delivered
+    uint64_t aborted = 0;       // aborts received or sent, bad sequences
+    uint64_t timeouts = 0;
+
+private:
+    static constexpr uint8_t RTS = 16, CTS = 17, ACK = 19, BAM = 32, ABORT = 255;
+    static constexpr uint64_t T1_NS = 750000000ull;
+    static constexpr uint64_t T3_NS = 1250000000ull;
+    static constexpr uint8_t WINDOW = 16;   // packets per CTS we ask for
+
+    struct Session {
+        bool active = false;
+        uint8_t source;
+        uint8_t dest;
+        uint8_t packets;        // total
+        uint8_t next;           // sequence number expected next
+        uint8_t windowEnd;      // last packet of the current CTS window
+        uint8_t maxPerCts;      // sender's limit from the RTS
+        uint16_t size;
+        uint32_t pgn;
+        uint64_t lastNs;
+        uint8_t data[J1939_MAX_SIZE];
+    };
+
+    bool ours(uint8_t dest) const { return dest == address && address < J1939_NULL; }
+
+    static uint32_t pgnOf(const uint8_t *d) { return d[5] | d[6] << 8 | uint32_t(d[7]) << 16; }
+
+    Session *lookup(uint8_t source, uint8_t dest) {
+        for (auto &s : sessions)
+            if (s.active && s.source == source && s.dest == dest) return &s;
+        return nullptr;
+    }
+
+    template <typename Send>
+    void control(const J1939Id &id, const uint8_t *d, uint64_t nowNs, Send &send) {
+        uint32_t pgn = pgnOf(d);
+        switch (d[0]) {
+        case RTS:
+        case BAM: {
+            uint8_t dest = d[0] == BAM ? J1939_GLOBAL : id.dest;
+            bool isOurs = d[0] == RTS && ours(dest);
+            uint16_t size = d[1] | d[2] << 8;
+            uint8_t packets = d[3];
+            if (size < 9 || size > J1939_MAX_SIZE || packets != (size + 6) / 7) {
+                if (isOurs) abort(dest, id.source, pgn, 9, send);
+                return;
+            }
+
+            // A new announcement from the same sender replaces the old one
+            Session *s = lookup(id.source, dest);
+            if (!s)
+                for (auto &free : sessions)
+                    if (!free.active) { s = &free; break; }
+            if (!s) {
+                if (isOurs) abort(dest, id.source, pgn, 2, send);
+                else aborted++;
+                return;
+            }
+            s->active = true;
+            s->source = id.source;
+            s->dest = dest;
+            s->packets = packets;
+            s->next = 1;
+            s->maxPerCts = d[0] == RTS && d[4] ? d[4] : 0xFF;
+            s->size = size;
+            s->pgn = pgn;
+            s->lastNs = nowNs;
+            s->windowEnd = packets;
+            if (isOurs) clearToSend(*s, send);
+            break;
+        }
+        case CTS: {
+            // Passive follower: the receiver answering keeps the session alive
+            Session *s = lookup(id.dest, id.source);
+            if (s) s->lastNs = nowNs;
+            break;
+        }
+        case ABORT: {
+            Session *s = lookup(id.source, id.dest);
+            if (!s) s = lookup(id.dest, id.source);
+            if (s && s->pgn == pgn) {
+                s->active = false;
+                aborted++;
+            }
+            break;
+        }
+        }
+    }
+
+    template <typename Deliver, typename Send>
+    void data(const J1939Id &id, const uint8_t *d, uint64_t nowNs, Deliver &deliver, Send &send) {
+        Session *s = lookup(id.source, id.dest);
+        if (!s) return;
+        bool isOurs = ours(s->dest);
+        uint8_t seq = d[0];
+        if (seq == s->next - 1) return;         // retransmitted duplicate
+        if (seq != s->next) {
+            s->active = false;
+            if (isOurs) abort(s->dest, s->source, s->pgn, 7, send);
+            else aborted++;
+            return;
+        }
+
+        size_t at = size_t(seq - 1) * 7;
+        memcpy(s->data + at, d + 1, std::min<size_t>(7, s->size - at));
+        s->lastNs = nowNs;
+        s->next++;
+        if (seq == s->packets) {
+            s->active = false;
+            completed++;
+            if (isOurs) {
+                uint8_t ack[8] = {ACK, uint8_t(s->size), uint8_t(s->size >> 8), s->packets, 0xFF};
+                reply(s->dest, s->source, s->pgn, ack, send);
+            }
+            deliver(J1939Message{s->pgn, s->source, s->dest, s->size, s->data});
+        } else if (isOurs && seq == s->windowEnd) {
+            clearToSend(*s, send);
+        }
+    }
+
+    template <typename Send>
+    void clearToSend(Session &s, Send &send) {
+        uint8_t count = std::min<int>({WINDOW, s.maxPerCts, s.packets - s.next + 1});
+        s.windowEnd = s.next + count - 1;
+        uint8_t cts[8] = {CTS, count, s.next, 0xFF, 0xFF};
+        reply(s.dest, s.source, s.pgn, cts, send);
+    }
+
+    template <typename Send>
+    void abort(uint8_t from, uint8_t to, uint32_t pgn, uint8_t reason, Send &send) {
+        uint8_t msg[8] = {ABORT, reason, 0xFF, 0xFF, 0xFF};
+        reply(from, to, pgn, msg, send);
+        aborted++;
+    }
+
+    // TP.CM frame from us to `to`, carrying pgn in bytes 5..7
+    template <typename Send>
+    static void reply(uint8_t from, uint8_t to, uint32_t pgn, uint8_t *d, Send &send) {
+        can_frame f{};
+        f.can_id = J1939Id{7, J1939_TP_CM, from, to}.canId();
+        f.can_dlc = 8;
+        memcpy(f.data, d, 5);
+        f.data[5] = pgn;
+        f.data[6] = pgn >> 8;
+        f.data[7] = pgn >> 16;
+        send(f);
+    }
+
+    uint8_t address;
+    std::array<Session, MaxSessions> sessions{};
+};
@@ -0,0 +1,171 @@
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include "can-capture.h"
+#include "can-asc.h"
+#include "can-blf.h"
+#include "can-mf4.h"
+#include "can-replay.h"
+
+using namespace std;
+
+// Converts CAN logs between the binary capture format (.cancap) and the
+// Vector ASC/BLF and ASAM MDF4 formats, streaming record by record. The
+// frame CSV logs (can_log.csv, stress_test_log.csv) are read as input.
+//
+// Usage: can-log-convert <in.{cancap,asc,blf,mf4,csv}> <out.{cancap,asc,blf,mf4}> [--sorted] [--compress]
+// --sorted writes MF4 with one data group per frame type; --compress
+// zlib-compresses BLF containers (build with -DCAN_LOG_ZLIB -lz).
+// For CSV output use can-capture-csv on a .cancap.
+
+enum Format { CANCAP, ASC, BLF, MF4, CSV, UNKNOWN };
+
+Format formatOf(const char *path) {
+    const char *dot = strrchr(path, '.');
+    if (!dot) return UNKNOWN;
+    string ext = dot + 1;
+    for (auto &c : ext) c = tolower(c);
+    if (ext == "cancap") return CANCAP;
+    if (ext == "asc") return ASC;
+    if (ext == "blf") return BLF;
+    if (ext == "mf4" || ext == "mdf") return MF4;
+    if (ext == "csv") return CSV;
+    return UNKNOWN;
+}
+
+// Start time of the input, needed before the first frame for the output header
+int64_t startOf(const char *path, Format f) {
+    switch (f) {
+    case CANCAP: { CANCaptureReader r(path); return r.ok() ? r.header().startNs : 0; }
+    case BLF: { BLFReader r(path); return r.startNs(); }
+    case MF4: { MF4Reader r(path); return r.startNs(); }
+    case ASC: {
+        FILE *file = fopen(path, "r");
+        char line[256];
+        int64_t start = 0;
+        for (int i = 0; file && i < 20 && fgets(line, sizeof(line), file); i++)
+            if (strncmp(line, "date ", 5) == 0) { start = parseASCDate(line + 5); break; }
+        if (file) fclose(file);
+        return start;
+    }
+    case CSV: {
+        // CSV has no header time: take the first frame's
+        CANMappedCSV r(path);
+        const CANCaptureRecord *first = r.ok() ? r.next() : nullptr;
+        return first ? first->ts_ns : 0;
+    }
+    default: return 0;
+    }
+}
+
+template <typename F>
+bool readLog(const char *path, Format f, F &&each) {
+    switch (f) {
+    case CANCAP: { CANCaptureReader r(path); if (!r.ok()) return false; r.forEach(each); return true; }
+    case ASC: {
+        ASCReader r(path);
+        if (!r.ok()) return false;
+        r.forEach(each);
+        if (r.skipped) cerr << r.skipped << " ASC lines were not classic CAN frames\n";
+        return true;
+    }
+    case BLF: {
+        BLFReader r(path);
+        if (!r.ok()) return false;
+        r.forEach(each);
+        if (r.compressedSkipped) cerr << r.compressedSkipped << " compressed BLF containers skipped (no zlib)\n";
+        return true;
+    }
+    case MF4: { MF4Reader r(path); if (!r.ok()) return false; r.forEach(each); return true; }
+    case CSV: {
+        CANMappedCSV r(path);
+        if (!r.ok()) return false;
+        while (const CANCaptureRecord *rec = r.next()) each(*rec);
+        if (r.skipped) cerr << r.skipped << " CSV rows did not parse\n";
+        return true;
+    }
+    default: return false;
+    }
+}
+
+int main(int argc, char **argv) {
+    vector<const char *> args;
+    bool sorted = false, compress = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--sorted") == 0) sorted = true;
+        else if (strcmp(argv[i], "--compress") == 0) compress = true;
+        else args.push_back(argv[i]);
+    }
+    if (args.size() != 2 || formatOf(args[0]) == UNKNOWN || formatOf(args[1]) == UNKNOWN || formatOf(args[1]) == CSV) {
+        cerr << "Usage: " << argv[0] << " <in.{cancap,asc,blf,mf4,csv}> <out.{cancap,asc,blf,mf4}> [--sorted] [--compress]\n";
+        return 1;
+    }
+#ifndef CAN_LOG_ZLIB
+    if (compress) {
+        cerr << "--compress needs a build with -DCAN_LOG_ZLIB -lz\n";
+        return 1;
+    }
+#endif
+    Format in = formatOf(args[0]), out = formatOf(args[1]);
+    int64_t start = startOf(args[0], in);
+
+    // Keep bus names from a capture; the other formats only number channels
+    vector<string> busNames;
+    if (in == CANCAP) {
+        CANCaptureReader r(args[0]);
+        for (int b = 0; r.ok() && b < r.header().busCount; b++) busNames.push_back(r.busName(b));
+    }
+    vector<const char *> buses;
+    for (auto &name : busNames) buses.push_back(name.c_str());
+
+    unique_ptr<CANCaptureWriter> cancap;
+    unique_ptr<ASCWriter> asc;
+    unique_ptr<BLFWriter> blf;
+    unique_ptr<MF4Writer> mf4;
+    bool opened = false;
+    switch (out) {
+    case CANCAP: cancap = make_unique<CANCaptureWriter>(args[1], buses, 65536, 4096, start);
+                 opened = cancap->ok(); break;
+    case ASC: asc = make_unique<ASCWriter>(args[1], start); opened = asc->ok(); break;
+    case BLF: blf = make_unique<BLFWriter>(args[1], start); blf->compression = compress ? 6 : 0;
+              opened = blf->ok(); break;
+    case MF4: mf4 = make_unique<MF4Writer>(args[1], start, sorted); opened = mf4->ok(); break;
+    default: break;
+    }
+    if (!opened) return 1;
+
+    uint64_t frames = 0;
+    bool writeOk = true;
+    auto t0 = chrono::steady_clock::now();
+    bool readOk = readLog(args[0], in, [&](const CANCaptureRecord &r) {
+        frames++;
+        if (cancap) {
+            // Offline there is no reception to protect: wait for room instead of dropping
+            while (cancap->queued() >= cancap->capacity()) this_thread::sleep_for(chrono::microseconds(200));
+            cancap->push(r);
+        }
+        else if (asc) writeOk = asc->write(r) && writeOk;
+        else if (blf) writeOk = blf->write(r) && writeOk;
+        else writeOk = mf4->write(r) && writeOk;
+    });
+
+    if (cancap) {
+        cancap->stop();
+        writeOk = cancap->writeErrors == 0 && writeOk;
+    }
+    else if (asc) writeOk = asc->close() && writeOk;
+    else if (blf) writeOk = blf->close() && writeOk;
+    else writeOk = mf4->close() && writeOk;
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+    if (!readOk || !writeOk) {
+        cerr << "Conversion failed\n";
+        return 1;
+    }
+    cout << frames << " frames converted in " << secs << " s (" << (secs > 0 ? frames / secs / 1e6 : 0)
+         << " M frames/s)" << endl;
+    return 0;
+}
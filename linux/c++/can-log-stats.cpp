@@ -0,0 +1,305 @@
+#include <iostream>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "can-capture.h"
+#include "can-dbc.h"
+#include "can-dbc-cache.h"
+#include "can-parallel.h"
+
+using namespace std;
+
+// Aggregates CSV logs on all cores: per-ID frame statistics and per-signal
+// count/min/max/mean/stddev.
+//
+// Usage: can-log-stats [--dbc file.dbc] [--threads N] [--chunk MB] <log.csv>...
+//
+// Frame logs (a CAN_ID and a Data column: can_log.csv, stress_test_log.csv,
+// can-query output) give per-ID statistics, plus per-signal statistics
+// when a DBC is given. Every other numeric column (e.g. BusLoad, or the
+// signal columns of can_dbc_log.csv) is aggregated as a signal by name.
+//
+// Files are mapped and split into chunks at line boundaries, and chunks run
+// on a work-stealing pool. Each chunk keeps its own partial statistics and
+// the partials are merged in file/chunk order, so the output is identical
+// for any thread count.
+
+struct SignalStats {
+    uint64_t count = 0;
+    double min = 0, max = 0, mean = 0, m2 = 0;
+
+    void add(double x) {
+        if (!count || x < min) min = x;
+        if (!count || x > max) max = x;
+        count++;
+        double d = x - mean;
+        mean += d / count;
+        m2 += d * (x - mean);
+    }
+
+    // Parallel form of Welford's update (Chan et al.)
+    void merge(const SignalStats &o) {
+        if (!o.count) return;
+        if (!count) { *this = o; return; }
+        uint64_t n = count + o.count;
+        double d = o.mean - mean;
+        mean += d * o.count / n;
+        m2 += o.m2 + d * d * (double(count) * o.count / n);
+        min = std::min(min, o.min);
+        max = std::max(max, o.max);
+        count = n;
+    }
+
+    double stddev() const { return count > 1 ? sqrt(m2 / (count - 1)) : 0; }
+};
+
+struct IdStats {
+    uint64_t frames = 0;
+    uint64_t bytes = 0;
+    uint8_t minDlc = 8, maxDlc = 0;
+
+    void merge(const IdStats &o) {
+        frames += o.frames;
+        bytes += o.bytes;
+        minDlc = std::min(minDlc, o.minDlc);
+        maxDlc = std::max(maxDlc, o.maxDlc);
+    }
+};
+
+// Column roles in one file's header
+struct Layout {
+    enum Role : int8_t { SKIP = -1, CAN_ID = -2, TYPE = -3, DLC = -4, DATA = -5 };
+    vector<int> columns;        // Role, or a signal slot >= 0
+    bool frames = false;        // has CAN_ID and Data
+};
+
+// Partial results of one chunk; key is the ID with CAN_EFF_FLAG for 29-bit
+struct ChunkStats {
+    uint64_t rows = 0, unparsed = 0;
+    unordered_map<uint32_t, IdStats> ids;
+    vector<SignalStats> signals;
+};
+
+// Signal slots: DBC signals first, as Message.Signal, then CSV columns by name
+struct SignalNames {
+    vector<string> names;
+    map<string, int> slots;
+
+    int slot(const string &name) {
+        auto [it, added] = slots.emplace(name, names.size());
+        if (added) names.push_back(name);
+        return it->second;
+    }
+};
+
+Layout readHeader(string_view line, SignalNames &names) {
+    Layout l;
+    size_t pos = 0;
+    bool id = false, data = false;
+    for (int col = 0; pos <= line.size(); col++) {
+        size_t comma = line.find(',', pos);
+        if (comma == string_view::npos) comma = line.size();
+        string name(line.substr(pos, comma - pos));
+        while (!name.empty() && (name.back() == '\r' || name.back() == ' ')) name.pop_back();
+        int role = Layout::SKIP;
+        if (name == "CAN_ID") role = Layout::CAN_ID, id = true;
+        else if (name == "Type") role = Layout::TYPE;
+        else if (name == "DLC") role = Layout::DLC;
+        else if (name == "Data") role = Layout::DATA, data = true;
+        else if (col > 0 && !name.empty() && name != "Timestamp") role = names.slot(name);
+        l.columns.push_back(role);
+        pos = comma + 1;
+    }
+    l.frames = id && data;
+    return l;
+}
+
+int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    c |= 0x20;
+    return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+}
+
+// DBC decoding: the table and the signal slot of each signal handle
+struct Decoder {
+    const CANDecodeTable *table = nullptr;
+    vector<int> slotOf;
+};
+
+// Parse one row; false if a frame column is malformed
+
+bool parseRow(const char *p, const char *eol, const Layout &l, const Decoder &dbc, ChunkStats &out) {
+    can_frame frame{};
+    bool haveId = false, haveData = false, extended = false;
+    int dlc = -1;
+    uint8_t bytes = 0;
+    for (size_t col = 0; col < l.columns.size() && p <= eol; col++) {
+        const char *end = static_cast<const char *>(memchr(p, ',', eol - p));
+        if (!end) end = eol;
+        int role = l.columns[col];
+        if (role >= 0) {
+            double v;
+            auto r = from_chars(p, end, v);
+            if (r.ec == errc() && r.ptr != p) out.signals[role].add(v);
+        } else if (role == Layout::CAN_ID) {
+            const char *s = p;
+            if (end - s > 2 && s[0] == '0' && (s[1] | 0x20) == 'x') s += 2;
+            uint32_t id = 0;
+            int d;
+            for (; s < end && (d = hexDigit(*s)) >= 0; s++) id = id << 4 | d;
+            if (s == p || s != end) return false;
+            frame.can_id = id;
+            haveId = true;
+        } else if (role == Layout::TYPE) {
+            extended = p < end && *p == 'E';
+        } else if (role == Layout::DLC) {
+            if (end - p != 1 || *p < '0' || *p > '8') return false;
+            dlc = *p - '0';
+        } else if (role == Layout::DATA) {
+            for (const char *s = p; s < end && bytes < 8;) {
+                if (*s == ' ' || *s == '\r') { s++; continue; }
+                int hi = hexDigit(s[0]), lo = s + 1 < end ? hexDigit(s[1]) : -1;
+                if (hi < 0 || lo < 0) return false;
+                frame.data[bytes++] = hi << 4 | lo;
+                s += 2;
+            }
+            haveData = true;
+        }
+        p = end + 1;
+    }
+    if (!l.frames) return true;
+    if (!haveId || !haveData) return false;
+
+    // IDs above 11 bits are extended even without a Type column
+    if (extended || frame.can_id > CAN_SFF_MASK) frame.can_id |= CAN_EFF_FLAG;
+    frame.can_dlc = dlc >= 0 ? dlc : bytes;
+    IdStats &s = out.ids[frame.can_id];
+    s.frames++;
+    s.bytes += frame.can_dlc;
+    s.minDlc = std::min<uint8_t>(s.minDlc, frame.can_dlc);
+    s.maxDlc = std::max<uint8_t>(s.maxDlc, frame.can_dlc);
+    if (dbc.table) dbc.table->decodeEach(frame, [&](int h, float v) { out.signals[dbc.slotOf[h]].add(v); });
+    return true;
+}
+
+void processChunk(const char *p, const char *end, const Layout &l, const Decoder &dbc, ChunkStats &out) {
+    while (p < end) {
+        const char *eol = static_cast<const char *>(memchr(p, '\n', end - p));
+        if (!eol) eol = end;
+        const char *stop = eol > p && eol[-1] == '\r' ? eol - 1 : eol;
+        if (stop > p) {
+            if (parseRow(p, stop, l, dbc, out)) out.rows++;
+            else out.unparsed++;
+        }
+        p = eol + 1;
+    }
+}
+
+int main(int argc, char **argv) {
+    vector<const char *> paths;
+    const char *dbcPath = nullptr;
+    unsigned int threads = thread::hardware_concurrency();
+    size_t chunkBytes = 8 << 20;
+    for (int i = 1; i < argc; i++) {
+        bool more = i + 1 < argc;
+        if (strcmp(argv[i], "--dbc") == 0 && more) dbcPath = argv[++i];
+        else if (strcmp(argv[i], "--threads") == 0 && more) threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--chunk") == 0 && more) chunkBytes = size_t(atof(argv[++i]) * (1 << 20));
+        else paths.push_back(argv[i]);
+    }
+    if (paths.empty() || chunkBytes == 0) {
+        cerr << "Usage: " << argv[0] << " [--dbc file.dbc] [--threads N] [--chunk MB] <log.csv>...\n";
+        return 1;
+    }
+
+    CANDecodeTable table;
+    Decoder dbc;
+    SignalNames names;
+    if (dbcPath) {
+        vector<DBCError> errors;
+        if (!loadDBCCached(dbcPath, table, errors)) {
+            for (auto &e : errors) cerr << dbcPath << ":" << e.line << ": " << e.message << endl;
+            return 1;
+        }
+        dbc.table = &table;
+        dbc.slotOf.resize(table.signalCount());
+        for (size_t m = 0; m < table.messageCount(); m++) {
+            const CANMessageDesc &msg = table.message(m);
+            for (int s = 0; s < msg.signal_count; s++) {
+                int h = msg.first_signal + s;
+                dbc.slotOf[h] = names.slot(string(table.str(msg.name)) + "." + table.str(table.signal(h).name));
+            }
+        }
+    }
+
+    // Map every file and read its header; chunks are numbered across files
+    struct Chunk { size_t file, offset, length; };
+    vector<unique_ptr<CANMappedFile>> files;
+    vector<Layout> layouts;
+    vector<Chunk> chunks;
+    uint64_t totalBytes = 0;
+    for (size_t f = 0; f < paths.size(); f++) {
+        files.emplace_back(new CANMappedFile(paths[f]));
+        const CANMappedFile &file = *files.back();
+        layouts.emplace_back();
+        if (!file.ok()) continue;
+        const char *nl = static_cast<const char *>(memchr(file.data(), '\n', file.size()));
+        size_t body = nl ? nl - file.data() + 1 : file.size();
+        layouts.back() = readHeader(string_view(file.data(), body - (nl ? 1 : 0)), names);
+        for (auto [offset, length] : splitLines(file.data() + body, file.size() - body, chunkBytes))
+            chunks.push_back({f, body + offset, length});
+        totalBytes += file.size();
+    }
+
+    CANWorkPool pool(threads);
+    vector<ChunkStats> partial(chunks.size());
+    auto t0 = chrono::steady_clock::now();
+    pool.run(chunks.size(), [&](size_t i, unsigned int) {
+        const Chunk &c = chunks[i];
+        const char *base = files[c.file]->data() + c.offset;
+        partial[i].signals.resize(names.names.size());
+        processChunk(base, base + c.length, layouts[c.file], dbc, partial[i]);
+    });
+
+    // Merge in chunk order so floating-point results do not depend on
+    // which thread finished first
+    ChunkStats total;
+    total.signals.resize(names.names.size());
+    map<uint32_t, IdStats> ids;
+    for (ChunkStats &c : partial) {
+        total.rows += c.rows;
+        total.unparsed += c.unparsed;
+        for (size_t s = 0; s < c.signals.size(); s++) total.signals[s].merge(c.signals[s]);
+        for (auto &[id, s] : c.ids) ids[id].merge(s);
+        c = ChunkStats();
+    }
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+    if (!ids.empty()) {
+        printf("ID,Frames,PayloadBytes,MinDLC,MaxDLC\n");
+        for (auto &[id, s] : ids)
+            printf("0x%X%s,%llu,%llu,%d,%d\n", id & CAN_EFF_MASK, id & CAN_EFF_FLAG ? "x" : "",
+                   (unsigned long long)s.frames, (unsigned long long)s.bytes, s.minDlc, s.maxDlc);
+        printf("\n");
+    }
+    printf("Signal,Count,Min,Max,Mean,StdDev\n");
+    for (size_t s = 0; s < names.names.size(); s++) {
+        const SignalStats &st = total.signals[s];
+        if (st.count)
+            printf("%s,%llu,%.9g,%.9g,%.9g,%.9g\n", names.names[s].c_str(), (unsigned long long)st.count, st.min,
+                   st.max, st.mean, st.stddev());
+    }
+
+    cerr << total.rows << " rows (" << total.unparsed << " unparsed) from " << paths.size() << " files, "
+         << chunks.size() << " chunks on " << pool.size() << " threads in " << secs << " s ("
+         << totalBytes / 1e6 / secs << " MB/s, " << pool.steals << " steals)" << endl;
+    return 0;
+}
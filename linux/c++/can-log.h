@@ -0,0 +1,249 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "can-rx.h"
+#include "can-format.h"
+
+// Lock-free single-producer/single-consumer ring of fixed-size records.
+// Capacity is rounded up to a power of two; push() never blocks and
+// reports a full ring so the producer can count the drop and move on.
+template <typename T>
+class CANRing {
+public:
+    explicit CANRing(size_t capacity) {
+        size_t n = 1;
+        while (n < capacity) n <<= 1;
+        slots.reset(new T[n]);
+        mask = n - 1;
+    }
+
+    CANRing(const CANRing &) = delete;
+    CANRing &operator=(const CANRing &) = delete;
+
+    // Producer side
+    bool push(const T &item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tailCache > mask) {
+            tailCache = tail.load(std::memory_order_acquire);
+            if (h - tailCache > mask) return false;
+        }
+        slots[h & mask] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: up to max records in place, then release them
+    size_t peek(const T *&first, size_t max) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t n = std::min(head.load(std::memory_order_acquire) - t, max);
+        n = std::min(n, mask + 1 - (t & mask));     // contiguous part only
+        first = &slots[t & mask];
+        return n;
+    }
+
+    void release(size_t n) { tail.store(tail.load(std::memory_order_relaxed) + n, std::memory_order_release); }
+
+    // Approximate from either side
+    size_t size() const { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire); }
+    size_t capacity() const { return mask + 1; }
+
+private:
+    std::unique_ptr<T[]> slots;
+    size_t mask;
+    alignas(64) std::atomic<size_t> head{0};
+    size_t tailCache = 0;       // producer's last view of tail
+    alignas(64) std::atomic<size_t> tail{0};
+};
+
+// When the writer thread forces data to disk
+enum class CANLogSync {
+    None,           // leave it to the page cache
+    Interval,       // fdatasync at most every syncIntervalNs
+    EveryBatch,     // fdatasync after each write
+};
+
+// Asynchronous log file. The receive thread push()es fixed-size records
+// into a CANRing; a writer thread formats them into a large buffer and
+// writes it with one write(2) per batch, so a slow disk fills the ring
+// instead of stalling reception. A full ring drops the record and counts
+// it. format(record, out) writes at most MaxLine bytes and returns the
+// length.
+template <typename Record, size_t MaxLine = 256>
+class CANLogWriter {
+public:
+    using Formatter = std::function<size_t(const Record &record, char *out)>;
+
+    CANLogSync sync = CANLogSync::Interval;
+    uint64_t syncIntervalNs = 1000000000ull;
+
+    CANLogWriter(const char *path, const char *header, Formatter fmt,
+                 size_t ringRecords = 65536, size_t batchBytes = 1 << 20)
+        : ring(ringRecords), format(std::move(fmt)), buffer(std::max(batchBytes, 2 * MaxLine)) {
+        fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) { perror(path); return; }
+        opened = true;
+        size_t len = strlen(header);
+        if (write(fd, header, len) != ssize_t(len)) writeErrors++;
+        writer = std::thread([this] { run(); });
+    }
+
+    ~CANLogWriter() { stop(); }
+
+    CANLogWriter(const CANLogWriter &) = delete;
+    CANLogWriter &operator=(const CANLogWriter &) = delete;
+
+    // Receive thread only; false if the ring was full and the record dropped
+    bool push(const Record &r) {
+        if (!ring.push(r)) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        size_t used = ring.size();
+        if (used > highWater.load(std::memory_order_relaxed))
+            highWater.store(used, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Drain the ring, sync and close; safe to call more than once
+    void stop() {
+        stopping = true;
+        if (writer.joinable()) writer.join();
+        if (fd >= 0) {
+            if (sync != CANLogSync::None) fdatasync(fd);
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    bool ok() const { return opened; }
+    size_t capacity() const { return ring.capacity(); }
+
+    std::atomic<uint64_t> dropped{0};       // ring full
+    std::atomic<uint64_t> highWater{0};     // most records ever queued
+    std::atomic<uint64_t> written{0};       // records formatted and written
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> writeErrors{0};
+
+private:
+    void run() {
+        uint64_t lastSync = monotonicNowNs();
+        size_t len = 0;
+        while (true) {
+            bool last = stopping.load();
+            const Record *batch;
+            size_t n = ring.peek(batch, (buffer.size() - len) / MaxLine);
+            for (size_t i = 0; i < n; i++)
+                len += format(batch[i], &buffer[len]);
+            ring.release(n);
+            written.fetch_add(n, std::memory_order_relaxed);
+
+            // Write when the buffer is nearly full or the ring has run dry
+            if (len && (buffer.size() - len < MaxLine || ring.size() == 0)) {
+                flush(len);
+                len = 0;
+                uint64_t now = monotonicNowNs();
+                if (sync == CANLogSync::EveryBatch ||
+                    (sync == CANLogSync::Interval && now - lastSync >= syncIntervalNs)) {
+                    fdatasync(fd);
+                    lastSync = now;
+                }
+            }
+            if (n == 0) {
+                if (last) break;
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+        }
+    }
+
+    void flush(size_t len) {
+        const char *p = buffer.data();
+        while (len) {
+            ssize_t w = write(fd, p, len);
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                perror("log write");
+                writeErrors++;
+                return;
+            }
+            p += w;
+            len -= w;
+            bytes.fetch_add(w, std::memory_order_relaxed);
+        }
+    }
+
+    CANRing<Record> ring;
+    Formatter format;
+    std::vector<char> buffer;
+    int fd = -1;
+    bool opened = false;
+    std::atomic<bool> stopping{false};
+    std::thread writer;
+};
+
+// Wall-clock time of monotonic timestamps, re-reading the clock offset at
+// most once a second so a stepped clock is followed without a syscall per
+// frame. One instance per thread.
+class CANWallClock {
+public:
+    int64_t toWall(uint64_t mono_ns) {
+        if (!offsetAt || mono_ns - offsetAt > 1000000000ull) {
+            offset = realtimeOffsetNs();
+            offsetAt = mono_ns;
+        }
+        return int64_t(mono_ns) + offset;
+    }
+
+private:
+    int64_t offset = 0;
+    uint64_t offsetAt = 0;
+};
+
+// As formatWallTime, for a monotonic (kernel RX) timestamp
+inline size_t formatLocalTime(uint64_t mono_ns, char *out, int digits = 3) {
+    thread_local CANWallClock clock;
+    return formatWallTime(clock.toWall(mono_ns), out, digits);
+}
+
+// Row of busload_log.csv and stress_test_log.csv, captured on the receive
+// thread of can-busload and can-stress-testing
+struct CANBusLogRecord {
+    uint64_t ts_ns;
+    can_frame frame;
+    uint64_t totalBits;     // bits seen this second when the frame arrived
+};
+
+inline constexpr const char *CAN_BUS_LOG_HEADER = "Timestamp,CAN_ID,DLC,PayloadBits,TotalBits,BusLoad,Data\n";
+
+// Bus load as a share of a 500 kbps bus
+inline size_t formatBusLog(const CANBusLogRecord &r, char *out) {
+    const can_frame &f = r.frame;
+    size_t len = formatLocalTime(r.ts_ns, out);
+    memcpy(out + len, ",0x", 3);
+    len += 3;
+    len += formatHex(f.can_id & CAN_SFF_MASK, out + len, false);
+    out[len++] = ',';
+    len += formatDec(int(f.can_dlc), out + len);
+    out[len++] = ',';
+    len += formatDec(f.can_dlc * 8, out + len);
+    out[len++] = ',';
+    len += formatDec(r.totalBits, out + len);
+    out[len++] = ',';
+    len += formatFixed(r.totalBits / 500000.0 * 100, 2, out + len);
+    out[len++] = ',';
+    len += formatBytes(f.data, std::min<int>(f.can_dlc, 8), out + len, ' ', false);
+    out[len++] = '\n';
+    return len;
+}
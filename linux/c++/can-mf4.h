@@ -0,0 +1,764 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "can-capture.h"
+#ifdef CAN_LOG_ZLIB
+#include <zlib.h>
+#endif
+
+// ASAM MDF 4.1 (.mf4) CAN bus logging: CAN_DataFrame, CAN_RemoteFrame and
+// CAN_ErrorFrame channel groups with the standard's channel names
+// (CAN_DataFrame.ID, .IDE, .DLC, .DataLength, .DataBytes, .BusChannel).
+//
+// The writer streams: records collect in a 1 MiB buffer per data group
+// that is written out as one DT block when full; on close the DT blocks
+// are chained with a DL block and cycle counts are patched in. Unsorted
+// files (the default) keep all three groups in one data group with
+// 1-byte record IDs; sorted files give each group its own data group.
+//
+// The reader takes both layouts from other tools too: DT/DL/HL data, DZ
+// blocks with -DCAN_LOG_ZLIB -lz, fixed or VLSD DataBytes, and linear
+// time conversions. Sorted data groups are merged by timestamp.
+
+namespace mf4 {
+
+constexpr size_t RECORD = 23;       // bytes per record, without record ID
+constexpr size_t FRAGMENT = 1 << 20;
+enum Kind { DATA, REMOTE, ERROR, KINDS };
+constexpr const char *KIND_NAMES[KINDS] = {"CAN_DataFrame", "CAN_RemoteFrame", "CAN_ErrorFrame"};
+
+// Record layout (byte offsets after the record ID)
+constexpr uint32_t AT_TIME = 0, AT_BUS = 8, AT_ID = 9, AT_DLC = 13, AT_LENGTH = 14, AT_DATA = 15;
+
+#pragma pack(push, 1)
+struct BlockHeader {
+    char id[4];                 // "##XX"
+    uint32_t reserved;
+    uint64_t length;            // whole block, including this header
+    uint64_t linkCount;
+};
+
+struct ChannelData {
+    uint8_t type;               // 0 fixed, 1 VLSD, 2 master, 3 virtual master
+    uint8_t syncType;           // 1 time
+    uint8_t dataType;           // 0/1 uint LE/BE, 2/3 int, 4/5 float, 10 bytes
+    uint8_t bitOffset;
+    uint32_t byteOffset;
+    uint32_t bitCount;
+    uint32_t flags;
+    uint32_t invalBitPos;
+    uint8_t precision;
+    uint8_t reserved;
+    uint16_t attachmentCount;
+    double range[6];            // value range, limits, extended limits
+};
+
+struct GroupData {
+    uint64_t recordId;
+    uint64_t cycleCount;
+    uint16_t flags;             // 1 VLSD group, 2 bus event
+    uint16_t pathSeparator;
+    uint32_t reserved;
+    uint32_t dataBytes;
+    uint32_t invalBytes;
+};
+
+struct ZipData {
+    char orgType[2];            // "DT", "SD"
+    uint8_t zipType;            // 0 deflate, 1 transpose + deflate
+    uint8_t reserved;
+    uint32_t zipParameter;      // columns for transpose
+    uint64_t orgLength;
+    uint64_t dataLength;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(BlockHeader) == 24 && sizeof(ChannelData) == 72 && sizeof(GroupData) == 32,
+              "MDF 4.1 block layouts");
+
+// Append a block with zeroed links to out; returns its offset in out
+inline uint64_t appendBlock(std::vector<char> &out, const char *id, size_t links, const void *data, size_t len) {
+    uint64_t at = out.size();
+    size_t padded = (len + 7) & ~size_t(7);
+    BlockHeader h{};
+    memcpy(h.id, id, 4);
+    h.length = sizeof(h) + 8 * links + padded;
+    h.linkCount = links;
+    out.resize(at + h.length);
+    memcpy(&out[at], &h, sizeof(h));
+    if (len) memcpy(&out[at + sizeof(h) + 8 * links], data, len);
+    return at;
+}
+
+inline void setLink(std::vector<char> &out, uint64_t block, int i, uint64_t target) {
+    memcpy(&out[block + sizeof(BlockHeader) + 8 * i], &target, 8);
+}
+
+} // namespace mf4
+
+class MF4Writer {
+public:
+    MF4Writer(const char *path, int64_t startNs, bool sortedGroups = false)
+        : start(startNs), sorted(sortedGroups) {
+        file = fopen(path, "wb");
+        if (!file) { perror(path); return; }
+        buildHeader();
+        if (fwrite(meta.data(), 1, meta.size(), file) != meta.size()) failed = true;
+        pos = meta.size();
+        for (int i = 0; i < (sorted ? mf4::KINDS : 1); i++)
+            streams[i].buf.reserve(mf4::FRAGMENT + mf4::RECORD + 1);
+    }
+
+    ~MF4Writer() { close(); }
+
+    MF4Writer(const MF4Writer &) = delete;
+    MF4Writer &operator=(const MF4Writer &) = delete;
+
+    bool write(const CANCaptureRecord &r) {
+        if (!file) return false;
+        int kind = r.flags & CAN_CAPTURE_ERROR ? mf4::ERROR : r.flags & CAN_CAPTURE_RTR ? mf4::REMOTE : mf4::DATA;
+        Stream &s = streams[sorted ? kind : 0];
+        size_t at = s.buf.size();
+        s.buf.resize(at + mf4::RECORD + (sorted ? 0 : 1));
+        char *rec = &s.buf[at];
+        if (!sorted) *rec++ = kind + 1;
+
+        double t = (r.ts_ns - start) / 1e9;
+        uint32_t id = r.id | (r.flags & CAN_CAPTURE_EXTENDED ? 0x80000000u : 0);      // IDE is bit 31
+        memcpy(rec + mf4::AT_TIME, &t, 8);
+        rec[mf4::AT_BUS] = r.bus + 1;
+        memcpy(rec + mf4::AT_ID, &id, 4);
+        rec[mf4::AT_DLC] = r.dlc;
+        rec[mf4::AT_LENGTH] = r.flags & CAN_CAPTURE_RTR ? 0 : r.dlc;
+        memcpy(rec + mf4::AT_DATA, r.data, 8);
+        cycles[kind]++;
+
+        if (s.buf.size() >= mf4::FRAGMENT) flushFragment(s);
+        return !failed;
+    }
+
+    bool close() {
+        if (!file) return false;
+        for (int i = 0; i < (sorted ? mf4::KINDS : 1); i++) {
+            Stream &s = streams[i];
+            if (!s.buf.empty() || s.fragments.empty()) flushFragment(s);
+            uint64_t data = s.fragments.size() == 1 ? s.fragments[0] : writeList(s);
+            patch(s.group + sizeof(mf4::BlockHeader) + 2 * 8, data);        // dg_data
+        }
+        for (int k = 0; k < mf4::KINDS; k++)
+            patch(channelGroups[k] + sizeof(mf4::BlockHeader) + 6 * 8 + 8, cycles[k]);     // cg_cycle_count
+        bool ok = !failed && fclose(file) == 0;
+        file = nullptr;
+        return ok;
+    }
+
+    bool ok() const { return file != nullptr; }
+    uint64_t frames(int kind) const { return cycles[kind]; }
+
+private:
+    struct Stream {
+        uint64_t group = 0;             // DG block offset
+        std::vector<char> buf;
+        std::vector<uint64_t> fragments;        // DT block offsets
+        std::vector<uint64_t> lengths;          // and their data lengths
+    };
+
+    uint64_t text(const char *id, const std::string &s) {
+        return mf4::appendBlock(meta, id, 0, s.c_str(), s.size() + 1);
+    }
+
+    uint64_t channel(const std::string &name, uint8_t type, uint8_t dataType, uint32_t byteOffset,
+                     uint8_t bitOffset, uint32_t bitCount) {
+        mf4::ChannelData d{};
+        d.type = type;
+        d.syncType = type == 2 ? 1 : 0;
+        d.dataType = dataType;
+        d.bitOffset = bitOffset;
+        d.byteOffset = byteOffset;
+        d.bitCount = bitCount;
+        uint64_t cn = mf4::appendBlock(meta, "##CN", 8, &d, sizeof(d));
+        uint64_t tx = text("##TX", name);
+        mf4::setLink(meta, cn, 2, tx);
+        return cn;
+    }
+
+    void buildHeader() {
+        meta.resize(64);
+        memcpy(&meta[0], "MDF     4.10    can-mf4 ", 24);
+        uint16_t version = 410;
+        memcpy(&meta[28], &version, 2);
+
+        char hd[32] = {};
+        memcpy(hd, &start, 8);          // hd_start_time_ns, UTC
+        uint64_t hdAt = mf4::appendBlock(meta, "##HD", 6, hd, sizeof(hd));
+
+        char fh[16] = {};
+        int64_t now = CANWallClock().toWall(monotonicNowNs());
+        memcpy(fh, &now, 8);
+        uint64_t fhAt = mf4::appendBlock(meta, "##FH", 2, fh, sizeof(fh));
+        mf4::setLink(meta, hdAt, 1, fhAt);
+        mf4::setLink(meta, fhAt, 1, text("##MD", "<FHcomment><TX>CAN bus log</TX><tool_id>can-mf4</tool_id>"
+                                                 "<tool_vendor>can-tools</tool_vendor><tool_version>1.0</tool_version>"
+                                                 "</FHcomment>"));
+
+        uint8_t si[8] = {2, 2};         // source type bus, bus type CAN
+        uint64_t siAt = mf4::appendBlock(meta, "##SI", 3, si, sizeof(si));
+        mf4::setLink(meta, siAt, 0, text("##TX", "CAN"));
+
+        uint64_t prevGroup = 0, prevChannelGroup = 0;
+        for (int k = 0; k < mf4::KINDS; k++) {
+            if (sorted || k == 0) {
+                uint8_t dg[8] = {uint8_t(sorted ? 0 : 1)};      // record ID size
+                uint64_t dgAt = mf4::appendBlock(meta, "##DG", 4, dg, sizeof(dg));
+                mf4::setLink(meta, prevGroup ? prevGroup : hdAt, 0, dgAt);
+                streams[k].group = prevGroup = dgAt;
+                prevChannelGroup = 0;
+            }
+
+            mf4::GroupData g{};
+            g.recordId = k + 1;
+            g.flags = 2;                // bus event
+            g.pathSeparator = '.';
+            g.dataBytes = mf4::RECORD;
+            uint64_t cg = mf4::appendBlock(meta, "##CG", 6, &g, sizeof(g));
+            mf4::setLink(meta, prevChannelGroup ? prevChannelGroup : prevGroup, prevChannelGroup ? 0 : 1, cg);
+            mf4::setLink(meta, cg, 2, text("##TX", mf4::KIND_NAMES[k]));
+            mf4::setLink(meta, cg, 3, siAt);
+            channelGroups[k] = prevChannelGroup = cg;
+
+            // Master time channel, then the composed frame channel and its parts
+            uint64_t time = channel("Timestamp", 2, 4, mf4::AT_TIME, 0, 64);
+            mf4::setLink(meta, time, 6, text("##TX", "s"));
+            mf4::setLink(meta, cg, 1, time);
+
+            std::string base = mf4::KIND_NAMES[k];
+            uint32_t bytes = k == mf4::DATA ? mf4::AT_DATA + 8 - mf4::AT_BUS
+                           : k == mf4::REMOTE ? mf4::AT_LENGTH + 1 - mf4::AT_BUS : mf4::AT_DLC + 1 - mf4::AT_BUS;
+            uint64_t frame = channel(base, 0, 10, mf4::AT_BUS, 0, bytes * 8);
+            mf4::setLink(meta, time, 0, frame);
+
+            std::vector<uint64_t> parts = {
+                channel(base + ".BusChannel", 0, 0, mf4::AT_BUS, 0, 8),
+                channel(base + ".ID", 0, 0, mf4::AT_ID, 0, 29),
+                channel(base + ".IDE", 0, 0, mf4::AT_ID + 3, 7, 1),
+                channel(base + ".DLC", 0, 0, mf4::AT_DLC, 0, 4),
+            };
+            if (k != mf4::ERROR) parts.push_back(channel(base + ".DataLength", 0, 0, mf4::AT_LENGTH, 0, 8));
+            if (k == mf4::DATA) parts.push_back(channel(base + ".DataBytes", 0, 10, mf4::AT_DATA, 0, 64));
+            mf4::setLink(meta, frame, 1, parts[0]);         // composition
+            for (size_t i = 1; i < parts.size(); i++)
+                mf4::setLink(meta, parts[i - 1], 0, parts[i]);
+        }
+    }
+
+    void flushFragment(Stream &s) {
+        mf4::BlockHeader h{{'#', '#', 'D', 'T'}, 0, sizeof(h) + s.buf.size(), 0};
+        static const char pad[8] = {};
+        size_t padding = (8 - s.buf.size() % 8) % 8;
+        if (fwrite(&h, sizeof(h), 1, file) != 1 || fwrite(s.buf.data(), 1, s.buf.size(), file) != s.buf.size() ||
+            fwrite(pad, 1, padding, file) != padding)
+            failed = true;
+        s.fragments.push_back(pos);
+        s.lengths.push_back(s.buf.size());
+        pos += sizeof(h) + s.buf.size() + padding;
+        s.buf.clear();
+    }
+
+    // DL block listing the stream's DT blocks
+    uint64_t writeList(Stream &s) {
+        size_t n = s.fragments.size();
+        std::vector<char> data(8 + 8 * n);
+        uint32_t count = n;
+        memcpy(&data[4], &count, 4);
+        uint64_t offset = 0;
+        for (size_t i = 0; i < n; i++) {
+            memcpy(&data[8 + 8 * i], &offset, 8);
+            offset += s.lengths[i];
+        }
+        std::vector<char> dl;
+        mf4::appendBlock(dl, "##DL", 1 + n, data.data(), data.size());
+        for (size_t i = 0; i < n; i++)
+            mf4::setLink(dl, 0, 1 + i, s.fragments[i]);
+        uint64_t at = pos;
+        if (fwrite(dl.data(), 1, dl.size(), file) != dl.size()) failed = true;
+        pos += dl.size();
+        return at;
+    }
+
+    void patch(uint64_t at, uint64_t value) {
+        if (fseek(file, at, SEEK_SET) != 0 || fwrite(&value, 8, 1, file) != 1) failed = true;
+        fseek(file, 0, SEEK_END);
+    }
+
+    FILE *file = nullptr;
+    int64_t start;
+    bool sorted;
+    std::vector<char> meta;
+    Stream streams[mf4::KINDS];
+    uint64_t channelGroups[mf4::KINDS] = {};
+    uint64_t cycles[mf4::KINDS] = {};
+    uint64_t pos = 0;
+    bool failed = false;
+};
+
+class MF4Reader {
+public:
+    explicit MF4Reader(const char *path) {
+        fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) { perror(path); return; }
+        char id[64];
+        uint16_t version = 0;
+        if (pread(fd, id, sizeof(id), 0) != sizeof(id) || memcmp(id, "MDF     ", 8) != 0 ||
+            (memcpy(&version, id + 28, 2), version < 400)) {
+            fprintf(stderr, "%s: not an MDF 4 file\n", path);
+            ::close(fd);
+            fd = -1;
+            return;
+        }
+        Block hd;
+        if (!readBlock(64, hd) || hd.data.size() < 16) { error("no HD block"); return; }
+        readHeaderTime(hd);
+        for (uint64_t dg = hd.links[0]; dg && ok(); ) {
+            Block b;
+            if (!readBlock(dg, b, "##DG")) break;
+            addDataGroup(b);
+            dg = b.links[0];
+        }
+    }
+
+    ~MF4Reader() { if (fd >= 0) ::close(fd); }
+
+    MF4Reader(const MF4Reader &) = delete;
+    MF4Reader &operator=(const MF4Reader &) = delete;
+
+    bool ok() const { return fd >= 0; }
+    int64_t startNs() const { return start; }
+    uint64_t skipped = 0;       // records of non-CAN groups
+
+    // Call f(const CANCaptureRecord &) for every CAN frame, in time order
+    // across data groups
+    template <typename F>
+    void forEach(F &&f) {
+        std::vector<CANCaptureRecord> head(cursors.size());
+        std::vector<bool> live(cursors.size());
+        for (size_t i = 0; i < cursors.size(); i++) live[i] = next(*cursors[i], head[i]);
+        while (true) {
+            int best = -1;
+            for (size_t i = 0; i < cursors.size(); i++)
+                if (live[i] && (best < 0 || head[i].ts_ns < head[best].ts_ns)) best = i;
+            if (best < 0) break;
+            f(head[best]);
+            live[best] = next(*cursors[best], head[best]);
+        }
+    }
+
+private:
+    struct Block {
+        char id[4];
+        std::vector<uint64_t> links;
+        std::vector<char> data;
+        uint64_t at = 0;
+        uint64_t length = 0;
+    };
+
+    struct Channel {
+        bool valid = false;
+        uint8_t type = 0, dataType = 0, bitOffset = 0;
+        uint32_t byteOffset = 0, bitCount = 0;
+        uint64_t dataLink = 0;
+    };
+
+    // A contiguous piece of a data stream: plain (DT/SD) or zipped (DZ)
+    struct Fragment {
+        uint64_t at;            // data start, or the DZ block
+        uint64_t length;        // bytes after unpacking
+        bool zipped;
+    };
+
+    struct Group {
+        int kind = -1;          // mf4::Kind, -1 for non-CAN groups
+        uint64_t recordId = 0;
+        uint32_t size = 0;      // data + invalidation bytes
+        bool vlsd = false;      // a VLSD group: records are length + bytes
+        double a = 0, b = 1;    // time = a + b * raw
+        Channel time, id, ide, dlc, length, bytes, bus;
+        std::vector<Fragment> sd;       // DataBytes SD stream, for VLSD DataBytes
+        uint64_t vlsdGroup = 0;         // DataBytes VLSD group (unsorted)
+        uint64_t vlsdGroupId = 0;
+    };
+
+    // Sequential reader over a data group's fragments
+    struct Stream {
+        std::vector<Fragment> fragments;
+        size_t index = 0;
+        uint64_t done = 0;      // bytes of the current fragment consumed
+        std::vector<char> chunk;
+        size_t pos = 0;
+    };
+
+    struct VLSDPayload {
+        uint64_t offset = UINT64_MAX;
+        std::vector<char> bytes;
+        uint64_t running = 0;
+    };
+
+    struct Cursor {
+        uint8_t recIdSize = 0;
+        std::vector<Group> groups;
+        Stream stream;
+        std::vector<char> rec;
+        std::unordered_map<uint64_t, VLSDPayload> vlsd;     // by VLSD group record ID
+    };
+
+    void error(const char *what) {
+        fprintf(stderr, "MF4: %s\n", what);
+        ::close(fd);
+        fd = -1;
+    }
+
+    bool readBlock(uint64_t at, Block &b, const char *expect = nullptr) {
+        mf4::BlockHeader h;
+        if (!at || pread(fd, &h, sizeof(h), at) != sizeof(h) || h.id[0] != '#' || h.id[1] != '#' ||
+            h.length < sizeof(h) + 8 * h.linkCount || h.length > (64u << 20)) {
+            error("bad block link");
+            return false;
+        }
+        if (expect && memcmp(h.id, expect, 4) != 0) return false;
+        memcpy(b.id, h.id, 4);
+        b.at = at;
+        b.length = h.length;
+        b.links.resize(h.linkCount);
+        b.data.resize(h.length - sizeof(h) - 8 * h.linkCount);
+        size_t linkBytes = 8 * h.linkCount;
+        if ((linkBytes && pread(fd, b.links.data(), linkBytes, at + sizeof(h)) != ssize_t(linkBytes)) ||
+            (b.data.size() && pread(fd, b.data.data(), b.data.size(), at + sizeof(h) + linkBytes) != ssize_t(b.data.size()))) {
+            error("truncated block");
+            return false;
+        }
+        return true;
+    }
+
+    // Header of a DT/SD/DZ block without its (possibly huge) data
+    bool readHeader(uint64_t at, mf4::BlockHeader &h) {
+        return at && pread(fd, &h, sizeof(h), at) == sizeof(h);
+    }
+
+    std::string readText(uint64_t at) {
+        Block b;
+        if (!at || !readBlock(at, b)) return "";
+        return std::string(b.data.data(), strnlen(b.data.data(), b.data.size()));
+    }
+
+    void readHeaderTime(const Block &hd) {
+        uint64_t t;
+        memcpy(&t, &hd.data[0], 8);
+        uint8_t flags = hd.data[12];
+        start = t;
+        // Bit 1: UTC, with tz/dst offsets that only describe local display
+        // time. Bit 0 without it: the time itself is local.
+        if (!(flags & 2) && (flags & 1)) {
+            time_t sec = t / 1000000000;
+            tm local;
+            localtime_r(&sec, &local);
+            start -= int64_t(local.tm_gmtoff) * 1000000000;
+        }
+    }
+
+    // Flatten a data link (DT, SD, DZ, DL chain, HL) into fragments
+    void collect(uint64_t link, std::vector<Fragment> &out) {
+        mf4::BlockHeader h;
+        if (!readHeader(link, h)) return;
+        if (!memcmp(h.id, "##DT", 4) || !memcmp(h.id, "##SD", 4) || !memcmp(h.id, "##RD", 4)) {
+            out.push_back({link + sizeof(h) + 8 * h.linkCount, h.length - sizeof(h) - 8 * h.linkCount, false});
+        } else if (!memcmp(h.id, "##DZ", 4)) {
+            mf4::ZipData z;
+            if (pread(fd, &z, sizeof(z), link + sizeof(h)) == sizeof(z)) out.push_back({link, z.orgLength, true});
+        } else if (!memcmp(h.id, "##HL", 4)) {
+            Block b;
+            if (readBlock(link, b)) collect(b.links[0], out);
+        } else if (!memcmp(h.id, "##DL", 4)) {
+            for (uint64_t dl = link; dl; ) {
+                Block b;
+                if (!readBlock(dl, b, "##DL")) break;
+                for (size_t i = 1; i < b.links.size(); i++) collect(b.links[i], out);
+                dl = b.links[0];
+            }
+        }
+    }
+
+    void addDataGroup(const Block &dg) {
+        auto c = std::make_unique<Cursor>();
+        c->recIdSize = dg.data.empty() ? 0 : dg.data[0];
+        bool any = false;
+        for (uint64_t cg = dg.links[1]; cg && ok(); ) {
+            Block b;
+            if (!readBlock(cg, b, "##CG") || b.data.size() < sizeof(mf4::GroupData)) break;
+            mf4::GroupData gd;
+            memcpy(&gd, b.data.data(), sizeof(gd));
+            Group g;
+            g.recordId = gd.recordId;
+            g.size = gd.dataBytes + gd.invalBytes;
+            g.vlsd = gd.flags & 1;
+            if (!g.vlsd) readChannels(b.links[1], g);
+            // Frame type from the group's acquisition name, else its channel names
+            std::string acq = readText(b.links[2]);
+            for (int k = 0; k < mf4::KINDS; k++)
+                if (acq == mf4::KIND_NAMES[k]) g.kind = k;
+            if (g.kind >= 0 && !(g.time.valid && g.id.valid)) g.kind = -1;
+            any = any || g.kind >= 0;
+            c->groups.push_back(std::move(g));
+            cg = b.links[0];
+        }
+        if (!any || !ok()) return;
+
+        // VLSD DataBytes: an SD stream, or a VLSD group in the same data group
+        for (Group &g : c->groups) {
+            if (!g.bytes.valid || g.bytes.type != 1) continue;
+            mf4::BlockHeader h;
+            if (!readHeader(g.bytes.dataLink, h)) continue;
+            if (!memcmp(h.id, "##CG", 4)) {
+                Block b;
+                if (readBlock(g.bytes.dataLink, b)) memcpy(&g.vlsdGroupId, b.data.data(), 8);
+                g.vlsdGroup = g.bytes.dataLink;
+            } else {
+                collect(g.bytes.dataLink, g.sd);
+            }
+        }
+        collect(dg.links[2], c->stream.fragments);
+        cursors.push_back(std::move(c));
+    }
+
+    void readChannels(uint64_t cn, Group &g) {
+        for (int guard = 0; cn && guard < 1024 && ok(); guard++) {
+            Block b;
+            if (!readBlock(cn, b, "##CN") || b.data.size() < 12) return;
+            Channel ch;
+            ch.valid = true;
+            ch.type = b.data[0];
+            ch.dataType = b.data[2];
+            ch.bitOffset = b.data[3];
+            memcpy(&ch.byteOffset, &b.data[4], 4);
+            memcpy(&ch.bitCount, &b.data[8], 4);
+            ch.dataLink = b.links[5];
+
+            std::string name = readText(b.links[2]);
+            std::string leaf = name.substr(name.find_last_of('.') + 1);
+            for (int k = 0; k < mf4::KINDS; k++)
+                if (name.compare(0, strlen(mf4::KIND_NAMES[k]), mf4::KIND_NAMES[k]) == 0) g.kind = k;
+            uint8_t sync = b.data[1];
+            if ((ch.type == 2 || ch.type == 3) && sync == 1) {
+                g.time = ch;
+                readConversion(b.links[4], g);
+            } else if (leaf == "ID") g.id = ch;
+            else if (leaf == "IDE") g.ide = ch;
+            else if (leaf == "DLC") g.dlc = ch;
+            else if (leaf == "DataLength") g.length = ch;
+            else if (leaf == "DataBytes") g.bytes = ch;
+            else if (leaf == "BusChannel") g.bus = ch;
+
+            // Composed channels (CAN_DataFrame) hold the fields as children
+            if (b.links[1]) {
+                mf4::BlockHeader h;
+                if (readHeader(b.links[1], h) && !memcmp(h.id, "##CN", 4)) readChannels(b.links[1], g);
+            }
+            cn = b.links[0];
+        }
+    }
+
+    void readConversion(uint64_t cc, Group &g) {
+        Block b;
+        if (!cc || !readBlock(cc, b, "##CC") || b.data.size() < 40) return;
+        if (b.data[0] != 1) return;     // only linear: a + b * x
+        memcpy(&g.a, &b.data[24], 8);
+        memcpy(&g.b, &b.data[32], 8);
+    }
+
+    bool refill(Stream &s) {
+        while (s.index < s.fragments.size()) {
+            const Fragment &f = s.fragments[s.index];
+            if (s.done >= f.length) {
+                s.index++;
+                s.done = 0;
+                continue;
+            }
+            if (f.zipped) {
+                if (!unzip(f, s.chunk)) { s.index++; continue; }
+                s.done = f.length;
+            } else {
+                size_t n = std::min<uint64_t>(f.length - s.done, 1 << 20);
+                s.chunk.resize(n);
+                if (pread(fd, s.chunk.data(), n, f.at + s.done) != ssize_t(n)) return false;
+                s.done += n;
+            }
+            s.pos = 0;
+            return true;
+        }
+        return false;
+    }
+
+    bool read(Stream &s, void *dst, size_t n) {
+        char *out = (char *)dst;
+        while (n) {
+            if (s.pos == s.chunk.size() && !refill(s)) return false;
+            size_t k = std::min(n, s.chunk.size() - s.pos);
+            memcpy(out, &s.chunk[s.pos], k);
+            s.pos += k;
+            out += k;
+            n -= k;
+        }
+        return true;
+    }
+
+    bool unzip(const Fragment &f, std::vector<char> &out) {
+#ifdef CAN_LOG_ZLIB
+        mf4::BlockHeader h;
+        mf4::ZipData z;
+        if (!readHeader(f.at, h) || pread(fd, &z, sizeof(z), f.at + sizeof(h)) != sizeof(z)) return false;
+        std::vector<char> packed(z.dataLength);
+        if (pread(fd, packed.data(), packed.size(), f.at + sizeof(h) + sizeof(z)) != ssize_t(packed.size()))
+            return false;
+        out.resize(z.orgLength);
+        uLongf len = out.size();
+        if (uncompress((Bytef *)out.data(), &len, (const Bytef *)packed.data(), packed.size()) != Z_OK) return false;
+        out.resize(len);
+        if (z.zipType == 1 && z.zipParameter) {
+            // Transposed: columns of zipParameter-byte records, remainder untouched
+            size_t cols = z.zipParameter, rows = out.size() / cols;
+            std::vector<char> t(out.begin(), out.begin() + rows * cols);
+            for (size_t c = 0; c < cols; c++)
+                for (size_t r = 0; r < rows; r++) out[r * cols + c] = t[c * rows + r];
+        }
+        return true;
+#else
+        (void)f;
+        (void)out;
+        if (!warnedZip) fprintf(stderr, "MF4: compressed data blocks need -DCAN_LOG_ZLIB\n");
+        warnedZip = true;
+        return false;
+#endif
+    }
+
+    static uint64_t raw(const std::vector<char> &rec, const Channel &ch) {
+        uint8_t b[9] = {};
+        size_t bytes = std::min<size_t>((ch.bitOffset + ch.bitCount + 7) / 8, 9);
+        if (ch.byteOffset >= rec.size()) return 0;
+        bytes = std::min<size_t>(bytes, rec.size() - ch.byteOffset);
+        memcpy(b, &rec[ch.byteOffset], bytes);
+        if (ch.dataType == 1 || ch.dataType == 3) std::reverse(b, b + bytes);      // big-endian
+        uint64_t v;
+        memcpy(&v, b, 8);
+        v >>= ch.bitOffset;
+        if (ch.bitOffset + ch.bitCount > 64) v |= uint64_t(b[8]) << (64 - ch.bitOffset);
+        return ch.bitCount >= 64 ? v : v & ((1ull << ch.bitCount) - 1);
+    }
+
+    static double number(const std::vector<char> &rec, const Channel &ch) {
+        if (ch.dataType == 4 || ch.dataType == 5) {
+            uint64_t v = raw(rec, ch);
+            if (ch.bitCount == 32) {
+                uint32_t u = v;
+                float f;
+                memcpy(&f, &u, 4);
+                return f;
+            }
+            double d;
+            memcpy(&d, &v, 8);
+            return d;
+        }
+        return double(raw(rec, ch));
+    }
+
+    // Bytes at offset in an SD stream: 4-byte length, then the data
+    bool sdBytes(const std::vector<Fragment> &sd, uint64_t offset, uint8_t *data, uint8_t &len) {
+        for (const Fragment &f : sd) {
+            if (offset >= f.length) { offset -= f.length; continue; }
+            uint32_t n;
+            if (f.zipped || pread(fd, &n, 4, f.at + offset) != 4) return false;
+            len = std::min<uint32_t>(n, 8);
+            return pread(fd, data, len, f.at + offset + 4) == len;
+        }
+        return false;
+    }
+
+    bool next(Cursor &c, CANCaptureRecord &r) {
+        while (true) {
+            const Group *g = nullptr;
+            if (c.recIdSize) {
+                uint64_t rid = 0;
+                if (!read(c.stream, &rid, c.recIdSize)) return false;
+                for (const Group &x : c.groups)
+                    if (x.recordId == rid) g = &x;
+                if (!g) return false;           // unknown record ID: cannot resync
+            } else {
+                if (c.groups.empty()) return false;
+                g = &c.groups[0];
+            }
+
+            if (g->vlsd) {
+                uint32_t n;
+                if (!read(c.stream, &n, 4)) return false;
+                VLSDPayload &p = c.vlsd[g->recordId];
+                p.bytes.resize(n);
+                if (!read(c.stream, p.bytes.data(), n)) return false;
+                p.offset = p.running;
+                p.running += 4 + n;
+                continue;
+            }
+
+            c.rec.resize(g->size);
+            if (!read(c.stream, c.rec.data(), g->size)) return false;
+            if (g->kind < 0) {
+                skipped++;
+                continue;
+            }
+            decode(c, *g, r);
+            return true;
+        }
+    }
+
+    void decode(Cursor &c, const Group &g, CANCaptureRecord &r) {
+        r = CANCaptureRecord{};
+        double t = g.a + g.b * number(c.rec, g.time);
+        r.ts_ns = start + llround(t * 1e9);
+        uint64_t id = raw(c.rec, g.id);
+        bool extended = g.ide.valid ? raw(c.rec, g.ide) : (id & 0x80000000u) || id > CAN_SFF_MASK;
+        r.id = id & (extended ? CAN_EFF_MASK : CAN_SFF_MASK);
+        r.flags = (extended ? CAN_CAPTURE_EXTENDED : 0) | (g.kind == mf4::REMOTE ? CAN_CAPTURE_RTR : 0) |
+                  (g.kind == mf4::ERROR ? CAN_CAPTURE_ERROR : 0);
+        uint64_t bus = g.bus.valid ? raw(c.rec, g.bus) : 1;
+        r.bus = bus ? bus - 1 : 0;
+        r.dlc = g.dlc.valid ? std::min<uint64_t>(raw(c.rec, g.dlc), 8) : 0;
+        if (!g.bytes.valid || g.kind != mf4::DATA) return;
+
+        uint8_t len = g.length.valid ? std::min<uint64_t>(raw(c.rec, g.length), 8) : r.dlc;
+        if (g.bytes.type == 1) {
+            uint64_t offset = raw(c.rec, g.bytes);
+            if (g.vlsdGroup) {
+                const VLSDPayload &p = c.vlsd[g.vlsdGroupId];
+                if (p.offset == offset) memcpy(r.data, p.bytes.data(), std::min<size_t>(len, p.bytes.size()));
+            } else {
+                sdBytes(g.sd, offset, r.data, len);
+            }
+        } else if (g.bytes.byteOffset < c.rec.size()) {
+            size_t avail = std::min<size_t>(g.bytes.bitCount / 8, c.rec.size() - g.bytes.byteOffset);
+            memcpy(r.data, &c.rec[g.bytes.byteOffset], std::min<size_t>(len, avail));
+        }
+        if (!g.dlc.valid) r.dlc = len;
+    }
+
+    int fd = -1;
+    int64_t start = 0;
+    std::vector<std::unique_ptr<Cursor>> cursors;
+    bool warnedZip = false;
+};
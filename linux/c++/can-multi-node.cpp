@@ -14,23 +14,13 @@
 #include <sys/socket.h>
 #include <linux/can.h>
 #include <linux/can/raw.h>
+#include "can-rx.h"
+#include "can-dbc.h"
+#include "can-dbc-cache.h"
+#include "can-dbc-encode.h"
 
 using namespace std;
 
-struct Signal {
-    string name;
-    int start_bit;
-    int length;
-    float scale;
-    float offset;
-    string unit;
-};
-
-struct CANMessageDef {
-    string name;
-    vector<Signal> signals;
-};
-
 // DBC
 map<unsigned int, CANMessageDef> dbc_map = {
     {0x100, {"EngineECU", {
@@ -41,63 +31,11 @@ map<unsigned int, CANMessageDef> dbc_map = {
     {0x200, {"SensorCluster", {
         {"FuelLevel", 0, 16, 0.1, 0.0, "%"},
         {"CoolantPressure", 16, 16, 0.1, 0.0, "bar"}
-    }}}
+    }, 4}}
 };
 
-void encodeEngineECU(can_frame &frame, float temp, float volt, int rpm) {
-    frame.can_id = 0x100;
-    frame.can_dlc = 8;
-    memset(frame.data, 0, 8);
-
-    int16_t temp_raw = static_cast<int16_t>((temp - 0.0f) / 0.01f);
-    int16_t volt_raw = static_cast<int16_t>((volt - 0.0f) / 0.01f);
-    int32_t rpm_raw  = static_cast<int32_t>(rpm);
-
-    frame.data[0] = temp_raw & 0xFF;
-    frame.data[1] = (temp_raw >> 8) & 0xFF;
-    frame.data[2] = volt_raw & 0xFF;
-    frame.data[3] = (volt_raw >> 8) & 0xFF;
-    frame.data[4] = rpm_raw & 0xFF;
-    frame.data[5] = (rpm_raw >> 8) & 0xFF;
-    frame.data[6] = (rpm_raw >> 16) & 0xFF;
-    frame.data[7] = (rpm_raw >> 24) & 0xFF;
-}
-
-void encodeSensorCluster(can_frame &frame, float fuel, float coolant) {
-    frame.can_id = 0x200;
-    frame.can_dlc = 4;
-    memset(frame.data, 0, 4);
-
-    int16_t fuel_raw = static_cast<int16_t>(fuel / 0.1f);
-    int16_t coolant_raw = static_cast<int16_t>(coolant / 0.1f);
-
-    frame.data[0] = fuel_raw & 0xFF;
-    frame.data[1] = (fuel_raw >> 8) & 0xFF;
-    frame.data[2] = coolant_raw & 0xFF;
-    frame.data[3] = (coolant_raw >> 8) & 0xFF;
-}
-
-map<string, float> decodeFrame(const can_frame &frame) {
-    map<string, float> result;
-    unsigned int can_id = frame.can_id & CAN_SFF_MASK;
-
-    if (dbc_map.find(can_id) == dbc_map.end())
-        return result;
-
-    auto msgDef = dbc_map[can_id];
-
-    for (auto &sig : msgDef.signals) {
-        unsigned long raw_val = 0;
-        int byte_start = sig.start_bit / 8;
-        int byte_len = sig.length / 8;
-        for (int i = 0; i < byte_len; i++)
-            raw_val |= ((unsigned long)frame.data[byte_start + i] << (8 * i));
-        float physical = raw_val * sig.scale + sig.offset;
-        result[sig.name] = physical;
-    }
-
-    return result;
-}
+// Compiled once at startup; encoding and decoding never touch dbc_map
+CANDecodeTable dbc_table(dbc_map);
 
 // Generic CAN Socket Setup
 int setupCAN(const char *ifname) {
@@ -126,7 +64,16 @@ int setupCAN(const char *ifname) {
 // Engine ECU Sender
 void engineECUThread(const char *ifname) {
     int s = setupCAN(ifname);
-    can_frame frame{};
+    CANEncoder encoder(dbc_table);
+    const CANMessageDesc *engineData = dbc_table.find(0x100);
+    const int engineTemp = dbc_table.signalHandle("EngineTemp");
+    const int batteryVolt = dbc_table.signalHandle("BatteryVolt");
+    const int engineRpm = dbc_table.signalHandle("RPM");
+    if (!engineData || engineTemp < 0 || batteryVolt < 0 || engineRpm < 0) {
+        cerr << "[EngineECU] DBC has no 0x100 with EngineTemp/BatteryVolt/RPM\n";
+        close(s);
+        return;
+    }
     srand(time(0));
 
     while (true) {
@@ -134,7 +81,10 @@ void engineECUThread(const char *ifname) {
         float volt = 12.0f + (rand() % 100) / 10.0f;  // 12-22 V
         int rpm = 800 + (rand() % 6000);              // 800-6800 rpm
 
-        encodeEngineECU(frame, temp, volt, rpm);
+        encoder.set(engineTemp, temp);
+        encoder.set(batteryVolt, volt);
+        encoder.set(engineRpm, rpm);
+        const can_frame &frame = encoder.frame(*engineData);
         write(s, &frame, sizeof(frame));
 
         this_thread::sleep_for(chrono::seconds(1));
@@ -145,14 +95,24 @@ void engineECUThread(const char *ifname) {
 // Sensor Cluster Sender
 void sensorClusterThread(const char *ifname) {
     int s = setupCAN(ifname);
-    can_frame frame{};
+    CANEncoder encoder(dbc_table);
+    const CANMessageDesc *sensorCluster = dbc_table.find(0x200);
+    const int fuelLevel = dbc_table.signalHandle("FuelLevel", "SensorCluster");
+    const int coolantPressure = dbc_table.signalHandle("CoolantPressure");
+    if (!sensorCluster || fuelLevel < 0 || coolantPressure < 0) {
+        cerr << "[SensorCluster] DBC has no 0x200 with FuelLevel/CoolantPressure\n";
+        close(s);
+        return;
+    }
     srand(time(0));
 
     while (true) {
         float fuel = 10 + (rand() % 900) / 10.0f;         // 10-100 %
         float coolant = 1 + (rand() % 100) / 10.0f;       // 1-11 bar
 
-        encodeSensorCluster(frame, fuel, coolant);
+        encoder.set(fuelLevel, fuel);
+        encoder.set(coolantPressure, coolant);
+        const can_frame &frame = encoder.frame(*sensorCluster);
         write(s, &frame, sizeof(frame));
 
         this_thread::sleep_for(chrono::seconds(1));
@@ -163,30 +123,50 @@ void sensorClusterThread(const char *ifname) {
 // Dashboard Receiver
 void dashboardThread(const char *ifname) {
     int s = setupCAN(ifname);
-    can_frame frame{};
+    CANReceiver rx(s);
     cout << "[Dashboard] Listening on " << ifname << "...\n";
 
+    // Decoded values, indexed by signal handle
+    vector<float> values(dbc_table.signalCount());
+
     while (true) {
-        int nbytes = read(s, &frame, sizeof(frame));
-        if (nbytes < 0) {
+        int n = rx.receive();
+        if (n < 0) {
             perror("Read");
             break;
         }
 
-        auto decoded = decodeFrame(frame);
-        if (!decoded.empty()) {
-            cout << "Message ID: 0x" << hex << frame.can_id << dec << " | ";
-            for (auto &[name, val] : decoded)
-                cout << name << "=" << fixed << setprecision(2) << val << " ";
-            cout << endl;
+        for (int k = 0; k < n; k++) {
+            const can_frame &frame = rx.frame(k);
+            const CANMessageDesc *msg = dbc_table.decodeInto(frame, values.data());
+            if (msg) {
+                const CANSignalDesc *sigs = dbc_table.signals(*msg);
+                cout << "Message ID: 0x" << hex << frame.can_id << dec << " | ";
+                for (int i = 0; i < msg->signal_count; i++)
+                    cout << dbc_table.str(sigs[i].name) << "=" << fixed << setprecision(2)
+                         << values[msg->first_signal + i] << " ";
+                cout << endl;
+            }
         }
     }
     close(s);
 }
 
-int main() {
+int main(int argc, char **argv) {
     const char *ifname = "vcan0";
 
+    // Optional .dbc file replaces the built-in definitions; the compiled
+    // table is cached next to it and reused while the file is unchanged
+    if (argc > 1) {
+        vector<DBCError> errors;
+        if (!loadDBCCached(argv[1], dbc_table, errors)) {
+            for (auto &e : errors)
+                cerr << argv[1] << ":" << e.line << ": " << e.message << endl;
+            return 1;
+        }
+        cout << "Loaded " << dbc_table.messageCount() << " messages from " << argv[1] << endl;
+    }
+
     thread engine(engineECUThread, ifname);
     thread sensors(sensorClusterThread, ifname);
     thread dashboard(dashboardThread, ifname);
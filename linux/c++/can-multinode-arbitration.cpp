@@ -11,6 +11,7 @@
 #include <sys/socket.h>
 #include <linux/can.h>
 #include <linux/can/raw.h>
+#include "can-rx.h"
 
 using namespace std;
 
@@ -58,26 +59,29 @@ void senderThread(const char *ifname, unsigned int can_id, const string &name) {
 // Receiver node
 void receiverThread(const char *ifname) {
     int s = setupCAN(ifname);
-    can_frame frame{};
+    CANReceiver rx(s);
     cout << "[Receiver] Listening on " << ifname << "...\n";
 
     while (true) {
-        int nbytes = read(s, &frame, sizeof(frame));
-        if (nbytes < 0) {
+        int n = rx.receive();
+        if (n < 0) {
             perror("Read");
             break;
         }
 
-        bool isExtended = frame.can_id & CAN_EFF_FLAG;
-        unsigned int id = isExtended ? (frame.can_id & CAN_EFF_MASK)
-                                     : (frame.can_id & CAN_SFF_MASK);
+        for (int k = 0; k < n; k++) {
+            const can_frame &frame = rx.frame(k);
+            bool isExtended = frame.can_id & CAN_EFF_FLAG;
+            unsigned int id = isExtended ? (frame.can_id & CAN_EFF_MASK)
+                                         : (frame.can_id & CAN_SFF_MASK);
 
-        cout << "[Receiver] Received CAN ID=0x" << hex << id << " Data=[";
-        for (int i = 0; i < frame.can_dlc; i++) {
-            cout << setw(2) << setfill('0') << hex << (int)frame.data[i];
-            if (i < frame.can_dlc - 1) cout << " ";
+            cout << "[Receiver] Received CAN ID=0x" << hex << id << " Data=[";
+            for (int i = 0; i < frame.can_dlc; i++) {
+                cout << setw(2) << setfill('0') << hex << (int)frame.data[i];
+                if (i < frame.can_dlc - 1) cout << " ";
+            }
+            cout << "]" << endl;
         }
-        cout << "]" << endl;
     }
     close(s);
 }
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing parallel loop for batch jobs.
+// Each worker starts with a contiguous range of task indices and takes
+// from its front, so neighbouring tasks (e.g. chunks of one file) run in
+// order on one core. A worker that runs dry steals the back half of the
+// largest remaining range, so uneven tasks still keep every core busy.
+class CANWorkPool {
+public:
+    explicit CANWorkPool(unsigned int threads = std::thread::hardware_concurrency())
+        : workers(std::max(1u, threads)), ranges(workers) {}
+
+    CANWorkPool(const CANWorkPool &) = delete;
+    CANWorkPool &operator=(const CANWorkPool &) = delete;
+
+    unsigned int size() const { return workers; }
+
+    // Run f(task, worker) for every task in [0, tasks) and wait for all
+    // of them; worker is in [0, size()) for per-thread scratch state
+    template <typename F>
+    void run(size_t tasks, F &&f) {
+        for (unsigned int w = 0; w < workers; w++) {
+            ranges[w].begin = tasks * w / workers;
+            ranges[w].end = tasks * (w + 1) / workers;
+        }
+        std::vector<std::thread> threads;
+        for (unsigned int w = 1; w < workers; w++)
+            threads.emplace_back([this, w, &f] { work(w, f); });
+        work(0, f);
+        for (auto &t : threads) t.join();
+    }
+
+    std::atomic<uint64_t> steals{0};
+
+private:
+    struct alignas(64) Range {
+        std::mutex lock;
+        size_t begin = 0, end = 0;
+    };
+
+    template <typename F>
+    void work(unsigned int w, F &f) {
+        size_t task;
+        while (take(w, task) || steal(w, task)) f(task, w);
+    }
+
+    bool take(unsigned int w, size_t &task) {
+        std::lock_guard<std::mutex> g(ranges[w].lock);
+        if (ranges[w].begin == ranges[w].end) return false;
+        task = ranges[w].begin++;
+        return true;
+    }
+
+    // Move the back half of the fullest other range to w, then take from it
+    bool steal(unsigned int w, size_t &task) {
+        for (;;) {
+            unsigned int victim = w;
+            size_t most = 0;
+            for (unsigned int v = 0; v < workers; v++) {
+                if (v == w) continue;
+                std::lock_guard<std::mutex> g(ranges[v].lock);
+                if (ranges[v].end - ranges[v].begin > most) {
+                    most = ranges[v].end - ranges[v].begin;
+                    victim = v;
+                }
+            }
+            if (victim == w) return false;
+
+            size_t begin, end;
+            {
+                std::lock_guard<std::mutex> g(ranges[victim].lock);
+                size_t left = ranges[victim].end - ranges[victim].begin;
+                if (left == 0) continue;        // emptied meanwhile; look again
+                end = ranges[victim].end;
+                begin = end - (left + 1) / 2;
+                ranges[victim].end = begin;
+            }
+            steals.fetch_add(1, std::memory_order_relaxed);
+            std::lock_guard<std::mutex> g(ranges[w].lock);
+            ranges[w].begin = begin + 1;
+            ranges[w].end = end;
+            task = begin;
+            return true;
+        }
+    }
+
+    unsigned int workers;
+    std::vector<Range> ranges;
+};
+
+// Split text [data, data + size) into pieces of about chunkBytes that end
+// on a line break, for parallel parsing. Returns (offset, length) pairs.
+inline std::vector<std::pair<size_t, size_t>> splitLines(const char *data, size_t size, size_t chunkBytes) {
+    std::vector<std::pair<size_t, size_t>> chunks;
+    size_t pos = 0;
+    while (pos < size) {
+        size_t end = std::min(size, pos + chunkBytes);
+        if (end < size) {
+            const void *nl = memchr(data + end, '\n', size - end);
+            end = nl ? static_cast<const char *>(nl) - data + 1 : size;
+        }
+        chunks.emplace_back(pos, end - pos);
+        pos = end;
+    }
+    return chunks;
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <linux/can.h>
+#include "can-rx.h"
+
+// epoll event loop owning CAN sockets and periodic timers.
+// Readers wake only when frames are queued and drain everything available
+// in recvmmsg batches; timers run off timerfds. An idle bus costs no CPU.
+class CANReactor {
+public:
+    using FrameHandler = std::function<void(const can_frame &frame, uint64_t ts_ns)>;
+    using TimerHandler = std::function<void()>;
+
+    CANReactor() {
+        ep = epoll_create1(EPOLL_CLOEXEC);
+        if (ep < 0) perror("epoll_create1");
+        wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        watch(wake, nullptr);
+    }
+
+    ~CANReactor() {
+        for (auto &src : sources) close(src->fd);
+        close(wake);
+        close(ep);
+    }
+
+    CANReactor(const CANReactor &) = delete;
+    CANReactor &operator=(const CANReactor &) = delete;
+
+    // Take ownership of a bound CAN socket; handler sees every frame
+    bool addReader(int s, FrameHandler handler, unsigned int batch = 64) {
+        int flags = fcntl(s, F_GETFL, 0);
+        fcntl(s, F_SETFL, flags | O_NONBLOCK);
+
+        auto src = std::make_unique<Source>();
+        src->fd = s;
+        src->rx = std::make_unique<CANReceiver>(s, batch);
+        src->onFrame = std::move(handler);
+        return watch(s, std::move(src));
+    }
+
+    // Run handler every period, first expiry one period from now
+    bool addTimer(std::chrono::nanoseconds period, TimerHandler handler) {
+        int t = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (t < 0) { perror("timerfd_create"); return false; }
+
+        itimerspec spec{};
+        spec.it_interval.tv_sec = period.count() / 1000000000;
+        spec.it_interval.tv_nsec = period.count() % 1000000000;
+        spec.it_value = spec.it_interval;
+        timerfd_settime(t, 0, &spec, nullptr);
+
+        auto src = std::make_unique<Source>();
+        src->fd = t;
+        src->onTimer = std::move(handler);
+        return watch(t, std::move(src));
+    }
+
+    // Dispatch events until stop() is called
+    void run() {
+        epoll_event events[16];
+        while (!stopping) {
+            int n = epoll_wait(ep, events, 16, -1);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                perror("epoll_wait");
+                break;
+            }
+            for (int i = 0; i < n; i++) {
+                auto *src = static_cast<Source *>(events[i].data.ptr);
+                if (!src) { drainWake(); continue; }
+                if (src->rx) dispatchFrames(*src);
+                else dispatchTimer(*src);
+            }
+        }
+    }
+
+    // Safe to call from another thread or a signal handler
+    void stop() {
+        stopping = true;
+        uint64_t one = 1;
+        ssize_t r = write(wake, &one, sizeof(one));
+        (void)r;
+    }
+
+private:
+    struct Source {
+        int fd = -1;
+        std::unique_ptr<CANReceiver> rx;
+        FrameHandler onFrame;
+        TimerHandler onTimer;
+    };
+
+    bool watch(int fd, std::unique_ptr<Source> src) {
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.ptr = src.get();
+        if (epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            perror("epoll_ctl");
+            if (src) close(fd);
+            return false;
+        }
+        if (src) sources.push_back(std::move(src));
+        return true;
+    }
+
+    void dispatchFrames(Source &src) {
+        // A short batch means the socket queue is empty
+        int n;
+        do {
+            n = src.rx->receive(MSG_DONTWAIT);
+            for (int i = 0; i < n; i++)
+                src.onFrame(src.rx->frame(i), src.rx->timestampNs(i));
+        } while (n == (int)src.rx->capacity());
+    }
+
+    void dispatchTimer(Source &src) {
+        uint64_t expirations;
+        if (read(src.fd, &expirations, sizeof(expirations)) > 0)
+            src.onTimer();
+    }
+
+    void drainWake() {
+        uint64_t v;
+        ssize_t r = read(wake, &v, sizeof(v));
+        (void)r;
+    }
+
+    int ep = -1;
+    int wake = -1;
+    std::atomic<bool> stopping{false};
+    std::vector<std::unique_ptr<Source>> sources;
+};
@@ -0,0 +1,115 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include "can-replay.h"
+
+using namespace std;
+
+// Replays a capture onto CAN interfaces with the original frame spacing.
+// The file is mmap'ed and frames are sent against absolute deadlines, so
+// timing holds at full bus rate; the report gives the send-time error
+// against the recorded timestamps.
+//
+// Usage: can-replay <capture.{cancap,csv}> [ifname...] [--speed N] [--afap] [--loop]
+// Bus i of a .cancap goes to the i-th ifname (default: the recorded bus
+// names); a single ifname takes every bus. CSV logs replay onto one bus.
+
+atomic<bool> stopRequested(false);
+
+void onSignal(int) { stopRequested = true; }
+
+int setupCAN(const char *ifname) {
+    int s;
+    sockaddr_can addr{};
+    ifreq ifr{};
+    if ((s = socket(PF_CAN, SOCK_RAW, CAN_RAW)) < 0) { perror("Socket"); exit(1); }
+    strncpy(ifr.ifr_name, ifname, IFNAMSIZ - 1);
+    if (ioctl(s, SIOCGIFINDEX, &ifr) < 0) { perror(ifname); exit(1); }
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = ifr.ifr_ifindex;
+    // Transmit only: nothing should queue up on the receive side
+    setsockopt(s, SOL_CAN_RAW, CAN_RAW_FILTER, nullptr, 0);
+    if (bind(s, (sockaddr *)&addr, sizeof(addr)) < 0) { perror("Bind"); exit(1); }
+    return s;
+}
+
+template <typename Source>
+bool replay(Source &src, CANReplayer &player, bool loop) {
+    do {
+        if (!player.run(src, &stopRequested)) return false;
+        src.rewind();
+    } while (loop && !stopRequested);
+    return true;
+}
+
+int main(int argc, char **argv) {
+    vector<const char *> args;
+    double speed = 1.0;
+    bool loop = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) speed = atof(argv[++i]);
+        else if (strcmp(argv[i], "--afap") == 0) speed = 0;
+        else if (strcmp(argv[i], "--loop") == 0) loop = true;
+        else args.push_back(argv[i]);
+    }
+    if (args.empty() || speed < 0) {
+        cerr << "Usage: " << argv[0] << " <capture.{cancap,csv}> [ifname...] [--speed N] [--afap] [--loop]\n";
+        return 1;
+    }
+    const char *path = args[0];
+    size_t len = strlen(path);
+    bool csv = len > 4 && strcasecmp(path + len - 4, ".csv") == 0;
+
+    unique_ptr<CANMappedCapture> capture;
+    unique_ptr<CANMappedCSV> log;
+    if (csv) log = make_unique<CANMappedCSV>(path);
+    else capture = make_unique<CANMappedCapture>(path);
+    if (csv ? !log->ok() : !capture->ok()) return 1;
+
+    // One socket per recorded bus, or every bus onto a single interface
+    vector<const char *> ifnames(args.begin() + 1, args.end());
+    if (ifnames.empty() && !csv)
+        for (int b = 0; b < capture->header().busCount; b++)
+            if (capture->header().buses[b][0]) ifnames.push_back(capture->header().buses[b]);
+    if (ifnames.empty()) ifnames.push_back("vcan0");
+    vector<int> sockets;
+    for (const char *name : ifnames) sockets.push_back(setupCAN(name));
+    int buses = csv ? 1 : max<int>(capture->header().busCount, 1);
+    if (ifnames.size() == 1)
+        sockets.assign(buses, sockets[0]);
+
+    CANReplayer player(sockets);
+    player.speed = speed;
+    signal(SIGINT, onSignal);
+
+    cout << "Replaying " << path << " onto " << ifnames[0] << (ifnames.size() > 1 ? " ..." : "") << " at ";
+    if (speed > 0) cout << speed << "x" << endl;
+    else cout << "full speed" << endl;
+    auto t0 = chrono::steady_clock::now();
+    bool ok = csv ? replay(*log, player, loop) : replay(*capture, player, loop);
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+    cout << player.sent << " frames sent in " << secs << " s (" << (secs > 0 ? player.sent / secs : 0)
+         << " frames/s), " << player.skipped << " skipped";
+    if (csv) cout << ", " << log->skipped << " unparsed rows";
+    else if (capture->damaged) cout << ", " << capture->damaged << " damaged records";
+    cout << endl;
+    const CANReplayTiming &t = player.timing;
+    if (t.count)
+        cout << "Timing error (us): mean " << t.meanNs() / 1000 << ", min " << t.minNs / 1000.0 << ", max "
+             << t.maxNs / 1000.0 << ", |p50| " << t.percentileNs(0.5) / 1000 << ", |p99| "
+             << t.percentileNs(0.99) / 1000 << ", |p99.9| " << t.percentileNs(0.999) / 1000 << endl;
+
+    for (size_t i = 0; i < ifnames.size(); i++) close(sockets[i]);
+    return ok ? 0 : 1;
+}
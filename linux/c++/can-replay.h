@@ -0,0 +1,258 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <vector>
+#include "can-rx.h"
+#include "can-tx.h"
+#include "can-capture.h"
+#include "can-csv-parser.h"
+
+// .cancap records straight from the mapping, without copying.
+// next() returns nullptr at the end or at a damaged block, and skips
+// records with a DLC above 8.
+class CANMappedCapture {
+public:
+    explicit CANMappedCapture(const char *path) : file(path) {
+        if (!file.ok()) return;
+        if (file.size() < sizeof(hdr)) { bad(path); return; }
+        memcpy(&hdr, file.data(), sizeof(hdr));
+        if (memcmp(hdr.magic, CAN_CAPTURE_MAGIC, 8) != 0 || hdr.recordSize != sizeof(CANCaptureRecord) ||
+            hdr.headerSize < sizeof(hdr) || hdr.headerSize % alignof(CANCaptureRecord)) {
+            bad(path);
+            return;
+        }
+        pos = hdr.headerSize;
+        valid = true;
+    }
+
+    bool ok() const { return valid; }
+    const CANCaptureHeader &header() const { return hdr; }
+    uint64_t damaged = 0;       // records skipped for a DLC above 8
+
+    const CANCaptureRecord *next() {
+        for (;;) {
+            if (cur == end && !nextBlock()) return nullptr;
+            const CANCaptureRecord *r = cur++;
+            if (r->dlc <= 8) return r;
+            damaged++;
+        }
+    }
+
+    // Back to the first record, for looped playback
+    void rewind() {
+        pos = hdr.headerSize;
+        cur = end = nullptr;
+        damaged = 0;
+    }
+
+private:
+    void bad(const char *path) { fprintf(stderr, "%s: not a CAN capture file\n", path); }
+
+    bool nextBlock() {
+        if (!valid || pos + sizeof(CANCaptureBlock) > file.size()) return false;
+        CANCaptureBlock blk;
+        memcpy(&blk, file.data() + pos, sizeof(blk));
+        if (blk.magic != CAN_CAPTURE_BLOCK_MAGIC) {
+            fprintf(stderr, "Capture: bad block header at offset %zu\n", pos);
+            return false;
+        }
+        pos += sizeof(blk);
+        // A truncated last block keeps what was written
+        size_t count = std::min<size_t>(blk.count, (file.size() - pos) / sizeof(CANCaptureRecord));
+        cur = reinterpret_cast<const CANCaptureRecord *>(file.data() + pos);
+        end = cur + count;
+        pos += count * sizeof(CANCaptureRecord);
+        return count > 0;
+    }
+
+    CANMappedFile file;
+    CANCaptureHeader hdr{};
+    bool valid = false;
+    size_t pos = 0;
+    const CANCaptureRecord *cur = nullptr;
+    const CANCaptureRecord *end = nullptr;
+};
+
+// Frame CSV logs (can_log.csv or stress_test_log.csv) parsed in place
+// from the mapping, a batch of records at a time. A file without either
+// header is read as can_log.csv rows. Rows that do not parse are skipped
+// and counted; all frames go to bus 0.
+class CANMappedCSV {
+public:
+    explicit CANMappedCSV(const char *path) : file(path), parser(CANCSVParser::CAN_LOG) {
+        if (!file.ok()) return;
+        rewind();
+    }
+
+    bool ok() const { return file.ok(); }
+    uint64_t skipped = 0;
+
+    const CANCaptureRecord *next() {
+        if (pos == count) {
+            pos = count = 0;
+            while (count == 0 && p < end) count = parser.parse(p, end, batch, BATCH);
+            skipped = parser.bad;
+            if (count == 0) return nullptr;
+        }
+        return &batch[pos++];
+    }
+
+    void rewind() {
+        p = file.data();
+        end = p + file.size();
+        const char *body = p;
+        CANCSVParser header = CANCSVParser::fromHeader(body, end);
+        parser = CANCSVParser(header.layout() != CANCSVParser::UNKNOWN ? header.layout() : CANCSVParser::CAN_LOG);
+        if (header.layout() != CANCSVParser::UNKNOWN) p = body;
+        pos = count = 0;
+        skipped = 0;
+    }
+
+private:
+    static constexpr size_t BATCH = 256;
+
+    CANMappedFile file;
+    CANCSVParser parser;
+    const char *p = nullptr;
+    const char *end = nullptr;
+    CANCaptureRecord batch[BATCH];
+    size_t pos = 0, count = 0;
+};
+
+// Timing error of a replay: send time minus the frame's scheduled time
+// (its capture offset scaled by the playback speed). Percentiles come from
+// a 1 us histogram of the absolute error up to 10 ms.
+struct CANReplayTiming {
+    static constexpr int BUCKETS = 10000;
+
+    uint64_t count = 0;
+    int64_t minNs = 0, maxNs = 0;
+    double sumNs = 0;
+    std::vector<uint32_t> hist = std::vector<uint32_t>(BUCKETS + 1);
+
+    void add(int64_t errNs) {
+        if (!count || errNs < minNs) minNs = errNs;
+        if (!count || errNs > maxNs) maxNs = errNs;
+        count++;
+        sumNs += errNs;
+        hist[std::min<uint64_t>((errNs < 0 ? -errNs : errNs) / 1000, BUCKETS)]++;
+    }
+
+    double meanNs() const { return count ? sumNs / count : 0; }
+
+    // Absolute error below which fraction q of frames fall, in ns
+    int64_t percentileNs(double q) const {
+        if (!count) return 0;
+        uint64_t want = uint64_t(q * count), seen = 0;
+        for (int i = 0; i <= BUCKETS; i++)
+            if ((seen += hist[i]) > want) return int64_t(i + 1) * 1000;
+        return int64_t(BUCKETS) * 1000;
+    }
+};
+
+// Replays capture records onto sockets at their recorded spacing.
+// Each frame's deadline is start + (ts - first ts) / speed on
+// CLOCK_MONOTONIC; the thread sleeps to the next deadline with an
+// absolute clock_nanosleep and spins the last few microseconds. Frames
+// due within batchWindowNs of each other leave in one sendmmsg per bus.
+// speed 0 sends as fast as the sockets accept, in full bursts.
+class CANReplayer {
+public:
+    // sockets[bus]; records for buses with no socket are skipped
+    explicit CANReplayer(const std::vector<int> &sockets, unsigned int batch = 32) {
+        for (int s : sockets) {
+            tx.emplace_back(new CANTransmitter(s, batch));
+            due.emplace_back();
+            due.back().reserve(batch);
+        }
+    }
+
+    CANReplayer(const CANReplayer &) = delete;
+    CANReplayer &operator=(const CANReplayer &) = delete;
+
+    double speed = 1.0;
+    int64_t batchWindowNs = 50000;
+    int64_t spinNs = 50000;
+
+    uint64_t sent = 0;
+    uint64_t skipped = 0;       // error frames and unmapped buses
+    CANReplayTiming timing;
+
+    // Play every record of src (anything with const CANCaptureRecord *next()).
+    // Returns false on a send error; stop ends the replay early.
+    template <typename Source>
+    bool run(Source &src, const std::atomic<bool> *stop = nullptr) {
+        const CANCaptureRecord *r = src.next();
+        if (!r) return true;
+        int64_t first = r->ts_ns;
+        // A short lead so the first burst is not already late
+        int64_t start = int64_t(monotonicNowNs()) + 1000000;
+        int64_t windowEnd = INT64_MIN;
+
+        for (; r; r = src.next()) {
+            if (r->bus >= tx.size() || (r->flags & CAN_CAPTURE_ERROR)) {
+                skipped++;
+                continue;
+            }
+            int64_t deadline = speed > 0 ? start + int64_t((r->ts_ns - first) / speed) : 0;
+            if (speed > 0 && deadline > windowEnd) {
+                // Outside the current burst: send it, then wait for this frame
+                if (!flushAll()) return false;
+                if (stop && stop->load(std::memory_order_relaxed)) break;
+                // When behind, everything already due joins one burst
+                windowEnd = std::max(deadline, sleepUntil(deadline)) + batchWindowNs;
+            }
+            if (tx[r->bus]->pending() == tx[r->bus]->capacity() && !flush(r->bus)) return false;
+            tx[r->bus]->queue(r->frame());
+            due[r->bus].push_back(deadline);
+            if (speed <= 0 && stop && stop->load(std::memory_order_relaxed)) break;
+        }
+        return flushAll();
+    }
+
+private:
+    bool flush(size_t bus) {
+        if (tx[bus]->flush() < 0) {
+            perror("Replay send");
+            return false;
+        }
+        if (speed > 0) {
+            int64_t now = monotonicNowNs();
+            for (int64_t d : due[bus]) timing.add(now - d);
+        }
+        sent += due[bus].size();
+        due[bus].clear();
+        return true;
+    }
+
+    bool flushAll() {
+        for (size_t b = 0; b < tx.size(); b++)
+            if (tx[b]->pending() && !flush(b)) return false;
+        return true;
+    }
+
+    // Returns the time on waking
+    int64_t sleepUntil(int64_t deadline) {
+        int64_t now = monotonicNowNs();
+        if (deadline - now > spinNs) {
+            timespec ts;
+            int64_t wake = deadline - spinNs;
+            ts.tv_sec = wake / 1000000000;
+            ts.tv_nsec = wake % 1000000000;
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {}
+        }
+        while ((now = monotonicNowNs()) < deadline) {}
+        return now;
+    }
+
+    std::vector<std::unique_ptr<CANTransmitter>> tx;
+    std::vector<std::vector<int64_t>> due;
+};
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <linux/can.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+
+// Received frame with its kernel RX timestamps
+struct CANRecord {
+    uint64_t ts_ns = 0;     // kernel RX time, CLOCK_MONOTONIC nanoseconds
+    uint64_t hw_ts_ns = 0;  // controller timestamp (raw hardware clock), 0 if unsupported
+    can_frame frame{};
+};
+
+inline uint64_t monotonicNowNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+// CLOCK_REALTIME minus CLOCK_MONOTONIC, in nanoseconds
+inline int64_t realtimeOffsetNs() {
+    timespec rt, mono;
+    clock_gettime(CLOCK_REALTIME, &rt);
+    clock_gettime(CLOCK_MONOTONIC, &mono);
+    return (int64_t(rt.tv_sec) - mono.tv_sec) * 1000000000ll + (rt.tv_nsec - mono.tv_nsec);
+}
+
+// Wall-clock time of a monotonic timestamp, for human-readable logs
+inline std::chrono::system_clock::time_point toSystemTime(uint64_t mono_ns) {
+    return std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::nanoseconds(int64_t(mono_ns) + realtimeOffsetNs())));
+}
+
+// Batched SocketCAN receive.
+// One recvmmsg() call drains up to `batch` queued frames into preallocated
+// records, instead of one read() syscall per 16-byte can_frame. Each record
+// carries the kernel RX timestamp (SO_TIMESTAMPING software, plus hardware
+// where the controller provides it) converted to CLOCK_MONOTONIC.
+class CANReceiver {
+public:
+    explicit CANReceiver(int s, unsigned int batch = 64)
+        : sock(s), records(batch), iov(batch), msgs(batch), ctrl(batch * CTRL_LEN) {
+        int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE |
+                    SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE;
+        setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags));
+        // Also ask for SCM_TIMESTAMPNS, for sockets that ignore SO_TIMESTAMPING
+        int on = 1;
+        setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+
+        for (unsigned int i = 0; i < batch; i++) {
+            iov[i].iov_base = &records[i].frame;
+            iov[i].iov_len = sizeof(can_frame);
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_control = &ctrl[i * CTRL_LEN];
+        }
+    }
+
+    CANReceiver(const CANReceiver &) = delete;
+    CANReceiver &operator=(const CANReceiver &) = delete;
+
+    // Wait for at least one frame, then take whatever else is already
+    // queued without blocking again. Returns the frame count, or -1 with
+    // errno set (EAGAIN on an empty non-blocking socket).
+    int receive(int flags = MSG_WAITFORONE) {
+        for (auto &m : msgs)
+            m.msg_hdr.msg_controllen = CTRL_LEN;
+
+        int n = recvmmsg(sock, msgs.data(), msgs.size(), flags, nullptr);
+        if (n <= 0) return n;
+
+        // Kernel software stamps are CLOCK_REALTIME; one offset per batch
+        int64_t offset = realtimeOffsetNs();
+        uint64_t fallback = 0;
+        for (int i = 0; i < n; i++) {
+            CANRecord &r = records[i];
+            r.hw_ts_ns = 0;
+            int64_t sw = extractTimestamps(msgs[i].msg_hdr, r.hw_ts_ns);
+            if (sw) {
+                r.ts_ns = sw - offset;
+            } else {
+                // No control message: best effort is the userspace read time
+                if (!fallback) fallback = monotonicNowNs();
+                r.ts_ns = fallback;
+            }
+        }
+        return n;
+    }
+
+    const can_frame &frame(int i) const { return records[i].frame; }
+    const CANRecord &record(int i) const { return records[i]; }
+
+    // Bytes the kernel delivered for frame i
+    size_t length(int i) const { return msgs[i].msg_len; }
+
+    // Kernel RX time in CLOCK_MONOTONIC nanoseconds
+    uint64_t timestampNs(int i) const { return records[i].ts_ns; }
+
+    unsigned int capacity() const { return records.size(); }
+
+private:
+    static constexpr size_t CTRL_LEN = CMSG_SPACE(sizeof(scm_timestamping)) +
+                                       CMSG_SPACE(sizeof(timespec));
+
+    static int64_t toNs(const timespec &ts) {
+        return int64_t(ts.tv_sec) * 1000000000ll + ts.tv_nsec;
+    }
+
+    // Returns the software stamp (CLOCK_REALTIME ns, 0 if absent) and
+    // fills hw with the raw hardware stamp when present
+    static int64_t extractTimestamps(msghdr &hdr, uint64_t &hw) {
+        int64_t sw = 0;
+        for (cmsghdr *c = CMSG_FIRSTHDR(&hdr); c; c = CMSG_NXTHDR(&hdr, c)) {
+            if (c->cmsg_level != SOL_SOCKET) continue;
+            if (c->cmsg_type == SCM_TIMESTAMPING) {
+                scm_timestamping tss;
+                memcpy(&tss, CMSG_DATA(c), sizeof(tss));
+                if (toNs(tss.ts[0])) sw = toNs(tss.ts[0]);
+                hw = toNs(tss.ts[2]);
+            } else if (c->cmsg_type == SCM_TIMESTAMPNS && !sw) {
+                timespec ts;
+                memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+                sw = toNs(ts);
+            }
+        }
+        return sw;
+    }
+
+    int sock;
+    std::vector<CANRecord> records;
+    std::vector<iovec> iov;
+    std::vector<mmsghdr> msgs;
+    std::vector<char> ctrl;
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <endian.h>
+
+// Bit-exact signal codec for 8-byte CAN payloads.
+// A SignalPlan is precomputed once per signal: extracting a value is one
+// 64-bit load (byte-swapped for Motorola), a shift and a mask, for any
+// start bit and any length up to 64.
+
+enum class ByteOrder : uint8_t { Intel, Motorola };               // DBC @1 / @0
+enum class SignalType : uint8_t { Unsigned, Signed, Float32, Float64 };
+
+struct SignalPlan {
+    uint64_t mask = 0;
+    uint8_t shift = 0;      // bit position of the LSB in the loaded word
+    uint8_t length = 0;
+    ByteOrder order = ByteOrder::Intel;
+    SignalType type = SignalType::Unsigned;
+
+    // start_bit uses DBC numbering: the LSB for Intel signals, the MSB
+    // (in byte*8 + bit order) for Motorola signals. Returns a plan with
+    // length 0 if the signal does not fit in 8 bytes.
+    static SignalPlan make(int start_bit, int length,
+                           ByteOrder order = ByteOrder::Intel,
+                           SignalType type = SignalType::Unsigned) {
+        SignalPlan p;
+        if (type == SignalType::Float32) length = 32;
+        if (type == SignalType::Float64) length = 64;
+        if (length <= 0 || length > 64 || start_bit < 0 || start_bit > 63) return p;
+
+        int shift;
+        if (order == ByteOrder::Intel) {
+            shift = start_bit;
+            if (shift + length > 64) return p;
+        } else {
+            // Bit b of byte k sits at 56 - 8k + b in the big-endian word
+            int msb = 56 - 8 * (start_bit / 8) + start_bit % 8;
+            shift = msb - length + 1;
+            if (shift < 0) return p;
+        }
+
+        p.mask = length == 64 ? ~0ull : (1ull << length) - 1;
+        p.shift = shift;
+        p.length = length;
+        p.order = order;
+        p.type = type;
+        return p;
+    }
+
+    bool valid() const { return length != 0; }
+
+    // Raw bit field, zero-extended
+    uint64_t extract(const uint8_t *data) const {
+        return (load(data) >> shift) & mask;
+    }
+
+    // Write the low `length` bits of raw, leaving other bits untouched
+    void insert(uint8_t *data, uint64_t raw) const {
+        uint64_t word = load(data);
+        word = (word & ~(mask << shift)) | ((raw & mask) << shift);
+        store(data, word);
+    }
+
+    // Numeric value of the field: sign-extended or reinterpreted as IEEE
+    double value(const uint8_t *data) const {
+        uint64_t raw = extract(data);
+        switch (type) {
+        case SignalType::Signed:
+            return double(int64_t(raw << (64 - length)) >> (64 - length));
+        case SignalType::Float32: {
+            uint32_t bits = uint32_t(raw);
+            float f;
+            memcpy(&f, &bits, sizeof(f));
+            return f;
+        }
+        case SignalType::Float64: {
+            double d;
+            memcpy(&d, &raw, sizeof(d));
+            return d;
+        }
+        default:
+            return double(raw);
+        }
+    }
+
+    // Inverse of value(): integer types are truncated to the field width
+    uint64_t toRaw(double v) const {
+        switch (type) {
+        case SignalType::Signed:
+            return uint64_t(int64_t(v)) & mask;
+        case SignalType::Float32: {
+            float f = float(v);
+            uint32_t bits;
+            memcpy(&bits, &f, sizeof(bits));
+            return bits;
+        }
+        case SignalType::Float64: {
+            uint64_t bits;
+            memcpy(&bits, &v, sizeof(bits));
+            return bits;
+        }
+        default:
+            return v <= 0 ? 0 : uint64_t(v) & mask;
+        }
+    }
+
+private:
+    uint64_t load(const uint8_t *data) const {
+        uint64_t word;
+        memcpy(&word, data, 8);
+        return order == ByteOrder::Intel ? le64toh(word) : be64toh(word);
+    }
+
+    void store(uint8_t *data, uint64_t word) const {
+        word = order == ByteOrder::Intel ? htole64(word) : htobe64(word);
+        memcpy(data, &word, 8);
+    }
+};
@@ -2,10 +2,11 @@
 #include <thread>
 #include <chrono>
 #include <iomanip>
-#include <fstream>
 #include <cstdlib>
 #include <ctime>
 #include <atomic>
+#include <cerrno>
+#include <csignal>
 #include <unistd.h>
 #include <net/if.h>
 #include <sys/ioctl.h>
@@ -13,6 +14,9 @@
 #include <linux/can.h>
 #include <linux/can/raw.h>
 #include <cstring>
+#include "can-rx.h"
+#include "can-tx.h"
+#include "can-log.h"
 
 using namespace std;
 
@@ -20,6 +24,11 @@ using namespace std;
 atomic<uint64_t> totalBits(0);
 atomic<uint64_t> frameBitsInSecond(0);
 
+// Set by Ctrl+C; every thread finishes its loop so the log is drained
+atomic<bool> stopRequested(false);
+
+void onSignal(int) { stopRequested = true; }
+
 // Setup CAN socket
 int setupCAN(const char *ifname) {
     int s;
@@ -41,27 +50,27 @@ void randomData(can_frame &frame) {
     frame.can_dlc = 8;
 }
 
-// Approx frame size in bits (11-bit standard)
-int frameSizeBits(const can_frame &frame) {
-    return 47 + frame.can_dlc*8;
-}
-
-// High-frequency sender node
-void highFreqSender(const char *ifname, unsigned int can_id, const string &name) {
+// High-frequency sender node: queues frames and flushes them in sendmmsg
+// bursts, paced to a share of the 500 kbps bus
+void highFreqSender(const char *ifname, unsigned int can_id, const string &name, double busLoadPercent) {
     int s = setupCAN(ifname);
+    CANTransmitter tx(s);
+    tx.setBusLoad(busLoadPercent, 500000);
     can_frame frame{};
     frame.can_id = can_id;
     srand(time(0) + can_id);
 
-    while(true) {
-        randomData(frame);
-        if(write(s,&frame,sizeof(frame)) != sizeof(frame)) perror("Write");
-        uint64_t bits = frameSizeBits(frame);
-        totalBits += bits;
-        frameBitsInSecond += bits;
+    while(!stopRequested) {
+        while(tx.pending() < tx.capacity()) {
+            randomData(frame);
+            tx.queue(frame);
+        }
+        uint64_t before = tx.sentBits;
+        if(tx.flush() < 0) { perror("Write"); break; }
+        totalBits += tx.sentBits - before;
+        frameBitsInSecond += tx.sentBits - before;
 
         // Do not print to avoid console flooding
-        this_thread::sleep_for(chrono::milliseconds(10)); // 100 Hz sending
     }
     close(s);
 }
@@ -69,70 +78,78 @@ void highFreqSender(const char *ifname, unsigned int can_id, const string &name)
 // Dashboard receiver + logger
 void dashboardThread(const char *ifname) {
     int s = setupCAN(ifname);
-    can_frame frame{};
+    // Wake up every 100 ms to notice a stop request on a quiet bus
+    timeval timeout{0, 100000};
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    CANReceiver rx(s);
     cout << "[Dashboard] Listening on " << ifname << "...\n";
 
-    ofstream log("stress_test_log.csv");
-    log << "Timestamp,CAN_ID,DLC,PayloadBits,TotalBits,BusLoad,Data\n";
-
-    auto start = chrono::steady_clock::now();
-
-    while(true) {
-        int nbytes = read(s,&frame,sizeof(frame));
-        if(nbytes < 0) { perror("Read"); break; }
-
-        auto now = chrono::system_clock::now();
-        auto ms = chrono::duration_cast<chrono::milliseconds>(now.time_since_epoch())%1000;
-        time_t t = chrono::system_clock::to_time_t(now);
-        tm tm = *localtime(&t);
-        ostringstream timestamp;
-        timestamp << put_time(&tm,"%Y-%m-%d %H:%M:%S") << "." << setw(3) << setfill('0') << ms.count();
-
-        unsigned int id = frame.can_id & CAN_SFF_MASK;
-        int payloadBits = frame.can_dlc*8;
-        uint64_t totalBitsSnapshot = frameBitsInSecond.load();
-        double busLoad = (totalBitsSnapshot/500000.0)*100; // assuming 500 kbps
-
-        // Print to console
-        cout << "[" << timestamp.str() << "] "
-             << "ID=0x" << hex << id
-             << " DLC=" << dec << (int)frame.can_dlc
-             << " PayloadBits=" << payloadBits
-             << " TotalBits=" << totalBitsSnapshot
-             << " BusLoad=" << fixed << setprecision(2) << busLoad << "% "
-             << "Data=[";
-        for(int i=0;i<frame.can_dlc;i++){
-            cout << setw(2) << setfill('0') << hex << (int)frame.data[i];
-            if(i<frame.can_dlc-1) cout << " ";
-        }
-        cout << "]" << endl;
-
-        // Log to CSV
-        log << timestamp.str() << ",0x" << hex << id << ","
-            << dec << (int)frame.can_dlc << "," << payloadBits << ","
-            << totalBitsSnapshot << "," << fixed << setprecision(2) << busLoad << ",";
-        for(int i=0;i<frame.can_dlc;i++){
-            log << setw(2) << setfill('0') << hex << (int)frame.data[i];
-            if(i<frame.can_dlc-1) log << " ";
+    // Rows are formatted and written by the log's writer thread
+    CANLogWriter<CANBusLogRecord> log("stress_test_log.csv", CAN_BUS_LOG_HEADER, formatBusLog);
+
+    uint64_t windowStart = 0;
+
+    while(!stopRequested) {
+        int n = rx.receive();
+        if(n < 0) {
+            if(errno == EAGAIN || errno == EINTR) continue;
+            perror("Read");
+            break;
         }
-        log << "\n";
-        log.flush();
-
-        // Reset counter every second
-        auto elapsed = chrono::steady_clock::now() - start;
-        if(chrono::duration_cast<chrono::seconds>(elapsed).count() >= 1) {
-            frameBitsInSecond = 0;
-            start = chrono::steady_clock::now();
+
+        for (int k = 0; k < n; k++) {
+            const can_frame &frame = rx.frame(k);
+            char timestamp[32];
+            timestamp[formatLocalTime(rx.timestampNs(k), timestamp)] = '\0';
+
+            unsigned int id = frame.can_id & CAN_SFF_MASK;
+            int payloadBits = frame.can_dlc*8;
+            uint64_t totalBitsSnapshot = frameBitsInSecond.load();
+            double busLoad = (totalBitsSnapshot/500000.0)*100; // assuming 500 kbps
+
+            // Print to console
+            cout << "[" << timestamp << "] "
+                 << "ID=0x" << hex << id
+                 << " DLC=" << dec << (int)frame.can_dlc
+                 << " PayloadBits=" << payloadBits
+                 << " TotalBits=" << totalBitsSnapshot
+                 << " BusLoad=" << fixed << setprecision(2) << busLoad << "% "
+                 << "Data=[";
+            for(int i=0;i<frame.can_dlc;i++){
+                cout << setw(2) << setfill('0') << hex << (int)frame.data[i];
+                if(i<frame.can_dlc-1) cout << " ";
+            }
+            cout << "]" << endl;
+
+            log.push({rx.timestampNs(k), frame, totalBitsSnapshot});
+
+            // Reset counter every second (kernel RX time, not read time)
+            uint64_t ts = rx.timestampNs(k);
+            if(windowStart == 0) windowStart = ts;
+            if(ts - windowStart >= 1000000000ull) {
+                frameBitsInSecond = 0;
+                windowStart = ts;
+                if(log.dropped)
+                    cerr << "[Dashboard] Log ring high-water " << log.highWater << "/" << log.capacity()
+                         << ", " << log.dropped << " rows dropped\n";
+            }
         }
     }
+
+    log.stop();
+    cout << "[Dashboard] Log: " << log.written << " rows, " << log.dropped << " dropped, ring high-water "
+         << log.highWater << "/" << log.capacity() << endl;
     close(s);
 }
 
 int main() {
     const char *ifname = "vcan0";
+    signal(SIGINT, onSignal);
+
+    double loadPerSender = 45.0; // percent of 500 kbps, ~90% combined
 
-    thread senderA(highFreqSender, ifname, 0x100, "SenderA"); // Higher priority
-    thread senderB(highFreqSender, ifname, 0x200, "SenderB"); // Lower priority
+    thread senderA(highFreqSender, ifname, 0x100, "SenderA", loadPerSender); // Higher priority
+    thread senderB(highFreqSender, ifname, 0x200, "SenderB", loadPerSender); // Lower priority
     thread dash(dashboardThread, ifname);
 
     senderA.join();
@@ -6,12 +6,14 @@
 #include <cstdlib>
 #include <ctime>
 #include <cstring>
+#include <map>
 #include <unistd.h>
 #include <net/if.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <linux/can.h>
 #include <linux/can/raw.h>
+#include "can-rx.h"
 
 using namespace std;
 
@@ -81,39 +83,49 @@ void sensor2Thread(const char *ifname) {
 // Dashboard receiver + logger
 void dashboardThread(const char *ifname) {
     int s = setupCAN(ifname);
-    can_frame frame{};
+    CANReceiver rx(s);
     cout << "[Dashboard] Listening on " << ifname << "...\n";
 
     ofstream log("dashboard_log.csv");
-    log << "Timestamp,CAN_ID,Data\n";
+    log << "Timestamp,CAN_ID,Data,InterArrivalMs\n";
 
-    while (true) {
-        int nbytes = read(s, &frame, sizeof(frame));
-        if (nbytes < 0) { perror("Read"); break; }
-
-        auto now = chrono::system_clock::now();
-        auto ms = chrono::duration_cast<chrono::milliseconds>(now.time_since_epoch()) % 1000;
-        time_t t = chrono::system_clock::to_time_t(now);
-        tm tm = *localtime(&t);
-        ostringstream timestamp;
-        timestamp << put_time(&tm, "%Y-%m-%d %H:%M:%S") << "." << setw(3) << setfill('0') << ms.count();
-
-        unsigned int id = frame.can_id & CAN_SFF_MASK;
-
-        cout << "[" << timestamp.str() << "] ID=0x" << hex << id << " Data=[";
-        for (int i=0; i<frame.can_dlc; i++) {
-            cout << setw(2) << setfill('0') << hex << (int)frame.data[i];
-            if(i<frame.can_dlc-1) cout << " ";
-        }
-        cout << "]\n";
+    // Last kernel RX time per ID, for inter-arrival analysis
+    map<unsigned int, uint64_t> lastSeen;
 
-        log << timestamp.str() << ",0x" << hex << id << ",";
-        for(int i=0;i<frame.can_dlc;i++) {
-            log << setw(2) << setfill('0') << hex << (int)frame.data[i];
-            if(i<frame.can_dlc-1) log << " ";
+    while (true) {
+        int n = rx.receive();
+        if (n < 0) { perror("Read"); break; }
+
+        for (int k = 0; k < n; k++) {
+            const can_frame &frame = rx.frame(k);
+            auto now = toSystemTime(rx.timestampNs(k));
+            auto ms = chrono::duration_cast<chrono::milliseconds>(now.time_since_epoch()) % 1000;
+            time_t t = chrono::system_clock::to_time_t(now);
+            tm tm = *localtime(&t);
+            ostringstream timestamp;
+            timestamp << put_time(&tm, "%Y-%m-%d %H:%M:%S") << "." << setw(3) << setfill('0') << ms.count();
+
+            unsigned int id = frame.can_id & CAN_SFF_MASK;
+
+            uint64_t ts = rx.timestampNs(k);
+            double deltaMs = lastSeen.count(id) ? (ts - lastSeen[id]) / 1e6 : 0.0;
+            lastSeen[id] = ts;
+
+            cout << "[" << timestamp.str() << "] ID=0x" << hex << id << " Data=[";
+            for (int i=0; i<frame.can_dlc; i++) {
+                cout << setw(2) << setfill('0') << hex << (int)frame.data[i];
+                if(i<frame.can_dlc-1) cout << " ";
+            }
+            cout << "] dt=" << dec << fixed << setprecision(3) << deltaMs << "ms\n";
+
+            log << timestamp.str() << ",0x" << hex << id << ",";
+            for(int i=0;i<frame.can_dlc;i++) {
+                log << setw(2) << setfill('0') << hex << (int)frame.data[i];
+                if(i<frame.can_dlc-1) log << " ";
+            }
+            log << "," << dec << fixed << setprecision(3) << deltaMs << "\n";
+            log.flush();
         }
-        log << "\n";
-        log.flush();
     }
     close(s);
 }
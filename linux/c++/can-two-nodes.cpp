@@ -12,6 +12,7 @@
 #include <linux/can/raw.h>
 #include <cstdlib>
 #include <ctime>
+#include "can-rx.h"
 
 using namespace std;
 
@@ -93,50 +94,53 @@ void receiverThread(const char *ifname) {
         return;
     }
 
-    can_frame frame;
+    CANReceiver rx(s);
     cout << "[Receiver] Listening on " << ifname << " ..." << endl;
 
     ofstream csv("can_log.csv");
     csv << "Timestamp,CAN_ID,Type,DLC,Data\n";
 
     while (true) {
-        int nbytes = read(s, &frame, sizeof(frame));
-        if (nbytes < 0) {
+        int n = rx.receive();
+        if (n < 0) {
             perror("Receiver Read");
             break;
         }
 
-        bool isExtended = frame.can_id & CAN_EFF_FLAG;
-        unsigned int id = isExtended ? (frame.can_id & CAN_EFF_MASK)
-                                     : (frame.can_id & CAN_SFF_MASK);
-
-        // Timestamp
-        auto now = chrono::system_clock::now();
-        auto ms = chrono::duration_cast<chrono::milliseconds>(now.time_since_epoch()) % 1000;
-        time_t t = chrono::system_clock::to_time_t(now);
-        tm tm = *localtime(&t);
-        ostringstream timestamp;
-        timestamp << put_time(&tm, "%Y-%m-%d %H:%M:%S") << "." << setw(3) << setfill('0') << ms.count();
-
-        // Print to console
-        cout << "[" << timestamp.str() << "] ID=0x" << hex << uppercase << id
-             << (isExtended ? " (Extended)" : " (Standard)") << " DLC=" << dec << (int)frame.can_dlc << " Data=[";
-        for (int i = 0; i < frame.can_dlc; i++) {
-            cout << hex << uppercase << setw(2) << setfill('0') << (int)frame.data[i];
-            if (i < frame.can_dlc - 1) cout << " ";
-        }
-        cout << "]" << endl;
-
-        // Log to CSV
-        csv << timestamp.str() << ",0x" << hex << uppercase << id << ","
-            << (isExtended ? "Extended" : "Standard") << ","
-            << dec << (int)frame.can_dlc << ",";
-        for (int i = 0; i < frame.can_dlc; i++) {
-            csv << hex << uppercase << setw(2) << setfill('0') << (int)frame.data[i];
-            if (i < frame.can_dlc - 1) csv << " ";
+        for (int k = 0; k < n; k++) {
+            const can_frame &frame = rx.frame(k);
+            bool isExtended = frame.can_id & CAN_EFF_FLAG;
+            unsigned int id = isExtended ? (frame.can_id & CAN_EFF_MASK)
+                                         : (frame.can_id & CAN_SFF_MASK);
+
+            // Timestamp
+            auto now = toSystemTime(rx.timestampNs(k));
+            auto ms = chrono::duration_cast<chrono::milliseconds>(now.time_since_epoch()) % 1000;
+            time_t t = chrono::system_clock::to_time_t(now);
+            tm tm = *localtime(&t);
+            ostringstream timestamp;
+            timestamp << put_time(&tm, "%Y-%m-%d %H:%M:%S") << "." << setw(3) << setfill('0') << ms.count();
+
+            // Print to console
+            cout << "[" << timestamp.str() << "] ID=0x" << hex << uppercase << id
+                 << (isExtended ? " (Extended)" : " (Standard)") << " DLC=" << dec << (int)frame.can_dlc << " Data=[";
+            for (int i = 0; i < frame.can_dlc; i++) {
+                cout << hex << uppercase << setw(2) << setfill('0') << (int)frame.data[i];
+                if (i < frame.can_dlc - 1) cout << " ";
+            }
+            cout << "]" << endl;
+
+            // Log to CSV
+            csv << timestamp.str() << ",0x" << hex << uppercase << id << ","
+                << (isExtended ? "Extended" : "Standard") << ","
+                << dec << (int)frame.can_dlc << ",";
+            for (int i = 0; i < frame.can_dlc; i++) {
+                csv << hex << uppercase << setw(2) << setfill('0') << (int)frame.data[i];
+                if (i < frame.can_dlc - 1) csv << " ";
+            }
+            csv << "\n";
+            csv.flush();
         }
-        csv << "\n";
-        csv.flush();
     }
 
     csv.close();
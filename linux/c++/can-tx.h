@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <linux/can.h>
+
+// Approx frame size on the wire in bits (SOF+ID+CRC+ACK+data, no stuffing)
+inline unsigned int canFrameBits(const can_frame &frame) {
+    return ((frame.can_id & CAN_EFF_FLAG) ? 67 : 47) + frame.can_dlc * 8;
+}
+
+// Batched SocketCAN transmit.
+// Frames are queued into a preallocated burst and written with a single
+// sendmmsg() call. An optional target rate (frames/s or percent bus load)
+// paces the bursts against absolute deadlines so the sender does not drift.
+class CANTransmitter {
+public:
+    explicit CANTransmitter(int s, unsigned int batch = 32)
+        : sock(s), frames(batch), iov(batch), msgs(batch) {
+        for (unsigned int i = 0; i < batch; i++) {
+            iov[i].iov_base = &frames[i];
+            iov[i].iov_len = sizeof(can_frame);
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+    }
+
+    CANTransmitter(const CANTransmitter &) = delete;
+    CANTransmitter &operator=(const CANTransmitter &) = delete;
+
+    // Pace to a fixed frame rate; 0 sends as fast as the socket accepts
+    void setRate(double framesPerSec) {
+        mode = framesPerSec > 0 ? FRAMES : UNLIMITED;
+        nsPerUnit = framesPerSec > 0 ? 1e9 / framesPerSec : 0;
+        deadline = Clock::now();
+    }
+
+    // Pace to a share of the bitrate, counting each frame's wire bits
+    void setBusLoad(double percent, unsigned int bitrate = 500000) {
+        mode = percent > 0 ? BITS : UNLIMITED;
+        nsPerUnit = percent > 0 ? 1e9 / (bitrate * percent / 100.0) : 0;
+        deadline = Clock::now();
+    }
+
+    // Queue a frame, flushing first if the burst is full
+    bool queue(const can_frame &frame) {
+        if (count == frames.size() && flush() < 0)
+            return false;
+        frames[count++] = frame;
+        return true;
+    }
+
+    // Wait for the burst's deadline, then send everything queued.
+    // Returns frames sent, or -1 with errno set.
+    int flush() {
+        if (count == 0) return 0;
+
+        if (mode != UNLIMITED) {
+            auto now = Clock::now();
+            // Do not try to catch up after a stall longer than one burst
+            if (deadline + toNs(burstCost()) < now) deadline = now;
+            std::this_thread::sleep_until(deadline);
+            deadline += toNs(burstCost());
+        }
+
+        unsigned int sent = 0;
+        while (sent < count) {
+            int n = sendmmsg(sock, &msgs[sent], count - sent, 0);
+            if (n < 0) {
+                // TX queue full: let the controller drain and retry
+                if (errno == ENOBUFS || errno == EAGAIN) {
+                    std::this_thread::sleep_for(std::chrono::microseconds(100));
+                    continue;
+                }
+                return -1;
+            }
+            for (int i = 0; i < n; i++)
+                sentBits += canFrameBits(frames[sent + i]);
+            sent += n;
+        }
+        sentFrames += sent;
+        count = 0;
+        return sent;
+    }
+
+    unsigned int pending() const { return count; }
+    unsigned int capacity() const { return frames.size(); }
+
+    uint64_t sentFrames = 0;
+    uint64_t sentBits = 0;
+
+private:
+    using Clock = std::chrono::steady_clock;
+    enum Mode { UNLIMITED, FRAMES, BITS };
+
+    static std::chrono::nanoseconds toNs(double ns) {
+        return std::chrono::nanoseconds(static_cast<int64_t>(ns));
+    }
+
+    double burstCost() const {
+        if (mode == FRAMES) return nsPerUnit * count;
+        double bits = 0;
+        for (unsigned int i = 0; i < count; i++) bits += canFrameBits(frames[i]);
+        return nsPerUnit * bits;
+    }
+
+    int sock;
+    std::vector<can_frame> frames;
+    std::vector<iovec> iov;
+    std::vector<mmsghdr> msgs;
+    unsigned int count = 0;
+
+    Mode mode = UNLIMITED;
+    double nsPerUnit = 0;
+    Clock::time_point deadline = Clock::now();
+};
@@ -0,0 +1,200 @@
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <poll.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include "can-rx.h"
+#include "can-tx.h"
+#include "can-uds.h"
+
+using namespace std;
+
+// End-of-line DTC readout: sends ReadDTCInformation (0x19 0x02) to every
+// ECU at once over ISO-TP, optionally clears the DTCs it finds, and
+// reports each ECU's answer and round-trip latency.
+//
+// Usage: can-uds-tester [ifname] [ecus] [request_base] [response_base] [--clear] [--simulate]
+// ECU i is addressed on request_base + i and answers on response_base + i
+// (defaults 3, 0x7E0, 0x7E8). --simulate also runs the ECUs in this process.
+
+atomic<bool> simulating(true);
+
+int setupCAN(const char *ifname) {
+    int s;
+    sockaddr_can addr{};
+    ifreq ifr{};
+    if ((s = socket(PF_CAN, SOCK_RAW, CAN_RAW)) < 0) { perror("Socket"); exit(1); }
+    strcpy(ifr.ifr_name, ifname);
+    ioctl(s, SIOCGIFINDEX, &ifr);
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = ifr.ifr_ifindex;
+    if (bind(s, (sockaddr *)&addr, sizeof(addr)) < 0) { perror("Bind"); exit(1); }
+    return s;
+}
+
+// Wait for frames until deadline (monotonic ns), at most 100 ms
+void waitForFrames(int s, uint64_t deadline) {
+    uint64_t now = monotonicNowNs();
+    int ms = deadline <= now ? 0 : int(min<uint64_t>((deadline - now + 999999) / 1000000, 100));
+    pollfd p{s, POLLIN, 0};
+    poll(&p, 1, ms);
+}
+
+// Simulated ECUs: ECU i stores i % 25 DTCs and answers after i % 8 ms;
+// every tenth ECU first says "response pending" (0x78) and takes 100 ms
+void simulatedECUs(const char *ifname, int count, canid_t requestBase, canid_t responseBase) {
+    int s = setupCAN(ifname);
+    ISOTPEngine tp(count, [s](const can_frame &f) {
+        if (write(s, &f, sizeof(f)) != sizeof(f)) perror("ECU write");
+    });
+    for (int i = 0; i < count; i++)
+        tp.open(responseBase + i, requestBase + i);
+
+    struct Reply { int ecu; uint64_t due; vector<uint8_t> data; };
+    vector<Reply> replies;
+    tp.onMessage = [&](int ecu, const uint8_t *req, size_t len) {
+        uint64_t now = monotonicNowNs();
+        vector<uint8_t> resp;
+        if (req[0] == 0x19 && len >= 3 && req[1] == 0x02) {
+            resp = {0x59, 0x02, 0x09};
+            for (int k = 0; k < ecu % 25; k++)
+                resp.insert(resp.end(), {uint8_t(k >> 8), uint8_t(k), uint8_t(ecu), 0x09});
+        } else if (req[0] == 0x14) {
+            resp = {0x54};
+        } else {
+            resp = {0x7F, req[0], 0x11};
+        }
+        if (ecu % 10 == 9) {
+            replies.push_back({ecu, now, {0x7F, req[0], 0x78}});
+            replies.push_back({ecu, now + 100000000ull, resp});
+        } else {
+            replies.push_back({ecu, now + (ecu % 8) * 1000000ull, resp});
+        }
+    };
+
+    CANReceiver rx(s);
+    while (simulating) {
+        uint64_t next = tp.nextDeadline();
+        for (auto &r : replies) next = min(next, r.due);
+        waitForFrames(s, next);
+
+        int n = rx.receive(MSG_DONTWAIT);
+        for (int i = 0; i < n; i++)
+            tp.receive(rx.frame(i), rx.timestampNs(i));
+
+        uint64_t now = monotonicNowNs();
+        for (size_t i = 0; i < replies.size();) {
+            if (replies[i].due <= now && !tp.sending(replies[i].ecu)) {
+                tp.send(replies[i].ecu, replies[i].data.data(), replies[i].data.size(), now);
+                replies.erase(replies.begin() + i);
+            } else {
+                i++;
+            }
+        }
+        tp.poll(now);
+    }
+    close(s);
+}
+
+const char *statusName(UDSStatus status) {
+    switch (status) {
+    case UDSStatus::Positive: return "ok";
+    case UDSStatus::Negative: return "negative";
+    case UDSStatus::Timeout: return "timeout";
+    default: return "transport error";
+    }
+}
+
+int main(int argc, char **argv) {
+    vector<const char *> args;
+    bool clear = false, simulate = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--clear") == 0) clear = true;
+        else if (strcmp(argv[i], "--simulate") == 0) simulate = true;
+        else args.push_back(argv[i]);
+    }
+    const char *ifname = args.size() > 0 ? args[0] : "vcan0";
+    int count = args.size() > 1 ? atoi(args[1]) : 3;
+    canid_t requestBase = args.size() > 2 ? strtoul(args[2], nullptr, 0) : 0x7E0;
+    canid_t responseBase = args.size() > 3 ? strtoul(args[3], nullptr, 0) : 0x7E8;
+    if (count <= 0) {
+        cerr << "Usage: " << argv[0] << " [ifname] [ecus] [request_base] [response_base] [--clear] [--simulate]\n";
+        return 1;
+    }
+
+    thread ecus;
+    if (simulate) {
+        ecus = thread(simulatedECUs, ifname, count, requestBase, responseBase);
+        this_thread::sleep_for(chrono::milliseconds(50));
+    }
+
+    // Requests for all ECUs leave in one sendmmsg burst per loop iteration
+    int s = setupCAN(ifname);
+    CANTransmitter tx(s, 64);
+    UDSClient uds(count, [&tx](const can_frame &f) { tx.queue(f); });
+    for (int i = 0; i < count; i++)
+        uds.addEcu(requestBase + i, responseBase + i);
+
+    struct Result { UDSStatus status = UDSStatus::Timeout; uint8_t nrc = 0; int dtcs = 0; uint64_t rttNs = 0; bool cleared = false; };
+    vector<Result> results(count);
+
+    uint64_t start = monotonicNowNs();
+    for (int i = 0; i < count; i++) {
+        uds.request(i, {0x19, 0x02, 0x09}, start, [&, clear](const UDSResponse &r) {
+            Result &res = results[r.ecu];
+            res.status = r.status;
+            res.nrc = r.nrc;
+            res.rttNs = r.rttNs;
+            if (r.status != UDSStatus::Positive) return;
+            res.dtcs = r.len > 3 ? (r.len - 3) / 4 : 0;
+            if (clear && res.dtcs)
+                uds.request(r.ecu, {0x14, 0xFF, 0xFF, 0xFF}, monotonicNowNs(), [&](const UDSResponse &c) {
+                    results[c.ecu].cleared = c.status == UDSStatus::Positive;
+                });
+        });
+    }
+    if (tx.flush() < 0) perror("Tester write");
+
+    CANReceiver rx(s);
+    while (!uds.idle()) {
+        waitForFrames(s, uds.nextDeadline());
+        int n = rx.receive(MSG_DONTWAIT);
+        for (int i = 0; i < n; i++)
+            uds.receive(rx.frame(i), rx.timestampNs(i));
+        uds.poll(monotonicNowNs());
+        if (tx.flush() < 0) perror("Tester write");
+    }
+    double elapsedMs = (monotonicNowNs() - start) / 1e6;
+
+    int answered = 0;
+    for (int i = 0; i < count; i++) {
+        const Result &r = results[i];
+        const UDSClient::Stats &st = uds.stats(i);
+        cout << "ECU 0x" << hex << uppercase << requestBase + i << dec << "  " << setw(15) << left
+             << statusName(r.status) << right;
+        if (r.status == UDSStatus::Positive) {
+            answered++;
+            cout << setw(4) << r.dtcs << " DTCs" << (r.cleared ? " (cleared)" : "");
+        } else if (r.status == UDSStatus::Negative) {
+            cout << " NRC 0x" << hex << uppercase << int(r.nrc) << dec;
+        }
+        cout << fixed << setprecision(2) << "  rtt " << r.rttNs / 1e6 << " ms";
+        if (st.pending) cout << " (" << st.pending << "x pending)";
+        cout << "\n";
+    }
+    cout << answered << "/" << count << " ECUs answered in " << fixed << setprecision(1) << elapsedMs << " ms\n";
+
+    simulating = false;
+    if (ecus.joinable()) ecus.join();
+    close(s);
+    return answered == count ? 0 : 1;
+}
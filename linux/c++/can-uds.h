@@ -0,0 +1,184 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+#include <linux/can.h>
+#include "can-isotp.h"
+
+// Asynchronous UDS (ISO 14229) client over ISOTPEngine. Every ECU has its
+// own ISO-TP channel and request queue, so requests to different ECUs run
+// concurrently and requests to one ECU are pipelined back to back. A
+// response is matched to the ECU by its channel and to the request by its
+// service ID; late answers to abandoned requests are dropped.
+//
+// Timing follows ISO 14229-2: P2 runs from the end of the request to the
+// start of the response, and each 0x78 (response pending) answer re-arms
+// it with P2*. Drive it like the engine: feed frames to receive() and
+// call poll() when nextDeadline() passes.
+
+enum class UDSStatus {
+    Positive,
+    Negative,           // 0x7F response, see nrc
+    Timeout,            // P2/P2* expired
+    TransportError,     // ISO-TP gave up (flow control, sequence, overflow)
+};
+
+struct UDSResponse {
+    int ecu;
+    UDSStatus status;
+    uint8_t service;        // request SID
+    uint8_t nrc;            // negative response code, for Negative
+    const uint8_t *data;    // whole response (SID + 0x40 ...), or nullptr
+    size_t len;
+    uint64_t rttNs;         // request start to final response
+};
+
+class UDSClient {
+public:
+    using Handler = std::function<void(const UDSResponse &response)>;
+
+    struct Stats {
+        uint32_t requests = 0;
+        uint32_t positive = 0;
+        uint32_t negative = 0;
+        uint32_t failed = 0;        // timeouts and transport errors
+        uint32_t pending = 0;       // 0x78 answers seen
+        uint64_t rttMinNs = UINT64_MAX;
+        uint64_t rttMaxNs = 0;
+        uint64_t rttTotalNs = 0;    // over answered requests
+    };
+
+    uint64_t p2Ns = 50000000ull;            // 50 ms
+    uint64_t p2StarNs = 5000000000ull;      // 5 s after 0x78
+
+    UDSClient(size_t maxEcus, ISOTPEngine::SendHandler send) : tp(maxEcus, std::move(send)) {
+        ecus.reserve(maxEcus);
+        tp.onMessage = [this](int ch, const uint8_t *data, size_t len) { response(ch, data, len); };
+        tp.onError = [this](int ch, ISOTPError) { finish(ch, UDSStatus::TransportError, 0, nullptr, 0); };
+        tp.onSent = [this](int ch) {
+            Ecu &e = ecus[ch];
+            if (e.active) e.deadline = now + p2Ns;
+        };
+    }
+
+    // Physical addressing: requests on requestId, responses on responseId.
+    // Returns the ECU number, or -1.
+    int addEcu(canid_t requestId, canid_t responseId) {
+        int ch = tp.open(requestId, responseId);
+        if (ch >= 0) ecus.emplace_back();
+        return ch;
+    }
+
+    // Queue a request; done (may be empty) runs once with the outcome.
+    // Starts at once if the ECU has nothing outstanding.
+    void request(int ecu, std::vector<uint8_t> req, uint64_t nowNs, Handler done = nullptr) {
+        now = nowNs;
+        if (req.empty()) return;
+        ecus[ecu].queue.push_back({std::move(req), std::move(done)});
+        if (!ecus[ecu].active) start(ecu);
+    }
+
+    bool receive(const can_frame &frame, uint64_t nowNs) {
+        now = nowNs;
+        return tp.receive(frame, nowNs);
+    }
+
+    void poll(uint64_t nowNs) {
+        now = nowNs;
+        tp.poll(nowNs);
+        for (size_t ch = 0; ch < ecus.size(); ch++) {
+            Ecu &e = ecus[ch];
+            // A response being reassembled is governed by ISO-TP's N_Cr
+            if (e.active && nowNs > e.deadline && !tp.receiving(ch))
+                finish(ch, UDSStatus::Timeout, 0, nullptr, 0);
+        }
+    }
+
+    uint64_t nextDeadline() const {
+        uint64_t next = tp.nextDeadline();
+        for (auto &e : ecus)
+            if (e.active) next = std::min(next, e.deadline);
+        return next;
+    }
+
+    // Nothing queued or outstanding on any ECU
+    bool idle() const {
+        for (auto &e : ecus)
+            if (e.active || !e.queue.empty()) return false;
+        return true;
+    }
+
+    const Stats &stats(int ecu) const { return ecus[ecu].stats; }
+    size_t ecuCount() const { return ecus.size(); }
+    ISOTPEngine &transport() { return tp; }
+
+private:
+    struct Pending {
+        std::vector<uint8_t> req;
+        Handler done;
+    };
+
+    struct Ecu {
+        std::deque<Pending> queue;      // front is outstanding when active
+        bool active = false;
+        uint64_t startNs = 0;
+        uint64_t deadline = ISOTPEngine::NEVER;     // armed once the request is sent
+        Stats stats;
+    };
+
+    void start(int ch) {
+        Ecu &e = ecus[ch];
+        const std::vector<uint8_t> &req = e.queue.front().req;
+        e.active = true;
+        e.startNs = now;
+        e.deadline = ISOTPEngine::NEVER;
+        e.stats.requests++;
+        if (!tp.send(ch, req.data(), req.size(), now))
+            finish(ch, UDSStatus::TransportError, 0, nullptr, 0);   // too long for the buffer
+    }
+
+    void response(int ch, const uint8_t *data, size_t len) {
+        Ecu &e = ecus[ch];
+        if (!e.active) return;
+        uint8_t sid = e.queue.front().req[0];
+        if (data[0] == 0x7F && len >= 3 && data[1] == sid) {
+            if (data[2] == 0x78) {
+                e.stats.pending++;
+                e.deadline = now + p2StarNs;
+                return;
+            }
+            finish(ch, UDSStatus::Negative, data[2], data, len);
+        } else if (data[0] == uint8_t(sid + 0x40)) {
+            finish(ch, UDSStatus::Positive, 0, data, len);
+        }
+    }
+
+    void finish(int ch, UDSStatus status, uint8_t nrc, const uint8_t *data, size_t len) {
+        Ecu &e = ecus[ch];
+        if (!e.active) return;
+        Pending p = std::move(e.queue.front());
+        e.queue.pop_front();
+        e.active = false;
+
+        uint64_t rtt = now - e.startNs;
+        Stats &s = e.stats;
+        if (status == UDSStatus::Positive) s.positive++;
+        else if (status == UDSStatus::Negative) s.negative++;
+        else s.failed++;
+        if (status == UDSStatus::Positive || status == UDSStatus::Negative) {
+            s.rttMinNs = std::min(s.rttMinNs, rtt);
+            s.rttMaxNs = std::max(s.rttMaxNs, rtt);
+            s.rttTotalNs += rtt;
+        }
+
+        if (p.done) p.done(UDSResponse{ch, status, p.req[0], nrc, data, len, rtt});
+        if (!e.active && !e.queue.empty()) start(ch);
+    }
+
+    ISOTPEngine tp;
+    std::vector<Ecu> ecus;
+    uint64_t now = 0;       // time of the call being handled
+};
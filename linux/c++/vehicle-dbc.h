@@ -0,0 +1,351 @@
+// Generated from DBC/vehicle.dbc by can-dbc-codegen. Do not edit.
+#pragma once
+
+#include "can-dbc-gen.h"
+
+namespace dbc {
+
+struct PowertrainData {
+    static constexpr canid_t ID = 0x12;
+    static constexpr const char *NAME = "PowertrainData";
+    static constexpr int DLC = 8;
+    static constexpr int CYCLE_MS = 100;
+
+    float CoolantTemp = 0;    // °C
+    float ThrottlePosition = 0;    // %
+    float EngineSpeed = 0;    // RPM
+
+    void decode(const uint8_t *d_) {
+        const uint64_t le_ = canLoadLE(d_);
+        CoolantTemp = float(double((le_ >> 0) & 0xFFull) - 40.0);
+        ThrottlePosition = float(double((le_ >> 8) & 0xFFull) * 0.40000000596046448 + 0.0);
+        EngineSpeed = float(double((le_ >> 24) & 0xFFFFull) * 0.125 + 0.0);
+    }
+
+    // Fills all 8 bytes; bits outside the signals (and outside the
+    // selected multiplexer pages) are zero
+    void encode(uint8_t *d_) const {
+        uint64_t le_ = 0, be_ = 0;
+        le_ |= (canRawUnsigned(double(CoolantTemp) + 40.0) & 0xFFull) << 0;
+        le_ |= (canRawUnsigned(double(ThrottlePosition) / 0.40000000596046448) & 0xFFull) << 8;
+        le_ |= (canRawUnsigned(double(EngineSpeed) / 0.125) & 0xFFFFull) << 24;
+        canStore(d_, le_, be_);
+    }
+
+    // Calls f(name, value) for each signal in DBC order
+    template <typename F_>
+    void forEach(F_ &&f_) const {
+        f_("CoolantTemp", CoolantTemp);
+        f_("ThrottlePosition", ThrottlePosition);
+        f_("EngineSpeed", EngineSpeed);
+    }
+};
+
+struct VehicleStatus {
+    static constexpr canid_t ID = 0xAB;
+    static constexpr const char *NAME = "VehicleStatus";
+    static constexpr int DLC = 8;
+    static constexpr int CYCLE_MS = 100;
+
+    float VehicleSpeed = 0;    // km/h
+    float FuelLevel = 0;    // %
+    float Odometer = 0;    // km
+
+    void decode(const uint8_t *d_) {
+        const uint64_t le_ = canLoadLE(d_);
+        VehicleSpeed = float(double((le_ >> 0) & 0xFFFFull) * 0.0099999997764825821 + 0.0);
+        FuelLevel = float(double((le_ >> 16) & 0xFFull) * 0.5 + 0.0);
+        Odometer = float(double((le_ >> 24) & 0xFFFFFFFFull));
+    }
+
+    // Fills all 8 bytes; bits outside the signals (and outside the
+    // selected multiplexer pages) are zero
+    void encode(uint8_t *d_) const {
+        uint64_t le_ = 0, be_ = 0;
+        le_ |= (canRawUnsigned(double(VehicleSpeed) / 0.0099999997764825821) & 0xFFFFull) << 0;
+        le_ |= (canRawUnsigned(double(FuelLevel) / 0.5) & 0xFFull) << 16;
+        le_ |= (canRawUnsigned(double(Odometer)) & 0xFFFFFFFFull) << 24;
+        canStore(d_, le_, be_);
+    }
+
+    // Calls f(name, value) for each signal in DBC order
+    template <typename F_>
+    void forEach(F_ &&f_) const {
+        f_("VehicleSpeed", VehicleSpeed);
+        f_("FuelLevel", FuelLevel);
+        f_("Odometer", Odometer);
+    }
+};
+
+struct EngineData {
+    static constexpr canid_t ID = 0x100;
+    static constexpr const char *NAME = "EngineData";
+    static constexpr int DLC = 8;
+    static constexpr int CYCLE_MS = 1000;
+
+    float EngineTemp = 0;    // °C
+    float BatteryVolt = 0;    // V
+    float RPM = 0;    // rpm
+
+    void decode(const uint8_t *d_) {
+        const uint64_t le_ = canLoadLE(d_);
+        EngineTemp = float(double((le_ >> 0) & 0xFFFFull) * 0.0099999997764825821 + 0.0);
+        BatteryVolt = float(double((le_ >> 16) & 0xFFFFull) * 0.0099999997764825821 + 0.0);
+        RPM = float(double((le_ >> 32) & 0xFFFFFFFFull));
+    }
+
+    // Fills all 8 bytes; bits outside the signals (and outside the
+    // selected multiplexer pages) are zero
+    void encode(uint8_t *d_) const {
+        uint64_t le_ = 0, be_ = 0;
+        le_ |= (canRawUnsigned(double(EngineTemp) / 0.0099999997764825821) & 0xFFFFull) << 0;
+        le_ |= (canRawUnsigned(double(BatteryVolt) / 0.0099999997764825821) & 0xFFFFull) << 16;
+        le_ |= (canRawUnsigned(double(RPM)) & 0xFFFFFFFFull) << 32;
+        canStore(d_, le_, be_);
+    }
+
+    // Calls f(name, value) for each signal in DBC order
+    template <typename F_>
+    void forEach(F_ &&f_) const {
+        f_("EngineTemp", EngineTemp);
+        f_("BatteryVolt", BatteryVolt);
+        f_("RPM", RPM);
+    }
+};
+
+struct SensorCluster {
+    static constexpr canid_t ID = 0x200;
+    static constexpr const char *NAME = "SensorCluster";
+    static constexpr int DLC = 4;
+    static constexpr int CYCLE_MS = 1000;
+
+    float FuelLevel = 0;    // %
+    float CoolantPressure = 0;    // bar
+
+    void decode(const uint8_t *d_) {
+        const uint64_t le_ = canLoadLE(d_);
+        FuelLevel = float(double((le_ >> 0) & 0xFFFFull) * 0.10000000149011612 + 0.0);
+        CoolantPressure = float(double((le_ >> 16) & 0xFFFFull) * 0.10000000149011612 + 0.0);
+    }
+
+    // Fills all 8 bytes; bits outside the signals (and outside the
+    // selected multiplexer pages) are zero
+    void encode(uint8_t *d_) const {
+        uint64_t le_ = 0, be_ = 0;
+        le_ |= (canRawUnsigned(double(FuelLevel) / 0.10000000149011612) & 0xFFFFull) << 0;
+        le_ |= (canRawUnsigned(double(CoolantPressure) / 0.10000000149011612) & 0xFFFFull) << 16;
+        canStore(d_, le_, be_);
+    }
+
+    // Calls f(name, value) for each signal in DBC order
+    template <typename F_>
+    void forEach(F_ &&f_) const {
+        f_("FuelLevel", FuelLevel);
+        f_("CoolantPressure", CoolantPressure);
+    }
+};
+
+struct PowertrainMux {
+    static constexpr canid_t ID = 0x400;
+    static constexpr const char *NAME = "PowertrainMux";
+    static constexpr int DLC = 8;
+    static constexpr int CYCLE_MS = 50;
+
+    float PageId = 0;
+    float GearRatio = 0;
+    float ClutchTemp = 0;    // °C
+    float BoostPressure = 0;    // bar
+    float IntakeTemp = 0;    // °C
+    float Counter = 0;
+
+    void decode(const uint8_t *d_) {
+        const uint64_t le_ = canLoadLE(d_);
+        const uint64_t mux_PageId_ = ((le_ >> 0) & 0xFFull);
+        PageId = float(double((le_ >> 0) & 0xFFull));
+        if (mux_PageId_ == 0) GearRatio = float(double((le_ >> 8) & 0xFFFFull) * 0.0010000000474974513 + 0.0);
+        if (mux_PageId_ == 0) ClutchTemp = float(double((le_ >> 24) & 0xFFFFull) * 0.10000000149011612 - 40.0);
+        if (mux_PageId_ == 1) BoostPressure = float(double((le_ >> 8) & 0xFFFFull) * 0.0099999997764825821 + 0.0);
+        if (mux_PageId_ == 1) IntakeTemp = float(double((le_ >> 24) & 0xFFull) - 40.0);
+        Counter = float(double((le_ >> 56) & 0xFFull));
+    }
+
+    // Fills all 8 bytes; bits outside the signals (and outside the
+    // selected multiplexer pages) are zero
+    void encode(uint8_t *d_) const {
+        uint64_t le_ = 0, be_ = 0;
+        const uint64_t mux_PageId_ = canRawUnsigned(double(PageId)) & 0xFFull;
+        le_ |= (canRawUnsigned(double(PageId)) & 0xFFull) << 0;
+        if (mux_PageId_ == 0) le_ |= (canRawUnsigned(double(GearRatio) / 0.0010000000474974513) & 0xFFFFull) << 8;
+        if (mux_PageId_ == 0) le_ |= (canRawUnsigned((double(ClutchTemp) + 40.0) / 0.10000000149011612) & 0xFFFFull) << 24;
+        if (mux_PageId_ == 1) le_ |= (canRawUnsigned(double(BoostPressure) / 0.0099999997764825821) & 0xFFFFull) << 8;
+        if (mux_PageId_ == 1) le_ |= (canRawUnsigned(double(IntakeTemp) + 40.0) & 0xFFull) << 24;
+        le_ |= (canRawUnsigned(double(Counter)) & 0xFFull) << 56;
+        canStore(d_, le_, be_);
+    }
+
+    // Calls f(name, value) for each signal in DBC order
+    template <typename F_>
+    void forEach(F_ &&f_) const {
+        f_("PageId", PageId);
+        f_("GearRatio", GearRatio);
+        f_("ClutchTemp", ClutchTemp);
+        f_("BoostPressure", BoostPressure);
+        f_("IntakeTemp", IntakeTemp);
+        f_("Counter", Counter);
+    }
+};
+
+struct DiagMux {
+    static constexpr canid_t ID = 0x401;
+    static constexpr const char *NAME = "DiagMux";
+    static constexpr int DLC = 8;
+    static constexpr int CYCLE_MS = 0;
+
+    float Service = 0;
+    float SubFunction = 0;
+    float SupplyVoltage = 0;    // V
+    float SensorTemp = 0;    // °C
+    float SensorStatus = 0;
+
+    void decode(const uint8_t *d_) {
+        const uint64_t le_ = canLoadLE(d_);
+        const uint64_t mux_Service_ = ((le_ >> 0) & 0xFFull);
+        const uint64_t mux_SubFunction_ = ((le_ >> 8) & 0xFFull);
+        Service = float(double((le_ >> 0) & 0xFFull));
+        if (mux_Service_ == 1) SubFunction = float(double((le_ >> 8) & 0xFFull));
+        if (mux_Service_ == 2) SupplyVoltage = float(double((le_ >> 8) & 0xFFFFull) * 0.0099999997764825821 + 0.0);
+        if (mux_Service_ == 1 && mux_SubFunction_ <= 3) SensorTemp = float(canSigned<16>(((le_ >> 16) & 0xFFFFull)) * 0.10000000149011612 + 0.0);
+        if (mux_Service_ == 1 && (mux_SubFunction_ == 4 || (mux_SubFunction_ >= 8 && mux_SubFunction_ <= 15))) SensorStatus = float(double((le_ >> 16) & 0xFFull));
+    }
+
+    // Fills all 8 bytes; bits outside the signals (and outside the
+    // selected multiplexer pages) are zero
+    void encode(uint8_t *d_) const {
+        uint64_t le_ = 0, be_ = 0;
+        const uint64_t mux_Service_ = canRawUnsigned(double(Service)) & 0xFFull;
+        const uint64_t mux_SubFunction_ = canRawUnsigned(double(SubFunction)) & 0xFFull;
+        le_ |= (canRawUnsigned(double(Service)) & 0xFFull) << 0;
+        if (mux_Service_ == 1) le_ |= (canRawUnsigned(double(SubFunction)) & 0xFFull) << 8;
+        if (mux_Service_ == 2) le_ |= (canRawUnsigned(double(SupplyVoltage) / 0.0099999997764825821) & 0xFFFFull) << 8;
+        if (mux_Service_ == 1 && mux_SubFunction_ <= 3) le_ |= (canRawSigned(double(SensorTemp) / 0.10000000149011612) & 0xFFFFull) << 16;
+        if (mux_Service_ == 1 && (mux_SubFunction_ == 4 || (mux_SubFunction_ >= 8 && mux_SubFunction_ <= 15))) le_ |= (canRawUnsigned(double(SensorStatus)) & 0xFFull) << 16;
+        canStore(d_, le_, be_);
+    }
+
+    // Calls f(name, value) for each signal in DBC order
+    template <typename F_>
+    void forEach(F_ &&f_) const {
+        f_("Service", Service);
+        f_("SubFunction", SubFunction);
+        f_("SupplyVoltage", SupplyVoltage);
+        f_("SensorTemp", SensorTemp);
+        f_("SensorStatus", SensorStatus);
+    }
+};
+
+struct WideMux {
+    static constexpr canid_t ID = 0x402;
+    static constexpr const char *NAME = "WideMux";
+    static constexpr int DLC = 8;
+    static constexpr int CYCLE_MS = 0;
+
+    float Page = 0;
+    float Level = 0;
+    float Limit = 0;
+    float Band = 0;
+    float Step = 0;
+    float Trim = 0;
+
+    void decode(const uint8_t *d_) {
+        const uint64_t le_ = canLoadLE(d_);
+        const uint64_t mux_Page_ = ((le_ >> 0) & 0xFFFFull);
+        const uint64_t mux_Step_ = ((le_ >> 56) & 0xFull);
+        Page = float(double((le_ >> 0) & 0xFFFFull));
+        if (mux_Page_ == 0) Level = float(double((le_ >> 16) & 0xFFFFull) * 0.10000000149011612 + 0.0);
+        if (mux_Page_ == 65534) Limit = float(canSigned<16>(((le_ >> 16) & 0xFFFFull)) * 0.10000000149011612 + 0.0);
+        if (((mux_Page_ >= 1 && mux_Page_ <= 15) || (mux_Page_ >= 65000 && mux_Page_ <= 65534))) Band = float(double((le_ >> 32) & 0xFFull));
+        if (mux_Page_ == 1) Step = float(double((le_ >> 56) & 0xFull));
+        if (mux_Page_ == 1 && (mux_Step_ >= 12 && mux_Step_ <= 70000)) Trim = float(double((le_ >> 40) & 0xFFull));
+    }
+
+    // Fills all 8 bytes; bits outside the signals (and outside the
+    // selected multiplexer pages) are zero
+    void encode(uint8_t *d_) const {
+        uint64_t le_ = 0, be_ = 0;
+        const uint64_t mux_Page_ = canRawUnsigned(double(Page)) & 0xFFFFull;
+        const uint64_t mux_Step_ = canRawUnsigned(double(Step)) & 0xFull;
+        le_ |= (canRawUnsigned(double(Page)) & 0xFFFFull) << 0;
+        if (mux_Page_ == 0) le_ |= (canRawUnsigned(double(Level) / 0.10000000149011612) & 0xFFFFull) << 16;
+        if (mux_Page_ == 65534) le_ |= (canRawSigned(double(Limit) / 0.10000000149011612) & 0xFFFFull) << 16;
+        if (((mux_Page_ >= 1 && mux_Page_ <= 15) || (mux_Page_ >= 65000 && mux_Page_ <= 65534))) le_ |= (canRawUnsigned(double(Band)) & 0xFFull) << 32;
+        if (mux_Page_ == 1) le_ |= (canRawUnsigned(double(Step)) & 0xFull) << 56;
+        if (mux_Page_ == 1 && (mux_Step_ >= 12 && mux_Step_ <= 70000)) le_ |= (canRawUnsigned(double(Trim)) & 0xFFull) << 40;
+        canStore(d_, le_, be_);
+    }
+
+    // Calls f(name, value) for each signal in DBC order
+    template <typename F_>
+    void forEach(F_ &&f_) const {
+        f_("Page", Page);
+        f_("Level", Level);
+        f_("Limit", Limit);
+        f_("Band", Band);
+        f_("Step", Step);
+        f_("Trim", Trim);
+    }
+};
+
+struct EngineStatus {
+    static constexpr canid_t ID = 0x98FF50E5;     // 29-bit
+    static constexpr const char *NAME = "EngineStatus";
+    static constexpr int DLC = 8;
+    static constexpr int CYCLE_MS = 0;
+
+    float Voltage = 0;    // V
+    float EngineRPM = 0;    // rpm
+    float OilTemp = 0;    // °C
+
+    void decode(const uint8_t *d_) {
+        const uint64_t le_ = canLoadLE(d_);
+        Voltage = float(double((le_ >> 0) & 0xFFFFull) * 0.0099999997764825821 + 0.0);
+        EngineRPM = float(double((le_ >> 24) & 0xFFFFull) * 0.125 + 0.0);
+        OilTemp = float(double((le_ >> 40) & 0xFFFFull) * 0.03125 - 273.0);
+    }
+
+    // Fills all 8 bytes; bits outside the signals (and outside the
+    // selected multiplexer pages) are zero
+    void encode(uint8_t *d_) const {
+        uint64_t le_ = 0, be_ = 0;
+        le_ |= (canRawUnsigned(double(Voltage) / 0.0099999997764825821) & 0xFFFFull) << 0;
+        le_ |= (canRawUnsigned(double(EngineRPM) / 0.125) & 0xFFFFull) << 24;
+        le_ |= (canRawUnsigned((double(OilTemp) + 273.0) / 0.03125) & 0xFFFFull) << 40;
+        canStore(d_, le_, be_);
+    }
+
+    // Calls f(name, value) for each signal in DBC order
+    template <typename F_>
+    void forEach(F_ &&f_) const {
+        f_("Voltage", Voltage);
+        f_("EngineRPM", EngineRPM);
+        f_("OilTemp", OilTemp);
+    }
+};
+
+// Decode frame into its message struct and call visit(msg).
+// Returns false for IDs not in the DBC.
+template <typename Visitor_>
+inline bool decode(const can_frame &frame_, Visitor_ &&visit_) {
+    switch (frame_.can_id & (CAN_EFF_FLAG | CAN_EFF_MASK)) {
+    case PowertrainData::ID: { PowertrainData m_; m_.decode(frame_.data); visit_(m_); return true; }
+    case VehicleStatus::ID: { VehicleStatus m_; m_.decode(frame_.data); visit_(m_); return true; }
+    case EngineData::ID: { EngineData m_; m_.decode(frame_.data); visit_(m_); return true; }
+    case SensorCluster::ID: { SensorCluster m_; m_.decode(frame_.data); visit_(m_); return true; }
+    case PowertrainMux::ID: { PowertrainMux m_; m_.decode(frame_.data); visit_(m_); return true; }
+    case DiagMux::ID: { DiagMux m_; m_.decode(frame_.data); visit_(m_); return true; }
+    case WideMux::ID: { WideMux m_; m_.decode(frame_.data); visit_(m_); return true; }
+    case EngineStatus::ID: { EngineStatus m_; m_.decode(frame_.data); visit_(m_); return true; }
+    default: return false;
+    }
+}
+
+} // namespace dbc
@@ -7,19 +7,14 @@
 #include <sys/socket.h>
 #include <linux/can.h>
 #include <linux/can/raw.h>
+#include "c++/can-signal.h"
+#include "c++/can-j1939.h"
+
+// Signal layouts (little-endian 16-bit), planned once
+const SignalPlan voltageSig = SignalPlan::make(0, 16);
+const SignalPlan rpmSig     = SignalPlan::make(24, 16);
+const SignalPlan tempSig    = SignalPlan::make(40, 16);
 
-// Little-endian 16-bit signal unpack
-uint16_t getSignalLE(uint8_t* data, uint8_t startBit) {
-    uint16_t value = 0;
-    for(int i=0; i<16; ++i) {
-        int bitPos = startBit + i;
-        int byteIndex = bitPos / 8;
-        int bitIndex  = bitPos % 8;
-        if(data[byteIndex] & (1 << bitIndex))
-            value |= (1 << i);
-    }
-    return value;
-}
 int main() {
     // Setup SocketCAN
     int s = socket(PF_CAN, SOCK_RAW, CAN_RAW);
@@ -38,10 +33,11 @@ int main() {
     int nbytes = read(s, &frame, sizeof(frame));
     if(nbytes < 0) { perror("Read"); return 1; }
 
-    if((frame.can_id & 0x1FFFFFFF) == 0x18FF50E5) { // check ID
-        double voltage = getSignalLE(frame.data, 0) * 0.01;
-        double rpm     = getSignalLE(frame.data, 24) * 0.125;
-        double tempC   = getSignalLE(frame.data, 40) * 0.03125 - 273;
+    // Match J1939 PGN 0xFF50 from any source address and priority
+    if((frame.can_id & CAN_EFF_FLAG) && J1939Id::parse(frame.can_id).pgn == 0xFF50) {
+        double voltage = voltageSig.extract(frame.data) * 0.01;
+        double rpm     = rpmSig.extract(frame.data) * 0.125;
+        double tempC   = tempSig.extract(frame.data) * 0.03125 - 273;
     
         std::cout << "Decoded signals:\n";
         std::cout << "Voltage: " << voltage << " V\n";
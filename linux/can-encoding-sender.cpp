@@ -8,18 +8,14 @@
 #include <sys/socket.h>
 #include <linux/can.h>
 #include <linux/can/raw.h>
+#include "c++/can-signal.h"
+#include "c++/can-j1939.h"
 
-// Little-endian 16-bit signal pack
-void setSignalLE(uint8_t* data, uint16_t rawValue, uint8_t startBit) {
-    for(int i=0; i<16; ++i) {
-        int bitPos = startBit + i;
-        int byteIndex = bitPos / 8;
-        int bitIndex  = bitPos % 8;
+// Signal layouts (little-endian 16-bit), planned once
+const SignalPlan voltageSig = SignalPlan::make(0, 16);
+const SignalPlan rpmSig     = SignalPlan::make(24, 16);
+const SignalPlan tempSig    = SignalPlan::make(40, 16);
 
-        data[byteIndex] &= ~(1 << bitIndex);        // clear
-        if(rawValue & (1 << i)) data[byteIndex] |= (1 << bitIndex); // set
-    }
-}
 int main() {
     // Real values
     double voltage = 12.6;   
@@ -52,14 +48,14 @@ int main() {
 
     // Prepare frame
     struct can_frame frame{};
-    frame.can_id  = 0x18FF50E5 | CAN_EFF_FLAG; // 29-bit extended
+    frame.can_id  = J1939Id{6, 0xFF50, 0xE5}.canId(); // 29-bit 0x18FF50E5: PGN 0xFF50 from 0xE5
     frame.can_dlc = 8;
     memset(frame.data, 0, 8);
 
     // Pack signals
-    setSignalLE(frame.data, raw_voltage, 0);   // start bit 0
-    setSignalLE(frame.data, raw_rpm, 24);      // start bit 24
-    setSignalLE(frame.data, raw_temp, 40);     // start bit 40
+    voltageSig.insert(frame.data, raw_voltage);   // start bit 0
+    rpmSig.insert(frame.data, raw_rpm);           // start bit 24
+    tempSig.insert(frame.data, raw_temp);         // start bit 40
 
     // Print encoded CAN frame bytes
     std::cout << "Encoded CAN data bytes: ";